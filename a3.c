@@ -6,19 +6,181 @@
 //---------------------------------------------------------------------------------------------------------------------
 //
 
+#define _POSIX_C_SOURCE 200809L
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <strings.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <math.h>
+#include <pthread.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <sys/ioctl.h>
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define A3_MALLINFO2
+#endif
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 
 const int MAX_ROW = 3;
 const int MIN_ROW = 1;
 const int MAX_CARD_PER_PLAYER = 10;
 const int ERROR = -1;
 const int OUT_OF_MEMORY = 4;
+const int HINT_SHOWN = -2;
+const int QUIT_GAME = -3;
 const int BUFFER_SIZE = 255;
+const long HINT_DEFAULT_MILLISECONDS = 1000;
+const long HINT_MAX_MILLISECONDS = 60000;
+const long SERVER_HINT_MAX_MILLISECONDS = 20;
+const int CHECK_FAILED = 5;
+const int MAX_CARD_NUMBER = 120;
+const uint32_t BOOK_VERSION = 1;
+const int BOOK_DEFAULT_GAMES = 200;
+const long POLICY_DEFAULT_MILLISECONDS = 10;
+const int ANALYSIS_MIN_GAMES = 100;
+const long ANALYSIS_DEFAULT_MAX_GAMES = 1000000;
+const double ANALYSIS_DEFAULT_WIDTH = 0.02;
+const double CONFIDENCE_Z = 1.96;
+const char *const HELP_TEXT = "\nAvailable commands:\n"
+                              "\n"
+                              "- help\n"
+                              "  Display this help message.\n"
+                              "\n"
+                              "- place <row number> <card number>\n"
+                              "  Append a card to the chosen row or if the chosen row does not exist create it.\n"
+                              "\n"
+                              "- discard <card number>\n"
+                              "  Discard a card from the chosen cards.\n"
+                              "\n"
+                              "- hint [milliseconds]\n"
+                              "  Suggest the best move found within the time budget.\n"
+                              "\n";
+const char *const HELP_TEXT_UNDO = "- undo\n"
+                                   "  Take back your last place or discard command of this turn.\n"
+                                   "\n"
+                                   "- redo\n"
+                                   "  Repeat the last command taken back with undo.\n"
+                                   "\n";
+const char *const HELP_TEXT_FILES = "- save <file>\n"
+                                    "  Save the whole game to a file.\n"
+                                    "\n"
+                                    "- load <file>\n"
+                                    "  Continue a game saved to a file.\n"
+                                    "\n";
+const char *const HELP_TEXT_QUIT = "- quit\n"
+                                   "  Terminate the program.\n"
+                                   "\n";
+const uint8_t SNAPSHOT_VERSION = 1;
+const uint32_t CACHE_VERSION = 3;
+const uint32_t RULES_VERSION = 1;
+const uint32_t TRAJECTORY_VERSION = 1;
+const uint32_t STORE_VERSION = 1;
+const uint32_t ARCHIVE_VERSION = 1;
+const uint32_t ARCHIVE_RANKING_VERSION = 1;
+const uint32_t ARCHIVE_INCREMENT = 24;
+const uint32_t ARCHIVE_MAX_TOTAL = 1 << 16;
+const uint32_t ARCHIVE_RANGE_TOP = 1 << 24;
+const int BENCH_DEFAULT_REPETITIONS = 11;
+const long BENCH_DEFAULT_MILLISECONDS = 20;
+const int BENCH_LARGE_PLAYERS = 12;
+const int BENCH_ROW_CARDS = 6;
+const char *const QUERY_MEASURES[] = {"games", "winrate", "points", "longest", "colors"};
+const char *const INSTRUMENT_TIMER_NAMES[] = {"parseConfigFile", "cardDistribution", "card choosing phase",
+                                              "action phase", "printPoints"};
+const char *const INSTRUMENT_COUNTER_NAMES[] = {"list nodes traversed", "allocations", "commands rejected"};
+const char *const INSTRUMENT_COMMAND_NAMES[] = {"choose", "place", "discard", "hint", "undo", "redo",
+                                                "save", "load", "help", "quit", "other"};
+const char *const ACCOUNT_PHASE_NAMES[] = {"setup", "card choosing phase", "action phase", "end"};
+
+#define ENGINE_PLAYERS 2
+#define ENGINE_ROWS 3
+#define CARD_NUMBER_LIMIT 128
+#define SEARCH_MAX_DEPTH 64
+#define SEARCH_MAX_MOVES 64
+#define SEARCH_INFINITY 100000
+#define TABLEBASE_SHAPES 7
+#define TABLEBASE_LENGTHS 7
+#define TABLEBASE_LENGTH_CAP 3
+#define TABLEBASE_ENTRY_SIZE 4
+#define TABLEBASE_ENTRIES (16 * 343 * 343)
+#define SESSION_LINE_SIZE 255
+#define SESSION_READ_SIZE 4096
+#define SERVER_EVENTS 64
+#define PLAYER_INPUT_SIZE 1024
+#define SNAPSHOT_PLACES 5
+#define SNAPSHOT_PLACE_BITS 4
+#define SNAPSHOT_MAX_PLAYERS 3
+#define CACHE_SLOTS 16384
+#define CACHE_PROBES 4
+#define TRAJECTORY_GAME_RECORDS 128
+#define TRAJECTORY_BUFFER_RECORDS 16384
+#define ENGINE_COLORS 4
+#define STORE_BLOCK_GAMES 4096
+#define ANALYSIS_BATCH 64
+#define STORE_ALIGNMENT 16
+#define QUERY_MAX_THREADS 64
+#define ARCHIVE_BLOCK_GAMES 65536
+#define ARCHIVE_MAX_DECKS 64
+#define BENCH_MAX_REPETITIONS 101
+#define BENCH_SCRIPT_LINES 128
+#define BENCH_LINE_SIZE 32
+#define BENCH_PATH_SIZE 64
+#define INSTRUMENT_BUCKETS 32
+#define ACCOUNT_SITES 1024
+#define DECK_CARDS (ENGINE_PLAYERS * 10)
+#define DECK_BATCH 65536
+#define DECK_LINE_SIZE 160
+#define TOURNAMENT_MAX_POLICIES 16
+#define TOURNAMENT_NAME_SIZE 64
+#define TOURNAMENT_MAX_THREADS 64
+#define POLICY_WEIGHTS (ENGINE_COLORS + 3)
+#define TUI_LINES (ENGINE_ROWS + 3)
+#define TUI_LINE_SIZE 256
+#define METRICS_PHASES 2
+
+const uint32_t TABLEBASE_VERSION = 1;
+const int TABLEBASE_SHAPE_CODE[3][3] = {{1, 2, 3}, {0, 4, 5}, {0, 0, 6}};
+const int TABLEBASE_SHAPE_LOW[TABLEBASE_SHAPES] = {0, 0, 0, 0, 1, 1, 2};
+const int TABLEBASE_SHAPE_HIGH[TABLEBASE_SHAPES] = {0, 0, 1, 2, 1, 2, 2};
+const char CARD_COLORS[] = "bgwr";
+const int STRESS_MAX_CARDS = 65535;
+const int WEIGHT_LONGEST = ENGINE_COLORS;
+const int WEIGHT_HEADROOM = ENGINE_COLORS + 1;
+const int WEIGHT_PENDING = ENGINE_COLORS + 2;
+const double POLICY_DEFAULT_WEIGHTS[POLICY_WEIGHTS] = {3, 4, 7, 10, 1, 0, 1};
+const char *const POLICY_WEIGHT_NAMES[POLICY_WEIGHTS] = {"blue", "green", "white", "red", "longest", "headroom",
+                                                         "pending"};
+const double TUNE_SCALES[POLICY_WEIGHTS] = {1, 1, 1, 1, 0.25, 10, 0.25};
+const double TUNE_STEP = 2.0;
+const double TUNE_PERTURBATION = 1.0;
+const int TUNE_FINAL_DECKS = 4;
+const long METRICS_INTERVAL_MILLISECONDS = 1000;
+const char *const METRICS_PHASE_NAMES[METRICS_PHASES] = {"choosing", "action"};
+const double METRICS_QUANTILES[3] = {0.5, 0.9, 0.99};
+const int STRESS_MAX_PLAYERS = 256;
+const uint8_t ROLLOUT_ROW_COUNT[8] = {1, 1, 1, 2, 1, 2, 2, 3};
+const uint8_t ROLLOUT_ROW[8][3] = {{ENGINE_ROWS, 0, 0}, {0, 0, 0}, {1, 0, 0}, {0, 1, 0},
+                                   {2, 0, 0}, {0, 2, 0}, {1, 2, 0}, {0, 1, 2}};
 
 
 typedef enum _Points_
@@ -52,6 +214,921 @@ typedef struct _Game_
   char *file_name_;
 } Game;
 
+typedef enum _Phase_
+{
+  PHASE_CHOOSING,
+  PHASE_ACTION,
+  PHASE_OVER
+} Phase;
+
+typedef struct _PlayerInput_
+{
+  int fd_;
+  int numbers_entered_;
+  int error_;
+  size_t length_;
+  char buffer_[PLAYER_INPUT_SIZE];
+} PlayerInput;
+
+typedef enum _MoveType_
+{
+  MOVE_CHOOSE,
+  MOVE_PLACE,
+  MOVE_DISCARD
+} MoveType;
+
+typedef struct _CardSet_
+{
+  uint64_t bits_[2];
+} CardSet;
+
+typedef struct _RowState_
+{
+  uint8_t low_;
+  uint8_t high_;
+  uint8_t length_;
+  uint8_t points_;
+} RowState;
+
+typedef struct _Position_
+{
+  CardSet hand_cards_[ENGINE_PLAYERS];
+  CardSet chosen_cards_[ENGINE_PLAYERS];
+  RowState row_[ENGINE_PLAYERS][ENGINE_ROWS];
+  uint8_t phase_;
+  uint8_t turn_;
+  uint8_t picked_;
+} Position;
+
+typedef struct _Deck_
+{
+  char color_[CARD_NUMBER_LIMIT];
+  uint8_t points_[CARD_NUMBER_LIMIT];
+} Deck;
+
+typedef struct _Move_
+{
+  uint8_t type_;
+  uint8_t card_;
+  uint8_t second_card_;
+  uint8_t row_;
+} Move;
+
+typedef struct _JournalEntry_
+{
+  Move move_;
+  uint8_t turn_;
+  uint8_t phase_;
+  uint8_t picked_;
+  char color_;
+  RowState row_;
+  Card *card_;
+  Card *previous_;
+} JournalEntry;
+
+typedef struct _Journal_
+{
+  JournalEntry *entries_;
+  int length_;
+  int end_;
+  int capacity_;
+} Journal;
+
+typedef struct _GameFlow_
+{
+  Player *players_;
+  Game *game_;
+  FILE *out_;
+  Phase phase_;
+  int player_index_;
+  int numbers_entered_;
+  int error_;
+  int result_;
+  int simultaneous_;
+  int served_;
+  int completed_;
+  unsigned long rejected_;
+  const struct _Engine_ *engine_;
+  Journal journal_;
+} GameFlow;
+
+typedef struct _Snapshot_
+{
+  char magic_[4];
+  uint8_t version_;
+  uint8_t players_;
+  uint8_t phase_;
+  uint8_t turn_;
+  CardSet cards_;
+  CardSet colors_[2];
+  CardSet places_[SNAPSHOT_PLACE_BITS];
+} Snapshot;
+
+typedef struct _TablebaseHeader_
+{
+  char magic_[4];
+  uint32_t version_;
+  uint32_t entry_count_;
+  uint32_t entry_size_;
+} TablebaseHeader;
+
+typedef struct _MappedFile_
+{
+  void *data_;
+  size_t size_;
+} MappedFile;
+
+typedef struct _Tablebase_
+{
+  MappedFile file_;
+  const int8_t *entries_;
+} Tablebase;
+
+typedef struct _BookHeader_
+{
+  char magic_[4];
+  uint32_t version_;
+  uint32_t entry_count_;
+  uint32_t entry_size_;
+} BookHeader;
+
+typedef struct _BookEntry_
+{
+  uint64_t key_[2];
+  uint8_t first_card_;
+  uint8_t second_card_;
+  int16_t value_;
+  uint32_t games_;
+} BookEntry;
+
+typedef struct _OpeningBook_
+{
+  MappedFile file_;
+  const BookEntry *entries_;
+  uint32_t entry_count_;
+} OpeningBook;
+
+typedef struct _Random_
+{
+  uint64_t state_;
+} Random;
+
+typedef enum _PolicyType_
+{
+  POLICY_RANDOM,
+  POLICY_GREEDY,
+  POLICY_SEARCH,
+  POLICY_ROLLOUT,
+  POLICY_WEIGHTED
+} PolicyType;
+
+typedef struct _Policy_
+{
+  PolicyType type_;
+  long milliseconds_;
+  double weights_[POLICY_WEIGHTS];
+} Policy;
+
+typedef struct _Search_
+{
+  const Deck *deck_;
+  const Tablebase *tablebase_;
+  struct timespec deadline_;
+  unsigned long nodes_;
+  int aborted_;
+  int horizon_reached_;
+  unsigned long tablebase_hits_;
+} Search;
+
+typedef struct _SearchResult_
+{
+  Move move_;
+  int value_;
+  int depth_;
+  int exact_;
+  unsigned long nodes_;
+} SearchResult;
+
+typedef struct _GameStats_
+{
+  long games_;
+  double win_sum_;
+  double points_sum_[ENGINE_PLAYERS];
+  double points_squares_[ENGINE_PLAYERS];
+  double margin_sum_;
+  double margin_squares_;
+} GameStats;
+
+typedef enum _CacheKind_
+{
+  CACHE_DEAL,
+  CACHE_ANALYSIS,
+  CACHE_SOLVED
+} CacheKind;
+
+typedef struct _CacheHeader_
+{
+  char magic_[4];
+  uint32_t version_;
+  uint32_t slot_count_;
+  uint32_t slot_size_;
+} CacheHeader;
+
+typedef union _CacheValue_
+{
+  GameStats stats_;
+  SearchResult result_;
+} CacheValue;
+
+typedef struct _CacheSlot_
+{
+  _Atomic uint64_t sequence_;
+  uint64_t key_[2];
+  CacheValue value_;
+} CacheSlot;
+
+typedef struct _CacheContent_
+{
+  uint32_t kind_;
+  uint32_t rules_[3];
+  CardSet hand_cards_[ENGINE_PLAYERS];
+  CardSet chosen_cards_[ENGINE_PLAYERS];
+  RowState row_[ENGINE_PLAYERS][ENGINE_ROWS];
+  uint8_t points_[CARD_NUMBER_LIMIT];
+  uint8_t phase_;
+  uint8_t turn_;
+  uint8_t picked_;
+  uint8_t policy_types_[ENGINE_PLAYERS];
+  int64_t policy_milliseconds_[ENGINE_PLAYERS];
+  double policy_weights_[ENGINE_PLAYERS][POLICY_WEIGHTS];
+  uint64_t analysis_seed_;
+  int64_t analysis_max_games_;
+  double analysis_width_;
+} CacheContent;
+
+typedef struct _OutcomeCache_
+{
+  MappedFile file_;
+  CacheSlot *slots_;
+  uint32_t slot_count_;
+  int writable_;
+} OutcomeCache;
+
+typedef struct _Engine_
+{
+  Tablebase tablebase_;
+  OpeningBook book_;
+  OutcomeCache cache_;
+} Engine;
+
+typedef struct _TrajectoryHeader_
+{
+  char magic_[4];
+  uint32_t version_;
+  uint32_t record_size_;
+  uint32_t reserved_;
+  uint8_t points_[CARD_NUMBER_LIMIT];
+} TrajectoryHeader;
+
+typedef struct _TrajectoryRecord_
+{
+  CardSet hand_cards_[ENGINE_PLAYERS];
+  CardSet chosen_cards_[ENGINE_PLAYERS];
+  uint32_t game_;
+  int16_t score_[ENGINE_PLAYERS];
+  int16_t final_score_[ENGINE_PLAYERS];
+  Move move_;
+  uint8_t phase_;
+  uint8_t turn_;
+  uint8_t picked_;
+  uint8_t reserved_;
+  uint8_t row_low_[ENGINE_PLAYERS][ENGINE_ROWS];
+  uint8_t row_high_[ENGINE_PLAYERS][ENGINE_ROWS];
+  uint8_t row_length_[ENGINE_PLAYERS][ENGINE_ROWS];
+  uint8_t padding_[2];
+} TrajectoryRecord;
+
+typedef struct _TrajectoryWriter_
+{
+  FILE *file_;
+  TrajectoryRecord *buffers_[2];
+  size_t length_[2];
+  int active_;
+  int writing_;
+  int closing_;
+  int error_;
+  uint32_t games_;
+  unsigned long records_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t full_;
+  pthread_cond_t free_;
+  pthread_t thread_;
+} TrajectoryWriter;
+
+typedef struct _GameRecord_
+{
+  int64_t deal_;
+  CardSet hand_cards_[ENGINE_PLAYERS];
+  CardSet hand_colors_[ENGINE_PLAYERS][2];
+  int16_t points_[ENGINE_PLAYERS];
+  uint8_t row_length_[ENGINE_PLAYERS][ENGINE_ROWS];
+  uint8_t color_count_[ENGINE_PLAYERS][ENGINE_COLORS];
+  int8_t winner_;
+} GameRecord;
+
+typedef enum _StoreColumn_
+{
+  STORE_DEAL,
+  STORE_WINNER,
+  STORE_POINTS,
+  STORE_ROW_LENGTH = STORE_POINTS + ENGINE_PLAYERS,
+  STORE_COLOR_COUNT = STORE_ROW_LENGTH + ENGINE_PLAYERS * ENGINE_ROWS,
+  STORE_HAND = STORE_COLOR_COUNT + ENGINE_PLAYERS * ENGINE_COLORS,
+  STORE_HAND_COLORS = STORE_HAND + ENGINE_PLAYERS,
+  STORE_COLUMN_COUNT = STORE_HAND_COLORS + ENGINE_PLAYERS
+} StoreColumn;
+
+typedef struct _StoreColumnInfo_
+{
+  uint64_t offset_;
+  int64_t min_;
+  int64_t max_;
+} StoreColumnInfo;
+
+typedef struct _StoreBlockHeader_
+{
+  char magic_[4];
+  uint32_t version_;
+  uint32_t game_count_;
+  uint32_t column_count_;
+  uint64_t block_size_;
+  uint64_t reserved_;
+  CardSet held_[ENGINE_PLAYERS];
+  StoreColumnInfo columns_[STORE_COLUMN_COUNT];
+} StoreBlockHeader;
+
+typedef struct _StoreWriter_
+{
+  FILE *file_;
+  GameRecord *games_;
+  int game_count_;
+  int error_;
+  long written_;
+} StoreWriter;
+
+typedef enum _QueryMeasure_
+{
+  QUERY_GAMES,
+  QUERY_WINRATE,
+  QUERY_POINTS,
+  QUERY_LONGEST,
+  QUERY_COLORS
+} QueryMeasure;
+
+typedef struct _QueryTotals_
+{
+  int64_t deal_;
+  long games_;
+  double win_sum_;
+  double sum_[ENGINE_PLAYERS][ENGINE_COLORS];
+} QueryTotals;
+
+typedef struct _QueryGroups_
+{
+  QueryTotals *groups_;
+  size_t count_;
+  size_t capacity_;
+} QueryGroups;
+
+typedef struct _QueryJob_
+{
+  const StoreBlockHeader **blocks_;
+  int block_count_;
+  int next_block_;
+  int scanned_blocks_;
+  QueryMeasure measure_;
+  int hold_player_;
+  int hold_card_;
+  int hold_color_;
+  int64_t deal_;
+  int by_deal_;
+  int error_;
+  pthread_mutex_t mutex_;
+} QueryJob;
+
+typedef struct _QueryWorker_
+{
+  QueryJob *job_;
+  QueryTotals totals_;
+  QueryGroups groups_;
+  pthread_t thread_;
+} QueryWorker;
+
+typedef struct _ArchiveDeck_
+{
+  CardSet hand_cards_[ENGINE_PLAYERS];
+  CardSet hand_colors_[ENGINE_PLAYERS][2];
+} ArchiveDeck;
+
+typedef struct _ArchiveBlockHeader_
+{
+  char magic_[4];
+  uint32_t version_;
+  uint32_t game_count_;
+  uint32_t deck_count_;
+  uint32_t payload_size_;
+  uint32_t ranking_version_;
+} ArchiveBlockHeader;
+
+typedef struct _ArchiveRank_
+{
+  uint8_t rank_;
+  uint8_t move_count_;
+} ArchiveRank;
+
+typedef struct _ArchiveFrequencies_
+{
+  uint32_t total_;
+  uint16_t frequency_[SEARCH_MAX_MOVES];
+} ArchiveFrequencies;
+
+typedef struct _ArchiveModel_
+{
+  ArchiveFrequencies decks_;
+  ArchiveFrequencies moves_[SEARCH_MAX_MOVES + 1];
+} ArchiveModel;
+
+typedef struct _RangeEncoder_
+{
+  uint8_t *data_;
+  size_t length_;
+  size_t capacity_;
+  uint64_t low_;
+  uint64_t cache_size_;
+  uint32_t range_;
+  uint8_t cache_;
+  int error_;
+} RangeEncoder;
+
+typedef struct _RangeDecoder_
+{
+  const uint8_t *data_;
+  size_t size_;
+  size_t position_;
+  uint32_t code_;
+  uint32_t range_;
+  int error_;
+} RangeDecoder;
+
+typedef struct _ArchiveWriter_
+{
+  FILE *file_;
+  ArchiveDeck decks_[ARCHIVE_MAX_DECKS];
+  int deck_count_;
+  uint32_t game_count_;
+  RangeEncoder encoder_;
+  ArchiveModel model_;
+  long games_;
+  unsigned long bytes_;
+  int error_;
+  pthread_mutex_t mutex_;
+} ArchiveWriter;
+
+typedef struct _AnalysisBatch_
+{
+  int done_;
+  GameStats stats_;
+  TrajectoryRecord *records_;
+  int record_count_;
+  ArchiveRank *ranks_;
+  int rank_error_;
+  GameRecord games_[ANALYSIS_BATCH];
+} AnalysisBatch;
+
+typedef struct _AnalysisJob_
+{
+  const Position *start_;
+  const Deck *deck_;
+  const Policy *policies_;
+  const Engine *engine_;
+  TrajectoryWriter *writer_;
+  StoreWriter *store_;
+  ArchiveWriter *archive_;
+  int64_t deal_;
+  uint64_t seed_;
+  long max_games_;
+  long next_game_;
+  AnalysisBatch *batches_;
+  long batch_slots_;
+  long merged_batches_;
+  double width_;
+  int stop_;
+  int merging_;
+  GameStats stats_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t merged_;
+} AnalysisJob;
+
+typedef struct _AnalysisWorker_
+{
+  AnalysisJob *job_;
+  pthread_t thread_;
+} AnalysisWorker;
+
+typedef struct _Session_
+{
+  int fd_;
+  uint8_t finished_;
+  uint8_t input_closed_;
+  uint8_t overflow_;
+  uint8_t line_length_;
+  Game game_;
+  Player *players_;
+  GameFlow flow_;
+  char line_[SESSION_LINE_SIZE];
+  char *output_;
+  size_t output_length_;
+  size_t output_sent_;
+  struct _Session_ *previous_;
+  struct _Session_ *next_;
+} Session;
+
+typedef struct _Server_
+{
+  int epoll_fd_;
+  int listen_fd_;
+  int signal_fd_;
+  const Game *game_;
+  Card *total_cards_;
+  const Engine *engine_;
+  pthread_mutex_t mutex_;
+  Session *sessions_;
+} Server;
+
+typedef struct _ServerMetrics_
+{
+  _Atomic unsigned long games_started_;
+  _Atomic unsigned long games_completed_;
+  _Atomic unsigned long games_closed_;
+  _Atomic unsigned long commands_[METRICS_PHASES];
+  _Atomic unsigned long rejected_[METRICS_PHASES];
+  _Atomic unsigned long latency_[METRICS_PHASES][INSTRUMENT_BUCKETS];
+  _Atomic unsigned long results_latency_[INSTRUMENT_BUCKETS];
+} ServerMetrics;
+
+typedef struct _ServerWorker_
+{
+  Server *server_;
+  ServerMetrics metrics_;
+  pthread_t thread_;
+} ServerWorker;
+
+typedef struct _MetricsExporter_
+{
+  const char *file_name_;
+  const ServerWorker *workers_;
+  long worker_count_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t wake_;
+  int stop_;
+  struct timespec last_scrape_;
+  unsigned long last_completed_;
+  unsigned long last_rejected_[METRICS_PHASES];
+  int failed_;
+  pthread_t thread_;
+} MetricsExporter;
+
+typedef struct _DeckGenerator_
+{
+  uint64_t seed_;
+  uint32_t color_weights_[ENGINE_COLORS];
+  uint32_t color_total_;
+} DeckGenerator;
+
+typedef struct _GeneratedDeck_
+{
+  uint8_t numbers_[DECK_CARDS];
+  char colors_[DECK_CARDS];
+  int64_t deal_;
+  int line_length_;
+  char line_[DECK_LINE_SIZE];
+} GeneratedDeck;
+
+typedef struct _DeckWorker_
+{
+  const DeckGenerator *generator_;
+  uint64_t first_;
+  GeneratedDeck *decks_;
+  long count_;
+  pthread_t thread_;
+} DeckWorker;
+
+typedef struct _WideCardSet_
+{
+  uint64_t *bits_;
+  int32_t *tree_;
+  int words_;
+  int count_;
+} WideCardSet;
+
+typedef struct _StressRow_
+{
+  int low_;
+  int high_;
+  int length_;
+  long points_;
+} StressRow;
+
+typedef struct _StressRows_
+{
+  StressRow *rows_;
+  int *empty_;
+  int count_;
+  int empty_count_;
+  WideCardSet lows_;
+  WideCardSet highs_;
+} StressRows;
+
+typedef struct _TournamentTask_
+{
+  uint32_t index_;
+  uint32_t deck_;
+  uint8_t first_;
+  uint8_t second_;
+} TournamentTask;
+
+typedef struct _TaskQueue_
+{
+  long head_;
+  long tail_;
+  pthread_mutex_t mutex_;
+} TaskQueue;
+
+typedef struct _Tournament_
+{
+  const TournamentTask *tasks_;
+  TaskQueue *queues_;
+  int queue_count_;
+  const Position *starts_;
+  const Deck *decks_;
+  const Policy *policies_;
+  const Engine *engine_;
+  uint64_t seed_;
+} Tournament;
+
+typedef struct _TournamentWorker_
+{
+  Tournament *tournament_;
+  int index_;
+  long steals_;
+  GameStats results_[TOURNAMENT_MAX_POLICIES][TOURNAMENT_MAX_POLICIES];
+  pthread_t thread_;
+} TournamentWorker;
+
+typedef struct _Tool_
+{
+  const char *name_;
+  const char *usage_;
+  int (*run_)(int argc, char *argv[], const char *tool_usage);
+} Tool;
+
+typedef struct _BenchContext_
+{
+  char large_config_[BENCH_PATH_SIZE];
+  char game_config_[BENCH_PATH_SIZE];
+  char missing_file_[BENCH_PATH_SIZE + 8];
+  Card cards_[CARD_NUMBER_LIMIT];
+  int card_count_;
+  Game game_;
+  Card *total_cards_;
+  Player *players_;
+  char script_[BENCH_SCRIPT_LINES][BENCH_LINE_SIZE];
+  int script_length_;
+  Position start_;
+  Deck deck_;
+  volatile long sink_;
+} BenchContext;
+
+typedef struct _Benchmark_
+{
+  const char *name_;
+  int operations_;
+  int (*run_)(BenchContext *context, long iterations);
+} Benchmark;
+
+typedef struct _PerftCounter_
+{
+  unsigned long leaves_;
+  unsigned long nodes_;
+  unsigned long mismatches_;
+} PerftCounter;
+
+typedef enum _InstrumentTimer_
+{
+  INSTRUMENT_PARSE,
+  INSTRUMENT_DISTRIBUTION,
+  INSTRUMENT_CHOOSING,
+  INSTRUMENT_ACTION,
+  INSTRUMENT_POINTS,
+  INSTRUMENT_TIMERS
+} InstrumentTimer;
+
+typedef enum _InstrumentCounter_
+{
+  INSTRUMENT_NODES,
+  INSTRUMENT_ALLOCATIONS,
+  INSTRUMENT_REJECTED,
+  INSTRUMENT_COUNTERS
+} InstrumentCounter;
+
+typedef enum _InstrumentCommand_
+{
+  COMMAND_CHOOSE,
+  COMMAND_PLACE,
+  COMMAND_DISCARD,
+  COMMAND_HINT,
+  COMMAND_UNDO,
+  COMMAND_REDO,
+  COMMAND_SAVE,
+  COMMAND_LOAD,
+  COMMAND_HELP,
+  COMMAND_QUIT,
+  COMMAND_OTHER,
+  INSTRUMENT_COMMANDS
+} InstrumentCommand;
+
+typedef struct _InstrumentTime_
+{
+  long count_;
+  double wall_;
+  double cpu_;
+  double wall_max_;
+  int running_;
+  struct timespec wall_start_;
+  struct timespec cpu_start_;
+} InstrumentTime;
+
+typedef struct _Instrumentation_
+{
+  int enabled_;
+  const char *file_name_;
+  unsigned long counters_[INSTRUMENT_COUNTERS];
+  InstrumentTime timers_[INSTRUMENT_TIMERS];
+  unsigned long latency_[INSTRUMENT_COMMANDS][INSTRUMENT_BUCKETS];
+  double latency_max_[INSTRUMENT_COMMANDS];
+  int command_;
+  struct timespec command_start_;
+} Instrumentation;
+
+Instrumentation instrumentation;
+
+#ifndef A3_NO_INSTRUMENT
+#define INSTRUMENT_START() instrumentStart()
+#define INSTRUMENT_COUNT(counter, amount) \
+  (instrumentation.enabled_ ? (void) (instrumentation.counters_[counter] += (unsigned long) (amount)) : (void) 0)
+#define INSTRUMENT_BEGIN(timer) (instrumentation.enabled_ ? instrumentBegin(timer) : (void) 0)
+#define INSTRUMENT_END(timer) (instrumentation.enabled_ ? instrumentEnd(timer) : (void) 0)
+#define INSTRUMENT_COMMAND_BEGIN(line) (instrumentation.enabled_ ? instrumentCommandBegin(line) : (void) 0)
+#define INSTRUMENT_COMMAND_END() (instrumentation.enabled_ ? instrumentCommandEnd() : (void) 0)
+#define INSTRUMENT_REJECT() (instrumentation.enabled_ ? instrumentReject() : (void) 0)
+#else
+#define INSTRUMENT_START() ((void) 0)
+#define INSTRUMENT_COUNT(counter, amount) ((void) 0)
+#define INSTRUMENT_BEGIN(timer) ((void) 0)
+#define INSTRUMENT_END(timer) ((void) 0)
+#define INSTRUMENT_COMMAND_BEGIN(line) ((void) 0)
+#define INSTRUMENT_COMMAND_END() ((void) 0)
+#define INSTRUMENT_REJECT() ((void) 0)
+#endif
+
+typedef enum _AccountPhase_
+{
+  ACCOUNT_SETUP,
+  ACCOUNT_CHOOSING,
+  ACCOUNT_ACTION,
+  ACCOUNT_END,
+  ACCOUNT_PHASES
+} AccountPhase;
+
+typedef union _AccountHeader_
+{
+  struct
+  {
+    size_t size_;
+    const char *file_;
+    int line_;
+  } block_;
+  max_align_t alignment_;
+} AccountHeader;
+
+typedef struct _AccountSite_
+{
+  const char *file_;
+  int line_;
+  unsigned long allocations_;
+  long live_blocks_;
+  long live_bytes_;
+} AccountSite;
+
+typedef struct _AccountThread_
+{
+  int phase_;
+  long live_blocks_;
+  unsigned long phase_allocations_[ACCOUNT_PHASES];
+  unsigned long phase_bytes_[ACCOUNT_PHASES];
+  AccountSite sites_[ACCOUNT_SITES];
+  AccountSite other_sites_;
+  struct _AccountThread_ *next_;
+} AccountThread;
+
+typedef struct _Accounting_
+{
+  int enabled_;
+  const char *file_name_;
+  _Atomic long live_bytes_;
+  _Atomic long peak_bytes_;
+  AccountThread *threads_;
+  pthread_mutex_t mutex_;
+} Accounting;
+
+Accounting accounting = {.mutex_ = PTHREAD_MUTEX_INITIALIZER};
+_Thread_local AccountThread *account_thread;
+
+typedef struct _TuiLine_
+{
+  int valid_;
+  uint64_t hash_;
+  char text_[TUI_LINE_SIZE];
+} TuiLine;
+
+typedef struct _Tui_
+{
+  int enabled_;
+  int screen_rows_;
+  int screen_columns_;
+  volatile sig_atomic_t resized_;
+  TuiLine lines_[TUI_LINES];
+} Tui;
+
+Tui tui;
+
+#ifndef A3_NO_ACCOUNT
+#define ACCOUNT_MALLOC(size) accountMalloc(size, __FILE__, __LINE__)
+#define ACCOUNT_CALLOC(count, size) accountCalloc(count, size, __FILE__, __LINE__)
+#define ACCOUNT_REALLOC(pointer, size) accountRealloc(pointer, size, __FILE__, __LINE__)
+#define ACCOUNT_FREE(pointer) accountFree(pointer)
+#define ACCOUNT_START() accountStart()
+#define ACCOUNT_PHASE(phase) (accounting.enabled_ ? accountPhase(phase) : (void) 0)
+#else
+#define ACCOUNT_MALLOC(size) (INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1), malloc(size))
+#define ACCOUNT_CALLOC(count, size) (INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1), calloc(count, size))
+#define ACCOUNT_REALLOC(pointer, size) (INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1), realloc(pointer, size))
+#define ACCOUNT_FREE(pointer) free(pointer)
+#define ACCOUNT_START() ((void) 0)
+#define ACCOUNT_PHASE(phase) ((void) 0)
+#endif
+
+#if !defined(A3_NO_PROBES) && defined(__GNUC__) && defined(__x86_64__)
+#define PROBE_SEMAPHORE(name) volatile unsigned short a3_probe_##name __attribute__((section(".probes")))
+#define PROBE_ENABLED(name) (a3_probe_##name != 0)
+#define PROBE(name, player, card, row)                                                                      \
+  __asm__ __volatile__("990: nop\n"                                                                         \
+                       ".pushsection .note.stapsdt, \"?\", \"note\"\n"                                      \
+                       ".balign 4\n"                                                                        \
+                       ".4byte 992f-991f, 994f-993f, 3\n"                                                   \
+                       "991: .asciz \"stapsdt\"\n"                                                          \
+                       "992: .balign 4\n"                                                                   \
+                       "993: .8byte 990b, _.stapsdt.base, a3_probe_" #name "\n"                            \
+                       ".asciz \"a3\", \"" #name "\", \"-4@%0 -4@%1 -4@%2\"\n"                              \
+                       "994: .balign 4\n"                                                                   \
+                       ".popsection\n"                                                                      \
+                       ".ifndef _.stapsdt.base\n"                                                           \
+                       ".pushsection .stapsdt.base, \"aG\", \"progbits\", .stapsdt.base, comdat\n"          \
+                       ".weak _.stapsdt.base\n"                                                             \
+                       ".hidden _.stapsdt.base\n"                                                           \
+                       "_.stapsdt.base: .space 1\n"                                                         \
+                       ".size _.stapsdt.base, 1\n"                                                          \
+                       ".popsection\n"                                                                      \
+                       ".endif\n"                                                                           \
+                       :                                                                                    \
+                       : "nor"((int) (player)), "nor"((int) (card)), "nor"((int) (row)))
+#else
+#define PROBE_SEMAPHORE(name) extern int a3_probe_##name
+#define PROBE_ENABLED(name) 0
+#define PROBE(name, player, card, row) ((void) 0)
+#endif
+
+PROBE_SEMAPHORE(game_start);
+PROBE_SEMAPHORE(choosing_start);
+PROBE_SEMAPHORE(choosing_end);
+PROBE_SEMAPHORE(swap_start);
+PROBE_SEMAPHORE(swap_end);
+PROBE_SEMAPHORE(action_start);
+PROBE_SEMAPHORE(action_end);
+PROBE_SEMAPHORE(command_accepted);
+PROBE_SEMAPHORE(command_rejected);
+PROBE_SEMAPHORE(score);
+
 int parseConfigFile(char *file_name, Card **total_cards, Game *game);
 
 int checkMagicNumber(FILE *config_file, char *file_name);
@@ -66,1495 +1143,11997 @@ void insertCardSorted(Card **HEAD, Card *new_card);
 
 int runningGame(Player *players, Game *game);
 
-void printPlayerStatusInfo(Player *players);
+void gameFlowStart(GameFlow *flow, FILE *out, Player *players, Game *game, int simultaneous);
+
+void gameFlowNextRound(GameFlow *flow);
+
+int gameFlowChoose(GameFlow *flow, int player_index, int *numbers_entered, int *error, char *line);
+
+void gameFlowStartAction(GameFlow *flow);
+
+void gameFlowActionPrompt(GameFlow *flow);
+
+int gameFlowStep(GameFlow *flow, char *line);
+
+int runningGameWithInputs(Player *players, Game *game, char *input_names[]);
+
+int playerInputOpen(PlayerInput *input, const char *name);
+
+int playerInputRead(PlayerInput *input);
+
+int playerInputNext(PlayerInput *input, char *line);
+
+int gameFlowTurn(const GameFlow *flow);
+
+void gameFlowResume(GameFlow *flow);
+
+int gameFlowSnapshotCommand(GameFlow *flow, int player_index, char *line);
+
+int snapshotCapture(Snapshot *snapshot, Player *players, Game *game, Phase phase, int turn);
+
+int snapshotApply(const Snapshot *snapshot, Player *players, Game *game);
 
-int cardChoosingPhase(Player *players, Game *game);
+int snapshotPlace(const Snapshot *snapshot, int number);
+
+int snapshotColor(const Snapshot *snapshot, int number);
+
+void snapshotToPosition(const Snapshot *snapshot, Position *position, Deck *deck);
+
+int snapshotWrite(const Snapshot *snapshot, const char *file_name);
+
+int snapshotRead(Snapshot *snapshot, const char *file_name);
+
+void printPlayerStatusInfo(FILE *out, Player *players);
+
+void tuiStart(void);
+
+void tuiStop(void);
+
+void tuiReadSize(void);
+
+void tuiHandleResize(int signal_number);
+
+int tuiRedraw(void);
+
+uint64_t tuiCardsHash(const Card *cards, uint64_t seed);
+
+void tuiUpdateLine(int line_index, uint64_t hash, const char *label, const Card *cards);
+
+void tuiPrintStatus(const Player *player);
 
 int stringCompareCaseInsensitive(const char *string1, const char *string2);
 
 void removeCardFromHand(struct _Card_ **HEAD, Card *hand_card);
 
-void swapCardDeck(Player *players, Game *game);
+void swapCardDeck(FILE *out, Player *players, Game *game);
+
+int actionPhaseCommands(GameFlow *flow, char *string);
+
+void probeCommandArguments(const char *string, int *card, int *row);
+
+int handlePlaceCommand(FILE *out, Player *player, int player_index, Journal *journal, char **save);
 
-int actionPhase(Player *players, Game *game);
+int handleHelpCommand(const GameFlow *flow, char **save);
 
-int actionPhaseCommands(char *string, Player *player);
+int handleQuitCommand(FILE *out, char **save);
 
-int handlePlaceCommand(Player *player);
+int handleDiscardCommand(FILE *out, Player *player, int player_index, Journal *journal, char **save);
 
-int handleHelpCommand(void);
+int handleUndoCommand(FILE *out, Player *players, Journal *journal, char **save);
 
-int handleQuitCommand(void);
+int handleRedoCommand(FILE *out, Player *players, Journal *journal, char **save);
 
-int handleDiscardCommand(Player *player);
+int journalRecord(Journal *journal, const JournalEntry *entry);
 
-int cardChosingPhaseCommands(char *string);
+void journalStartTurn(Journal *journal);
 
-int placeCardInRow(int row, int number, Player *player);
+int journalUndo(Journal *journal, Player *players);
 
-int checkOutOfBound(int row);
+int journalRedo(Journal *journal, Player *players);
 
-int discardCard(char *strtok, Player *player);
+int cardChosingPhaseCommands(GameFlow *flow, int player_index, char *string);
+
+int placeCardInRow(FILE *out, int row, int number, Player *player, JournalEntry *entry);
+
+int checkOutOfBound(FILE *out, int row);
+
+int discardCard(FILE *out, char *strtok, Player *player, JournalEntry *entry);
 
 int checkIfCardsLeft(struct _Card_ *chosen_cards, struct _Card_ *hand_cards);
 
-void printPoints(Player *players, Game *game);
+void printPoints(FILE *out, Player *players, Game *game);
 
 FILE *openFile(const char *file_name);
 
-void printPlayerPoints(int player_index, int points);
+void printPlayerPoints(FILE *out, int player_index, int points);
 
 void updatePlayerPoints(Player *players, int player_index, int index_longest_row, int total_points, int *highest_score);
 
 void writePlayerPointsToFile(FILE *fp, int player_index, int points);
 
-void printResults(Player *players, Game *game, int highest_score, FILE *fp);
+void printResults(FILE *out, Player *players, Game *game, int highest_score, FILE *fp);
 
 int calculatePoints(int *counter, Card *temp, int total_points);
 
 void freeMemory(Game *game, Player *player, Card *card);
 
-size_t userInput(char **user_input);
+size_t userInput(char **user_input);
+
+void copyCardData(Card *source, Card *destination);
+
+void handleCardChoosingPrompt(FILE *out, int numbers_entered, int error, int player_index);
+
+int handleCardSelection(Player *player, Card **tmp, int *numbers_entered, int *error);
+
+int initializeGame(int argc, char *argv[]);
+
+void handleInvalidInput(Game *game, Player *players, Card *totalCards);
+
+Player *initializePlayers(Game *game);
+
+int colorPoints(char color);
+
+void cardSetAdd(CardSet *set, int number);
+
+void cardSetRemove(CardSet *set, int number);
+
+int cardSetContains(const CardSet *set, int number);
+
+int cardSetCount(const CardSet *set);
+
+int cardSetNext(const CardSet *set, int number);
+
+int bitSelect(uint64_t bits, int index);
+
+int cardSetSelect(const CardSet *set, int index);
+
+void positionFromPlayers(Position *position, Deck *deck, Player *players, Game *game, Phase phase, int turn);
+
+void settlePosition(Position *position);
+
+int generateMoves(const Position *position, Move *moves);
+
+void applyMove(Position *position, const Deck *deck, Move move);
+
+void positionMake(Position *position, const Deck *deck, Move move, JournalEntry *entry);
+
+void positionUnmake(Position *position, const JournalEntry *entry);
+
+int scorePosition(const Position *position, int player_index);
+
+int evaluatePosition(const Position *position);
+
+int searchTimeUp(Search *search);
+
+int searchNode(Search *search, Position *position, int depth, int alpha, int beta);
+
+int searchRoot(Search *search, Position *position, int depth, Move *best_move);
+
+void searchIterative(const Position *position, const Deck *deck, const Tablebase *tablebase, long milliseconds,
+                     SearchResult *result);
+
+int handleHintCommand(GameFlow *flow, int player_index, char **save);
+
+void printMove(FILE *out, Move move);
+
+int printHint(FILE *out, const Position *position, const Deck *deck, const Engine *engine, long milliseconds);
+
+int runTool(int argc, char *argv[]);
+
+int loadGame(char *file_name, Game **game, Player **players, Card **total_cards);
+
+int loadDeck(char *file_name, Position *position, Deck *deck);
+
+int countCards(Card *head);
+
+int copyCardList(Card *source, Card **destination);
+
+double secondsSince(const struct timespec *start);
+
+void passHandCards(Player *players, Game *game);
+
+int canPlaceCardInRow(Card *row, int number);
+
+void freePlayers(Player *players, Game *game);
+
+Player *copyPlayers(Player *players, Game *game);
+
+int positionsEqual(const Position *first, const Position *second);
+
+void perft(Position *position, const Deck *deck, int depth, PerftCounter *counter);
+
+int perftCheck(const Position *position, const Deck *deck, Player *players, Game *game, int depth,
+               PerftCounter *counter);
+
+int applyMoveToPlayers(Player *players, Game *game, const Position *position, Move move);
+
+int runPerftTool(int argc, char *argv[], const char *tool_usage);
+
+int colorIndex(char color);
+
+int mapFile(MappedFile *file, const char *file_name);
+
+void unmapFile(MappedFile *file);
+
+int tablebaseOpen(Tablebase *table, const char *file_name);
+
+void tablebaseClose(Tablebase *table);
+
+int tablebaseIndex(const Position *position, const Deck *deck, int player_index, const CardSet *cards);
+
+int tablebaseProbe(const Tablebase *table, const Position *position, const Deck *deck, int *value);
+
+void tablebaseSolveNode(const Position *position, const Deck *deck, int8_t *entry);
+
+void tablebaseSolveEntry(int index, int8_t *entry);
+
+int runTablebaseTool(int argc, char *argv[], const char *tool_usage);
+
+uint64_t randomNext(Random *random);
+
+int randomBelow(Random *random, int bound);
+
+int heuristicScore(const Position *position, const Deck *deck, int player_index);
+
+Move greedyMove(const Position *position, const Deck *deck, Random *random);
+
+int playoutGreedy(Position *position, const Deck *deck);
+
+Move rolloutMove(const Position *position, Random *random);
+
+double weightedScore(const Position *position, const Deck *deck, int player_index, const double *weights);
+
+Move weightedMove(const Position *position, const Deck *deck, const double *weights, Random *random);
+
+int rolloutBelow(uint64_t *bits, int bound);
+
+void rolloutPlace(RowState *rows, const Deck *deck, int card, uint64_t *bits);
+
+int playoutRandom(Position *position, const Deck *deck, Random *random);
+
+int bookKey(const CardSet *hand, const Deck *deck, uint64_t *key);
+
+int bookOpen(OpeningBook *book, const char *file_name);
+
+void bookClose(OpeningBook *book);
+
+int bookLookup(const OpeningBook *book, const Position *position, const Deck *deck, Move *move, int *value);
+
+void bookSimulateHand(const CardSet *hand, const Deck *deck, int games, uint64_t seed, BookEntry *entry);
+
+int compareBookEntries(const void *first, const void *second);
+
+int runBookTool(int argc, char *argv[], const char *tool_usage);
+
+int cacheOpen(OutcomeCache *cache, const char *file_name);
+
+void cacheClose(OutcomeCache *cache);
+
+void cacheKey(uint64_t *key, CacheKind kind, const Position *position, const Deck *deck, const Policy *policies,
+              const AnalysisJob *job);
+
+int cacheLookup(const OutcomeCache *cache, const uint64_t *key, CacheValue *value);
+
+void cacheStore(const OutcomeCache *cache, const uint64_t *key, const CacheValue *value);
+
+void engineOpen(Engine *engine);
+
+void engineClose(Engine *engine);
+
+int parsePolicy(const char *text, Policy *policy);
+
+Move policyMove(const Policy *policy, const Position *position, const Deck *deck, const Engine *engine,
+                Random *random);
+
+int playGame(const Position *start, const Deck *deck, const Policy *policies, const Engine *engine, Random *random,
+             Position *final_position, TrajectoryRecord *records, int *record_count, GameRecord *game_record);
+
+void trajectoryRecord(TrajectoryRecord *record, const Position *position, Move move);
+
+int trajectoryOpen(TrajectoryWriter *writer, const char *file_name, const Deck *deck);
+
+void *trajectoryWriterThread(void *argument);
+
+void trajectoryAppend(TrajectoryWriter *writer, const TrajectoryRecord *records, int count, int games);
+
+int trajectoryClose(TrajectoryWriter *writer);
+
+int64_t dealHash(const Position *start, const Deck *deck);
+
+int storeOpen(StoreWriter *writer, const char *file_name);
+
+int storeColumnWidth(int column);
+
+int64_t gameRecordValue(const GameRecord *record, int column);
+
+int storeFlush(StoreWriter *writer);
+
+int storeAppend(StoreWriter *writer, const GameRecord *games, int count);
+
+int storeClose(StoreWriter *writer);
+
+void gameStatsAdd(GameStats *stats, const Position *final_position);
+
+void gameStatsMerge(GameStats *stats, const GameStats *other);
+
+double gameStatsDeviation(double sum, double squares, long count);
+
+double gameStatsWinWidth(const GameStats *stats);
+
+void *analysisWorker(void *argument);
+
+void analysisEmit(AnalysisJob *job, const AnalysisBatch *batch);
+
+int runAnalyzeTool(int argc, char *argv[], const char *tool_usage);
+
+void printAnalysis(const GameStats *stats);
+
+int64_t storeValue(const StoreBlockHeader *block, int column, uint32_t game);
+
+int storeBlockValid(const StoreBlockHeader *block, size_t size);
+
+QueryTotals *queryGroupsFind(QueryGroups *groups, int64_t deal);
+
+void queryTotalsMerge(QueryTotals *totals, const QueryTotals *other);
+
+int queryBlock(const QueryJob *job, const StoreBlockHeader *block, QueryWorker *worker);
+
+void *queryWorker(void *argument);
+
+int compareQueryTotals(const void *first, const void *second);
+
+void printQueryTotals(const QueryTotals *totals, QueryMeasure measure);
+
+int runQueryTool(int argc, char *argv[], const char *tool_usage);
+
+void archiveFrequenciesInit(ArchiveFrequencies *frequencies, int count);
+
+void archiveFrequenciesUpdate(ArchiveFrequencies *frequencies, int symbol, int count);
+
+void archiveModelInit(ArchiveModel *model);
+
+void rangeEncoderInit(RangeEncoder *encoder);
+
+void rangeShiftLow(RangeEncoder *encoder);
+
+void rangeEncodeSymbol(RangeEncoder *encoder, ArchiveFrequencies *frequencies, int count, int symbol);
+
+void rangeEncoderFinish(RangeEncoder *encoder);
+
+void rangeDecoderInit(RangeDecoder *decoder, const uint8_t *data, size_t size);
+
+uint8_t rangeNextByte(RangeDecoder *decoder);
+
+int rangeDecodeSymbol(RangeDecoder *decoder, ArchiveFrequencies *frequencies, int count);
+
+int archiveRankMoves(const Position *position, const Deck *deck, Move *moves);
+
+int archiveRankGame(const Position *start, const Deck *deck, const TrajectoryRecord *records, int count,
+                    ArchiveRank *ranks);
+
+void archiveDeckFrom(ArchiveDeck *entry, const Position *start, const Deck *deck);
+
+void archiveDeckStart(const ArchiveDeck *entry, Position *start, Deck *deck);
+
+int archiveOpen(ArchiveWriter *archive, const char *file_name);
+
+int archiveFlush(ArchiveWriter *archive);
+
+void archiveAppend(ArchiveWriter *archive, const ArchiveDeck *entry, const ArchiveRank *ranks, int count);
+
+int archiveClose(ArchiveWriter *archive);
+
+int runReplayTool(int argc, char *argv[], const char *tool_usage);
+
+int benchWriteConfig(char *file_name, int player_count, Random *random);
+
+int benchSetup(BenchContext *context);
+
+void benchTeardown(BenchContext *context);
+
+int benchParseConfig(BenchContext *context, long iterations);
+
+int benchInsertSorted(BenchContext *context, long iterations);
+
+int benchCardDistribution(BenchContext *context, long iterations);
+
+int benchPlaceCard(BenchContext *context, long iterations);
+
+int benchCalculatePoints(BenchContext *context, long iterations);
+
+int benchPrintPoints(BenchContext *context, long iterations);
+
+int benchPrintStatus(BenchContext *context, long iterations);
+
+int benchHeadlessGame(BenchContext *context, long iterations);
+
+int benchRandomRollout(BenchContext *context, long iterations);
+
+int benchMeasure(const Benchmark *benchmark, BenchContext *context, long iterations, double *seconds);
+
+int compareDoubles(const void *first, const void *second);
+
+double benchMedian(double *values, int count);
+
+int runBenchTool(int argc, char *argv[], const char *tool_usage);
+
+void instrumentStart(void);
+
+void instrumentBegin(InstrumentTimer timer);
+
+void instrumentEnd(InstrumentTimer timer);
+
+void instrumentCommandBegin(const char *line);
+
+void instrumentCommandEnd(void);
+
+void instrumentReject(void);
+
+int instrumentBucket(double microseconds);
+
+long instrumentQuantile(const unsigned long *buckets, double quantile);
+
+void instrumentDump(void);
+
+void accountStart(void);
+
+AccountThread *accountThread(void);
+
+void accountPhase(AccountPhase phase);
+
+AccountSite *accountSite(AccountSite *sites, AccountSite *other_sites, const char *file, int line);
+
+void accountRecord(AccountHeader *header, size_t size, const char *file, int line);
+
+void accountRelease(const AccountHeader *header);
+
+void *accountMalloc(size_t size, const char *file, int line);
+
+void *accountCalloc(size_t count, size_t size, const char *file, int line);
+
+void *accountRealloc(void *pointer, size_t size, const char *file, int line);
+
+void accountFree(void *pointer);
+
+void accountDump(void);
+
+int compareAccountSites(const void *first, const void *second);
+
+int deckGeneratorInit(DeckGenerator *generator, uint64_t seed, const char *colors);
+
+void deckGenerate(const DeckGenerator *generator, uint64_t index, GeneratedDeck *generated);
+
+void deckStart(const GeneratedDeck *generated, Position *start, Deck *deck);
+
+int deckWrite(const GeneratedDeck *generated, const char *file_name);
+
+int deckFormat(const GeneratedDeck *generated, char *line);
+
+void *deckWorker(void *argument);
+
+int runDeckTool(int argc, char *argv[], const char *tool_usage);
+
+int wideSetOpen(WideCardSet *set, int cards);
+
+void wideSetClose(WideCardSet *set);
+
+void wideSetUpdate(WideCardSet *set, int word, int amount);
+
+void wideSetAdd(WideCardSet *set, int number);
+
+void wideSetRemove(WideCardSet *set, int number);
+
+int wideSetContains(const WideCardSet *set, int number);
+
+int wideSetSelect(const WideCardSet *set, int index);
+
+int wideSetRank(const WideCardSet *set, int number);
+
+int stressRowsOpen(StressRows *rows, int row_count, int cards);
+
+void stressRowsClose(StressRows *rows);
+
+int stressPlace(StressRows *rows, int *row_of_card, int card, char color, Random *random);
+
+long stressScore(const StressRows *rows);
+
+int runStressTool(int argc, char *argv[], const char *tool_usage);
+
+int taskQueuePop(Tournament *tournament, int queue_index, TournamentTask *task);
+
+int taskQueueSteal(Tournament *tournament, int queue_index, int victim_index);
+
+void tournamentResult(GameStats *stats, int margin);
+
+void *tournamentWorker(void *argument);
+
+void tournamentTasks(TournamentTask *tasks, int deck_count, int policy_count, long games);
+
+long tournamentPlay(Tournament *tournament, TournamentWorker *workers, long threads, long task_count,
+                    int policy_count);
+
+int tournamentLoadPolicies(const char *file_name, Policy *policies, char names[][TOURNAMENT_NAME_SIZE], int *count);
+
+int compareFileNames(const void *first, const void *second);
+
+int tournamentLoadDecks(const char *directory_name, Position **starts, Deck **decks, int *count);
+
+void printTournament(GameStats results[][TOURNAMENT_MAX_POLICIES], char names[][TOURNAMENT_NAME_SIZE], int count);
+
+int runTournamentTool(int argc, char *argv[], const char *tool_usage);
+
+void tuneDecks(const DeckGenerator *generator, uint64_t first_index, int count, Position *starts, Deck *decks);
+
+void printWeights(const char *label, const double *weights);
+
+int runTuneTool(int argc, char *argv[], const char *tool_usage);
+
+int sessionLine(Session *session, ServerMetrics *metrics, char *line);
+
+int sessionRead(Session *session, ServerMetrics *metrics);
+
+void sessionQueue(Session *session, char *text, size_t length);
+
+int sessionSend(Session *session);
+
+void sessionClose(Server *server, ServerMetrics *metrics, Session *session);
+
+void sessionEvent(Server *server, ServerMetrics *metrics, Session *session, uint32_t events);
+
+void serverAccept(Server *server, ServerMetrics *metrics);
+
+void *serverWorker(void *argument);
+
+void metricsAdd(_Atomic unsigned long *counter, unsigned long amount);
+
+int metricsScrape(MetricsExporter *exporter);
+
+int metricsFailed(MetricsExporter *exporter);
+
+void *metricsWorker(void *argument);
+
+int serverOpen(Server *server, const char *socket_path);
+
+int runServeTool(int argc, char *argv[], const char *tool_usage);
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Entry and exitpoint of my program.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+///
+/// @return exit code 0(success) - 4
+//
+int main(int argc, char *argv[])
+{
+  ACCOUNT_START();
+  if (argc >= 2 && strncmp(argv[1], "--", 2) == 0)
+  {
+    return runTool(argc, argv);
+  }
+  INSTRUMENT_START();
+  return initializeGame(argc, argv);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Creates and initializes two structs and passes them on. Handles different return values from other functions and
+/// frees allocated memory accordingly.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+///
+/// @return exit code 0(success) - 4
+//
+int initializeGame(int argc, char *argv[])
+{
+  Game *game = ACCOUNT_MALLOC(sizeof(Game));
+  if (game == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+
+  int with_inputs = argc >= 4 && strcmp(argv[2], "--inputs") == 0;
+  if (argc != 2 && !with_inputs)
+  {
+    printf("Usage: ./a3 <config file>\n");
+    handleInvalidInput(game, NULL, NULL);
+    return 1;
+  }
+  Card *totalCards;
+  INSTRUMENT_BEGIN(INSTRUMENT_PARSE);
+  int result = parseConfigFile(argv[1], &totalCards, game);
+  INSTRUMENT_END(INSTRUMENT_PARSE);
+  if (result != 0)
+  {
+    handleInvalidInput(game, NULL, NULL);
+    return result;
+  }
+  PROBE(game_start, -1, 0, 0);
+  if (with_inputs && argc - 3 != game->amount_of_players_)
+  {
+    printf("Usage: ./a3 <config file> --inputs <input of player 1> ... <input of player %d>\n",
+           game->amount_of_players_);
+    handleInvalidInput(game, NULL, totalCards);
+    return 1;
+  }
+
+  tuiStart();
+  printf("Welcome to SyntaxSakura (%d players are playing)!\n", game->amount_of_players_);
+
+  Player *players = initializePlayers(game);
+  if (players == NULL)
+  {
+    handleInvalidInput(game, players, totalCards);
+    return OUT_OF_MEMORY;
+  }
+
+  INSTRUMENT_BEGIN(INSTRUMENT_DISTRIBUTION);
+  result = cardDistribution(players, totalCards, game);
+  INSTRUMENT_END(INSTRUMENT_DISTRIBUTION);
+  if (result == OUT_OF_MEMORY)
+  {
+    handleInvalidInput(game, players, totalCards);
+    return OUT_OF_MEMORY;
+  }
+
+  result = with_inputs ? runningGameWithInputs(players, game, argv + 3) : runningGame(players, game);
+  if (result != 0)
+  {
+    handleInvalidInput(game, players, totalCards);
+    return result;
+  }
+
+  freeMemory(game, players, totalCards);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function gets called when a user inputs wrong values. And calls the freeMemory function.
+/// This function saves a lot of lines in my programm.
+///
+/// @param game strcut game(holds all important values for the game)
+/// @param players array of struct Player
+/// @param totalCards linked list of all the cards parsed from config file.
+///
+/// @return void
+//
+void handleInvalidInput(Game *game, Player *players, Card *totalCards)
+{
+  freeMemory(game, players, totalCards);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Initializes and creates struct Player dinamically. If memory runs out, only the memory allocated here is freed;
+/// the game and the card list stay with the caller.
+///
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return players array of struct Player or NULL if out of memory
+//
+Player *initializePlayers(Game *game)
+{
+  Player *players = ACCOUNT_MALLOC(sizeof(Player) * game->amount_of_players_);
+  if (players == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return NULL;
+  }
+
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  {
+    players[player_index].index = player_index;
+    players[player_index].hand_cards_ = NULL;
+    players[player_index].chosen_cards_ = NULL;
+    players[player_index].row_ = ACCOUNT_MALLOC(sizeof(Card) * MAX_ROW);
+    if (players[player_index].row_ == NULL)
+    {
+      printf("Error: Out of memory\n");
+      for (int freed_index = 0; freed_index < player_index; ++freed_index)
+      {
+        ACCOUNT_FREE(players[freed_index].row_);
+      }
+      ACCOUNT_FREE(players);
+      return NULL;
+    }
+    for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+    {
+      players[player_index].row_[row_index] = NULL;
+    }
+  }
+
+  return players;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Gets called at the end or when a memory alloc happens to clear all allocated memory to avoid memory leaks.
+///
+/// @param game struct Game(holds all important values for the game)
+/// @param players array of struct Player (NULL if the players were not created yet)
+/// @param totalCards linked list of all the cards parsed from config file (NULL if the config file was not parsed, the
+///                   file name of the game is freed with it)
+///
+/// @return void
+//
+void freeMemory(Game *game, Player *player, Card *card)
+{
+  if (player != NULL)
+  {
+    freePlayers(player, game);
+  }
+  if (card != NULL)
+  {
+    freeCardList(card);
+    ACCOUNT_FREE(game->file_name_);
+  }
+  ACCOUNT_FREE(game);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Frees the card lists of all players and the player array itself.
+///
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return void
+//
+void freePlayers(Player *players, Game *game)
+{
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  {
+    freeCardList(players[player_index].chosen_cards_);
+    freeCardList(players[player_index].hand_cards_);
+    if (players[player_index].row_ != NULL)
+    {
+      for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+      {
+        freeCardList(players[player_index].row_[row_index]);
+      }
+    }
+    ACCOUNT_FREE(players[player_index].row_);
+  }
+  ACCOUNT_FREE(players);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens and reads the config file and parses all cards, amount of players and magic number.
+///
+/// @param file_name string of the entered file name
+/// @param totalCards linked list of all the cards parsed from config file
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return int read successfully(0) or not(-1, 2, 4)
+//
+int parseConfigFile(char *file_name, Card **total_cards, Game *game)
+{
+  int confirmation;
+  int people;
+  int cards = 0;
+  FILE *config_file = fopen(file_name, "r");
+
+  if (config_file == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    return 2;
+  }
+
+  confirmation = checkMagicNumber(config_file, file_name);
+  if (confirmation != 0)
+  {
+    fclose(config_file);
+    return confirmation;
+  }
+
+  people = getNumberOfPlayer(config_file);
+
+  Card *current = NULL;
+
+  while (feof(config_file) == 0 && cards <= (people * MAX_CARD_PER_PLAYER))
+  {
+    Card *new_card = ACCOUNT_MALLOC(sizeof(Card));
+    if (new_card == NULL)
+    {
+      printf("Error: Out of memory\n");
+      freeCardList(*total_cards);
+      fclose(config_file);
+      return OUT_OF_MEMORY;
+    }
+
+    fscanf(config_file, "%d_%s", &new_card->number_, &new_card->color_);
+    new_card->next_ = NULL;
+
+    if (current == NULL)
+    {
+      *total_cards = new_card;
+      current = new_card;
+    }
+    else
+    {
+      current->next_ = new_card;
+      current = new_card;
+    }
+    cards++;
+  }
+  game->amount_of_cards_ = cards;
+  game->amount_of_players_ = people;
+  game->file_name_ = ACCOUNT_MALLOC(sizeof(char) * (strlen(file_name) + 1));
+  if (game->file_name_ == NULL)
+  {
+    printf("Error: Out of memory\n");
+    freeCardList(*total_cards);
+    fclose(config_file);
+    return OUT_OF_MEMORY;
+  }
+  strcpy(game->file_name_, file_name);
+  fclose(config_file);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the amount of players from file
+///
+/// @param config_file File pointer
+///
+/// @return read successfully(number players) or not(-1)
+//
+int getNumberOfPlayer(FILE *config_file)
+{
+  int input;
+  if (fscanf(config_file, "%d", &input) != 1)
+  {
+    return -1;
+  }
+  return input;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the magic number from file and compares it to the preset one.
+///
+/// @param config_file File pointer
+/// @param file_name string of the entered file name
+///
+/// @return int correct magic number(0) or not(2 , 3)
+//
+int checkMagicNumber(FILE *config_file, char *file_name)
+{
+  char buffer[BUFFER_SIZE];
+  if (fgets(buffer, BUFFER_SIZE, config_file) == NULL)
+  {
+    printf("Error while reading the File");
+    return 2;
+  }
+
+  if (strcmp(buffer, "ESP\n") != 0)
+  {
+    printf("Error: Invalid file: %s\n", file_name);
+    return 3;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function can free any linked list used in my program.
+///
+/// @param head The pointer to the first card in my linked list.
+///
+/// @return void
+//
+void freeCardList(Card *head)
+{
+  while (head != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    Card *temp = head;
+    head = head->next_;
+    ACCOUNT_FREE(temp);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This distributes card to all players. Each player gets 1 Card each Round.
+///
+/// @param players array of struct Players
+/// @param totalCards linked list of all the cards parsed from config file
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return success(0) or error(4)
+//
+int cardDistribution(Player *players, Card *total_cards, Game *game)
+{
+  Card *temp = total_cards;
+  int people_index = 0;
+  int rounds;
+  rounds = (game->amount_of_cards_ / game->amount_of_players_) * 2;
+  int card_inserted = 0;
+  while (temp != NULL && rounds > 0)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    Card *new_card = ACCOUNT_MALLOC(sizeof(Card));
+    if (new_card == NULL)
+    {
+      printf("Error: Out of memory\n");
+      return OUT_OF_MEMORY;
+    }
+    new_card->next_ = NULL;
+    new_card->number_ = temp->number_;
+    new_card->color_ = temp->color_;
+
+    if (card_inserted == rounds)
+    {
+      people_index = (people_index + 1) % game->amount_of_players_;
+    }
+
+    insertCardSorted(&(players[people_index].hand_cards_), new_card);
+    temp = temp->next_;
+    rounds--;
+    card_inserted++;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function inserts a struct Card into a already existing linked list. Furthermore the card gets inserted sorted.
+///
+/// @param HEAD Pointer-Pointer to the first card in linked list.
+/// @param new_card pointer to a struct card that should be inserted into the linked list.
+///
+/// @return void
+//
+void insertCardSorted(Card **HEAD, Card *new_card)
+{
+  if (*HEAD == NULL || new_card->number_ <= (*HEAD)->number_)
+  {
+    new_card->next_ = *HEAD;
+    *HEAD = new_card;
+  }
+  else
+  {
+    Card *temp = *HEAD;
+    while (temp->next_ != NULL && temp->next_->number_ < new_card->number_)
+    {
+      INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+      temp = temp->next_;
+    }
+    new_card->next_ = temp->next_;
+    temp->next_ = new_card;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function runs the game on the terminal: it feeds every input line into the state machine of the game until
+/// the game is over, a player quits or the input ends.
+///
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return success(0) or OUT_OF_MEMORY
+//
+int runningGame(Player *players, Game *game)
+{
+  GameFlow flow;
+  char *input_buffer = NULL;
+
+  gameFlowStart(&flow, stdout, players, game, 0);
+  while (flow.phase_ != PHASE_OVER)
+  {
+    if (userInput(&input_buffer) == (size_t) ERROR)
+    {
+      break;
+    }
+    INSTRUMENT_COMMAND_BEGIN(input_buffer);
+    gameFlowStep(&flow, input_buffer);
+    INSTRUMENT_COMMAND_END();
+  }
+  ACCOUNT_FREE(input_buffer);
+  ACCOUNT_FREE(flow.journal_.entries_);
+  return flow.result_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Starts the state machine of a game and prints everything up to the first prompt. The game opens its own engine for
+/// every hint and has the commands save and load; the server changes that for its games (engine_ and served_).
+///
+/// @param flow state machine to start
+/// @param out stream the game prints to
+/// @param players array of struct Player (dealt)
+/// @param game struct Game(holds all important values for the game)
+/// @param simultaneous 1 if all players choose their cards at the same time (see gameFlowChoose), 0 otherwise
+///
+/// @return void
+//
+void gameFlowStart(GameFlow *flow, FILE *out, Player *players, Game *game, int simultaneous)
+{
+  flow->players_ = players;
+  flow->game_ = game;
+  flow->out_ = out;
+  flow->result_ = 0;
+  flow->simultaneous_ = simultaneous;
+  flow->served_ = 0;
+  flow->completed_ = 0;
+  flow->rejected_ = 0;
+  flow->engine_ = NULL;
+  memset(&flow->journal_, 0, sizeof(Journal));
+  gameFlowNextRound(flow);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Starts the card choosing phase of the next round, or prints the points if no player has cards left. If the players
+/// choose at the same time, every player gets their status and prompt right away.
+///
+/// @param flow state machine of the game
+///
+/// @return void
+//
+void gameFlowNextRound(GameFlow *flow)
+{
+  int cards_left = 0;
+  for (int player_index = 0; player_index < flow->game_->amount_of_players_; ++player_index)
+  {
+    cards_left += checkIfCardsLeft(flow->players_[player_index].chosen_cards_,
+                                   flow->players_[player_index].hand_cards_);
+  }
+  if (cards_left == 0)
+  {
+    ACCOUNT_PHASE(ACCOUNT_END);
+    INSTRUMENT_BEGIN(INSTRUMENT_POINTS);
+    printPoints(flow->out_, flow->players_, flow->game_);
+    INSTRUMENT_END(INSTRUMENT_POINTS);
+    flow->phase_ = PHASE_OVER;
+    flow->completed_ = 1;
+    return;
+  }
+
+  fprintf(flow->out_, "\n-------------------\n"
+                      "CARD CHOOSING PHASE\n"
+                      "-------------------\n");
+  ACCOUNT_PHASE(ACCOUNT_CHOOSING);
+  INSTRUMENT_BEGIN(INSTRUMENT_CHOOSING);
+  PROBE(choosing_start, -1, 0, 0);
+  flow->phase_ = PHASE_CHOOSING;
+  flow->player_index_ = 0;
+  flow->numbers_entered_ = 0;
+  flow->error_ = 0;
+  for (int player_index = 0; player_index < (flow->simultaneous_ ? flow->game_->amount_of_players_ : 1);
+       ++player_index)
+  {
+    printPlayerStatusInfo(flow->out_, &flow->players_[player_index]);
+    handleCardChoosingPrompt(flow->out_, 0, 0, player_index);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Handles one input line of a player in the card choosing phase and prints the next prompt of this player while they
+/// still have to choose. The progress of the player is passed in, so the players can also choose at the same time.
+///
+/// @param flow state machine of the game
+/// @param player_index Array-index of the choosing player
+/// @param numbers_entered how many cards the player already chose (updated)
+/// @param error whether the last input of the player was invalid (updated)
+/// @param line input line without the line break (modified)
+///
+/// @return 1 if the game is over (a player quit or out of memory), 0 otherwise
+//
+int gameFlowChoose(GameFlow *flow, int player_index, int *numbers_entered, int *error, char *line)
+{
+  Player *player = &flow->players_[player_index];
+  int result = cardChosingPhaseCommands(flow, player_index, line);
+
+  if (result == QUIT_GAME)
+  {
+    flow->phase_ = PHASE_OVER;
+    return 1;
+  }
+  if (result == HINT_SHOWN)
+  {
+    fprintf(flow->out_, "P%d > ", player_index + 1);
+    return 0;
+  }
+  if (result == ERROR)
+  {
+    INSTRUMENT_REJECT();
+    flow->rejected_++;
+    fprintf(flow->out_, "P%d > ", player_index + 1);
+    *error = 1;
+    return 0;
+  }
+
+  Card *card = player->hand_cards_;
+  while (card != NULL && card->number_ != result)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    card = card->next_;
+  }
+  if (card == NULL)
+  {
+    INSTRUMENT_REJECT();
+    flow->rejected_++;
+    *error = 1;
+  }
+  else if (handleCardSelection(player, &card, numbers_entered, error) == OUT_OF_MEMORY)
+  {
+    flow->result_ = OUT_OF_MEMORY;
+    flow->phase_ = PHASE_OVER;
+    return 1;
+  }
+
+  if (*numbers_entered < 2)
+  {
+    handleCardChoosingPrompt(flow->out_, *numbers_entered, *error, player_index);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Ends the card choosing phase once every player chose: passes the hand cards on and starts the action phase.
+///
+/// @param flow state machine of the game
+///
+/// @return void
+//
+void gameFlowStartAction(GameFlow *flow)
+{
+  INSTRUMENT_END(INSTRUMENT_CHOOSING);
+  PROBE(choosing_end, -1, 0, 0);
+  ACCOUNT_PHASE(ACCOUNT_ACTION);
+  INSTRUMENT_BEGIN(INSTRUMENT_ACTION);
+  PROBE(swap_start, -1, 0, 0);
+  swapCardDeck(flow->out_, flow->players_, flow->game_);
+  PROBE(swap_end, -1, 0, 0);
+  fprintf(flow->out_, "------------\n"
+                      "ACTION PHASE\n"
+                      "------------\n");
+  flow->phase_ = PHASE_ACTION;
+  flow->player_index_ = 0;
+  journalStartTurn(&flow->journal_);
+  PROBE(action_start, -1, 0, 0);
+  gameFlowActionPrompt(flow);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Prints the next prompt of the action phase. Players without chosen cards are skipped; after the last player the
+/// next round starts.
+///
+/// @param flow state machine of the game
+///
+/// @return void
+//
+void gameFlowActionPrompt(GameFlow *flow)
+{
+  while (flow->player_index_ < flow->game_->amount_of_players_)
+  {
+    Player *player = &flow->players_[flow->player_index_];
+    if (checkIfCardsLeft(player->chosen_cards_, NULL) == 1)
+    {
+      printPlayerStatusInfo(flow->out_, player);
+      fprintf(flow->out_, "What do you want to do?\n"
+                          "P%d > ", flow->player_index_ + 1);
+      return;
+    }
+    printPlayerStatusInfo(flow->out_, player);
+    flow->player_index_++;
+    journalStartTurn(&flow->journal_);
+  }
+  INSTRUMENT_END(INSTRUMENT_ACTION);
+  PROBE(action_end, -1, 0, 0);
+  fprintf(flow->out_, "\n"
+                      "Action phase is over - starting next game round!\n");
+  gameFlowNextRound(flow);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Feeds one input line into the state machine of a game: handles the command of the player whose turn it is and
+/// prints its output and the next prompt. The game can be suspended between any two calls. Players that choose at the
+/// same time are fed with gameFlowSnapshotCommand and gameFlowChoose instead.
+///
+/// @param flow state machine of the game
+/// @param line input line without the line break (modified)
+///
+/// @return 1 if the game is over (points printed, a player quit or out of memory), 0 otherwise
+//
+int gameFlowStep(GameFlow *flow, char *line)
+{
+  int player_index = flow->player_index_;
+  int result;
+
+  if (gameFlowSnapshotCommand(flow, player_index, line) != 0)
+  {
+    return flow->phase_ == PHASE_OVER;
+  }
+  if (flow->phase_ == PHASE_CHOOSING)
+  {
+    if (gameFlowChoose(flow, player_index, &flow->numbers_entered_, &flow->error_, line) == 1)
+    {
+      return 1;
+    }
+    if (flow->numbers_entered_ < 2)
+    {
+      return 0;
+    }
+    if (++flow->player_index_ < flow->game_->amount_of_players_)
+    {
+      flow->numbers_entered_ = 0;
+      printPlayerStatusInfo(flow->out_, &flow->players_[flow->player_index_]);
+      handleCardChoosingPrompt(flow->out_, 0, flow->error_, flow->player_index_);
+    }
+    else
+    {
+      gameFlowStartAction(flow);
+    }
+  }
+  else if (flow->phase_ == PHASE_ACTION)
+  {
+    result = actionPhaseCommands(flow, line);
+    if (result == 1 || result == OUT_OF_MEMORY)
+    {
+      flow->result_ = result == OUT_OF_MEMORY ? OUT_OF_MEMORY : 0;
+      flow->phase_ = PHASE_OVER;
+      return 1;
+    }
+    if (result == ERROR)
+    {
+      INSTRUMENT_REJECT();
+      flow->rejected_++;
+      fprintf(flow->out_, "P%d > ", player_index + 1);
+      return 0;
+    }
+    gameFlowActionPrompt(flow);
+  }
+  return flow->phase_ == PHASE_OVER;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function runs the game with one input per player ("./a3 <config file> --inputs <input P1> <input P2>"): all
+/// players choose their cards at the same time, the choices are collected with poll and the hand cards are passed on
+/// once every player chose. In the action phase only the input of the player whose turn it is is read. The output of
+/// the game stays on the standard output.
+///
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+/// @param input_names one input per player: a FIFO, a terminal or another file, or the number of an open file
+///                    descriptor (e.g. a socket)
+///
+/// @return success(0), 2 if an input cannot be opened or OUT_OF_MEMORY
+//
+int runningGameWithInputs(Player *players, Game *game, char *input_names[])
+{
+  int player_count = game->amount_of_players_;
+  PlayerInput *inputs = ACCOUNT_CALLOC((size_t) player_count, sizeof(PlayerInput));
+  struct pollfd *polls = ACCOUNT_CALLOC((size_t) player_count, sizeof(struct pollfd));
+  char line[PLAYER_INPUT_SIZE];
+  GameFlow flow;
+  int result = 0;
+
+  memset(&flow.journal_, 0, sizeof(Journal));
+  if (inputs == NULL || polls == NULL)
+  {
+    printf("Error: Out of memory\n");
+    ACCOUNT_FREE(inputs);
+    ACCOUNT_FREE(polls);
+    return OUT_OF_MEMORY;
+  }
+  for (int player_index = 0; player_index < player_count; ++player_index)
+  {
+    inputs[player_index].fd_ = -1;
+  }
+  for (int player_index = 0; player_index < player_count && result == 0; ++player_index)
+  {
+    if (playerInputOpen(&inputs[player_index], input_names[player_index]) != 0)
+    {
+      printf("Error: Cannot open file: %s\n", input_names[player_index]);
+      result = 2;
+    }
+  }
+
+  if (result == 0)
+  {
+    gameFlowStart(&flow, stdout, players, game, 1);
+  }
+  while (result == 0 && flow.phase_ != PHASE_OVER)
+  {
+    if (flow.phase_ == PHASE_ACTION)
+    {
+      PlayerInput *input = &inputs[flow.player_index_];
+      if (playerInputNext(input, line))
+      {
+        INSTRUMENT_COMMAND_BEGIN(line);
+        gameFlowStep(&flow, line);
+        INSTRUMENT_COMMAND_END();
+        continue;
+      }
+      fflush(stdout);
+      if (playerInputRead(input) != 0)
+      {
+        break;
+      }
+      continue;
+    }
+
+    int choosing = 0;
+    for (int player_index = 0; player_index < player_count && flow.phase_ == PHASE_CHOOSING; ++player_index)
+    {
+      PlayerInput *input = &inputs[player_index];
+      input->numbers_entered_ = countCards(players[player_index].chosen_cards_);
+      while (input->numbers_entered_ < 2 && playerInputNext(input, line))
+      {
+        INSTRUMENT_COMMAND_BEGIN(line);
+        if (gameFlowSnapshotCommand(&flow, player_index, line) == 0)
+        {
+          gameFlowChoose(&flow, player_index, &input->numbers_entered_, &input->error_, line);
+        }
+        INSTRUMENT_COMMAND_END();
+        if (flow.phase_ != PHASE_CHOOSING)
+        {
+          break;
+        }
+        input->numbers_entered_ = countCards(players[player_index].chosen_cards_);
+      }
+      if (input->numbers_entered_ < 2)
+      {
+        polls[choosing].fd = input->fd_;
+        polls[choosing].events = POLLIN;
+        polls[choosing].revents = 0;
+        choosing++;
+      }
+    }
+    if (flow.phase_ != PHASE_CHOOSING)
+    {
+      continue;
+    }
+    if (choosing == 0)
+    {
+      for (int player_index = 0; player_index < player_count; ++player_index)
+      {
+        inputs[player_index].error_ = 0;
+      }
+      gameFlowStartAction(&flow);
+      continue;
+    }
+
+    fflush(stdout);
+    if (poll(polls, (nfds_t) choosing, -1) < 0 && errno != EINTR)
+    {
+      break;
+    }
+    for (int player_index = 0; player_index < player_count; ++player_index)
+    {
+      for (int poll_index = 0; poll_index < choosing; ++poll_index)
+      {
+        if (polls[poll_index].fd == inputs[player_index].fd_ && polls[poll_index].revents != 0 &&
+            playerInputRead(&inputs[player_index]) != 0)
+        {
+          flow.phase_ = PHASE_OVER;
+        }
+      }
+    }
+  }
+
+  for (int player_index = 0; player_index < player_count; ++player_index)
+  {
+    if (inputs[player_index].fd_ > STDERR_FILENO)
+    {
+      close(inputs[player_index].fd_);
+    }
+  }
+  ACCOUNT_FREE(inputs);
+  ACCOUNT_FREE(polls);
+  ACCOUNT_FREE(flow.journal_.entries_);
+  return result != 0 ? result : flow.result_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens the input of a player: a file name (FIFO, terminal, ...) or the number of an already open file descriptor.
+///
+/// @param input input to open
+/// @param name file name or file descriptor number
+///
+/// @return success(0) or ERROR
+//
+int playerInputOpen(PlayerInput *input, const char *name)
+{
+  char *endptr;
+  long fd = strtol(name, &endptr, 10);
+
+  if (*name != '\0' && *endptr == '\0')
+  {
+    input->fd_ = fd >= 0 && fcntl((int) fd, F_GETFD) != -1 ? (int) fd : -1;
+  }
+  else
+  {
+    input->fd_ = open(name, O_RDONLY);
+  }
+  return input->fd_ < 0 ? ERROR : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the available input of a player into the line buffer.
+///
+/// @param input input of the player
+///
+/// @return 0 on success, ERROR at the end of the input
+//
+int playerInputRead(PlayerInput *input)
+{
+  if (input->length_ == PLAYER_INPUT_SIZE)
+  {
+    return 0;
+  }
+  ssize_t count = read(input->fd_, input->buffer_ + input->length_, PLAYER_INPUT_SIZE - input->length_);
+  if (count < 0 && errno == EINTR)
+  {
+    return 0;
+  }
+  if (count <= 0)
+  {
+    return ERROR;
+  }
+  input->length_ += (size_t) count;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Takes the next complete line out of the line buffer of a player. A line that fills the whole buffer is cut off.
+///
+/// @param input input of the player
+/// @param line receives the line without the line break (PLAYER_INPUT_SIZE bytes)
+///
+/// @return 1 if a line was taken, 0 if there is no complete line yet
+//
+int playerInputNext(PlayerInput *input, char *line)
+{
+  char *end = memchr(input->buffer_, '\n', input->length_);
+  size_t length = end != NULL ? (size_t) (end - input->buffer_) : input->length_;
+
+  if (end == NULL && input->length_ < PLAYER_INPUT_SIZE)
+  {
+    return 0;
+  }
+  if (length == PLAYER_INPUT_SIZE)
+  {
+    length--;
+  }
+  memcpy(line, input->buffer_, length);
+  line[length] = '\0';
+  size_t consumed = end != NULL ? length + 1 : length;
+  input->length_ -= consumed;
+  memmove(input->buffer_, input->buffer_ + consumed, input->length_);
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function calls opens the config file, calculates points and print functions for the end points.
+///
+/// @param out stream to print to
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game, no results are written without a file name)
+///
+/// @return void
+//
+void printPoints(FILE *out, Player *players, Game *game)
+{
+  int index_longest_row = 0;
+  int index_longest_row2 = 0;
+  int row_index;
+  int total_points;
+  int highest_score = 0;
+  int counter = 0;
+  Card *temp;
+  FILE *fp;
+
+  fp = game->file_name_ != NULL ? openFile(game->file_name_) : NULL;
+
+  fprintf(out, "\n");
+
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  {
+    row_index = 0;
+    total_points = 0;
+    temp = players[player_index].row_[row_index];
+
+    while (row_index < MAX_ROW)
+    {
+      if (temp != NULL)
+      {
+        counter = 0;
+        total_points = calculatePoints(&counter, temp, total_points);
+
+        if (counter > index_longest_row2)
+        {
+          index_longest_row = row_index;
+          index_longest_row2 = counter;
+        }
+      }
+      row_index++;
+      temp = players[player_index].row_[row_index];
+    }
+
+    updatePlayerPoints(players, player_index, index_longest_row, total_points, &highest_score);
+    PROBE(score, player_index, players[player_index].player_points_, index_longest_row + 1);
+  }
+
+  printResults(out, players, game, highest_score, fp);
+
+  if (fp == NULL && game->file_name_ != NULL)
+  {
+    fprintf(out, "Warning: Results not written to file!\n");
+  }
+  if (fp != NULL)
+  {
+    fclose(fp);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function opens the file it receives.
+///
+/// @param file_name string of the entered file name
+///
+/// @return File pointer
+//
+FILE *openFile(const char *file_name)
+{
+  FILE *fp = fopen(file_name, "r");
+  if (fp != NULL)
+  {
+    fclose(fp);
+    fp = fopen(file_name, "a");
+  }
+  return fp;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Checks which player has the highest score and sets the variable in each player struct.
+///
+/// @param players array of struct Player
+/// @param player_index Array-index of player
+/// @param index_longest_row Array-index of longest row for each player.
+/// @param total_points Total-Points of each player.
+/// @param highest_score Highest score in-game.
+///
+/// @return void
+//
+void updatePlayerPoints(Player *players, int player_index, int index_longest_row, int total_points, int *highest_score)
+{
+  players[player_index].player_points_ = calculatePoints(&index_longest_row,
+                                                         players[player_index].row_[index_longest_row],
+                                                         total_points);
+
+  if (players[player_index].player_points_ > *highest_score)
+  {
+    *highest_score = players[player_index].player_points_;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This fucntion calls the print function and write to file function.
+///
+/// @param out stream to print to
+/// @param players array of struct Player
+/// @param highest_score Highest score in-game.
+/// @param game struct Game(holds all important values for the game)
+/// @param fp File-Pointer
+///
+/// @return void
+//
+void printResults(FILE *out, Player *players, Game *game, int highest_score, FILE *fp)
+{
+  for (int player_index = 1; player_index < game->amount_of_players_; ++player_index)
+  {
+    if (players[player_index].player_points_ == players[player_index - 1].player_points_)
+    {
+      printPlayerPoints(out, player_index, players[player_index - 1].player_points_);
+      printPlayerPoints(out, player_index + 1, players[player_index].player_points_);
+      writePlayerPointsToFile(fp, player_index, players[player_index - 1].player_points_);
+      writePlayerPointsToFile(fp, player_index + 1, players[player_index].player_points_);
+      break;
+    }
+    else if (players[player_index].player_points_ > players[player_index - 1].player_points_)
+    {
+      printPlayerPoints(out, player_index + 1, players[player_index].player_points_);
+      writePlayerPointsToFile(fp, player_index + 1, players[player_index].player_points_);
+      printPlayerPoints(out, player_index, players[player_index - 1].player_points_);
+      writePlayerPointsToFile(fp, player_index, players[player_index - 1].player_points_);
+    }
+    else
+    {
+      printPlayerPoints(out, player_index, players[player_index - 1].player_points_);
+      writePlayerPointsToFile(fp, player_index, players[player_index - 1].player_points_);
+      printPlayerPoints(out, player_index + 1, players[player_index].player_points_);
+      writePlayerPointsToFile(fp, player_index + 1, players[player_index].player_points_);
+    }
+  }
+
+  fprintf(out, "\n\n");
+
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  {
+    if (players[player_index].player_points_ == highest_score)
+    {
+      fprintf(out, "Congratulations! Player %d wins the game!\n", player_index + 1);
+      if(fp != NULL)
+      {
+        fprintf(fp, "\n\nCongratulations! Player %d wins the game!\n", player_index + 1);
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function prints the points of the passed player.
+///
+/// @param out stream to print to
+/// @param player_index Array-index of player.
+/// @param points Points of player
+///
+/// @return void
+//
+void printPlayerPoints(FILE *out, int player_index, int points)
+{
+  fprintf(out, "\nPlayer %d: %d points", player_index, points);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function writes the points of the passed player to the file.
+///
+/// @param fp File-Pointer
+/// @param player_index Array-index of player
+/// @param points Points of player
+///
+/// @return void
+//
+void writePlayerPointsToFile(FILE *fp, int player_index, int points)
+{
+  if (fp != NULL)
+  {
+    fprintf(fp, "\nPlayer %d: %d points", player_index, points);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This Function calculates the points based on the color.
+///
+/// @param counter how many elements are in a row
+/// @param temp current card from row
+/// @param total_points Players total points
+///
+/// @return total_points
+//
+int calculatePoints(int *counter, Card *temp, int total_points)
+{
+  while (temp != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    total_points += colorPoints(temp->color_);
+    temp = temp->next_;
+    *counter += 1;
+  }
+  return total_points;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Prints correct choosing prompt.
+///
+/// @param out stream to print to
+/// @param numbers_entered how many cards are already entered
+/// @param error is either true(1) or false(0)
+/// @param player_index Array-index of player
+///
+/// @return success(0) or not(1)
+//
+void handleCardChoosingPrompt(FILE *out, int numbers_entered, int error, int player_index)
+{
+  if (error == 1)
+  {
+    fprintf(out, "Please enter the number of a card in your hand cards!\n"
+                 "P%d > ", player_index + 1);
+  }
+  else
+  {
+    switch (numbers_entered)
+    {
+      case 0:
+        fprintf(out, "Please choose a first card to keep:\n"
+                     "P%d > ", player_index + 1);
+        break;
+      case 1:
+        fprintf(out, "Please choose a second card to keep:\n"
+                     "P%d > ", player_index + 1);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This Function reads the user input and handles it accordingly
+///
+/// @param player struct player
+/// @param tmp Pointer-Pointer for selected Card
+/// @param numbers_entered pointer to numbers entered: keeps track of how many card are entered already
+/// @param error pointer to int error: keep track if a error occured and changes value
+///
+/// @return success(0) or not(4)
+//
+int handleCardSelection(Player *player, Card **tmp, int *numbers_entered, int *error)
+{
+  Card *new_card = ACCOUNT_MALLOC(sizeof(Card));
+  if (new_card == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+
+  copyCardData(*tmp, new_card);
+  insertCardSorted(&player->chosen_cards_, new_card);
+  removeCardFromHand(&player->hand_cards_, *tmp);
+  (*numbers_entered)++;
+  *error = 0;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This Function copies the data of one card and creates a new struct at the destination pointer.
+///
+/// @param source pointer of card to be copied
+/// @param destination pointer of destination
+///
+/// @return void
+//
+void copyCardData(Card *source, Card *destination)
+{
+  if (source != NULL && destination != NULL)
+  {
+    destination->number_ = source->number_;
+    destination->color_ = source->color_;
+    destination->next_ = NULL;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function reads user input from standard input, dynamically allocates memory to store the input, and returns the
+/// size of the input string (excluding the null terminator).
+///
+/// @param user_input Pointer to a pointer that will store the user input string. Should be NULL or point to allocated
+///                   memory that can be reallocated if needed.
+///
+/// @return If successful, returns the size of the input string (excluding null terminator); otherwise, returns ERROR.
+///
+size_t userInput(char **user_input)
+{
+  size_t current_size = sizeof(*user_input) / 8;
+  size_t size = BUFFER_SIZE;
+  size_t i = 0;
+  int ch;
+
+  if (*user_input == NULL)
+  {
+    *user_input = (char *) ACCOUNT_MALLOC(size);
+    current_size = size;
+    if (*user_input == NULL)
+    {
+      return ERROR;
+    }
+  }
+  while ((ch = fgetc(stdin)) != '\n')
+  {
+    if (ch == EOF && ferror(stdin) && errno == EINTR && tuiRedraw())
+    {
+      clearerr(stdin);
+      continue;
+    }
+    if (ch == EOF)
+    {
+      break;
+    }
+    if (i >= current_size - 1)
+    {
+      current_size *= 2;
+      char *temp = ACCOUNT_REALLOC(*user_input, current_size);
+      if (temp == NULL)
+      {
+        return ERROR;
+      }
+      *user_input = temp;
+    }
+    (*user_input)[i++] = (char) ch;
+  }
+  if (i == 0 && ch == EOF)
+  {
+    return ERROR;
+  }
+  char *temp = ACCOUNT_REALLOC(*user_input, i + 1);
+  if (temp == NULL)
+  {
+    return ERROR;
+  }
+  *user_input = temp;
+  (*user_input)[i] = '\0';
+  return i;
+}
+
+//------------------------------------------------------------------------------------------------------------------------------------
+///
+/// This function removes a specified card from a linked list of cards.
+///
+/// @param HEAD Pointer to the head of the linked list.
+/// @param hand_card Pointer to the card to be removed.
+///
+/// @return void
+///
+void removeCardFromHand(struct _Card_ **HEAD, Card *hand_card)
+{
+  Card *temp = *HEAD;
+  Card *previous = NULL;
+  while (temp != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    if (hand_card == temp)
+    {
+      if (previous == NULL)
+      {
+        *HEAD = temp->next_;
+        ACCOUNT_FREE(hand_card);
+        return;
+      }
+      else
+      {
+        previous->next_ = temp->next_;
+        ACCOUNT_FREE(hand_card);
+        return;
+      }
+    }
+    previous = temp;
+    temp = temp->next_;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function swaps the hand card decks among players after the card choosing phase is over.
+///
+/// @param out stream to print to
+/// @param players An array of Player structures representing the players in the game.
+/// @param game A pointer to the Game structure containing game-related information.
+///
+/// @return void
+///
+void swapCardDeck(FILE *out, Player *players, Game *game)
+{
+  fprintf(out, "\n"
+               "Card choosing phase is over - passing remaining hand cards to the next player!\n"
+               "\n");
+  passHandCards(players, game);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function passes the hand cards of every player on to the next player without printing anything.
+///
+/// @param players An array of Player structures representing the players in the game.
+/// @param game A pointer to the Game structure containing game-related information.
+///
+/// @return void
+///
+void passHandCards(Player *players, Game *game)
+{
+  Card *head_of_previous_deck = NULL;
+  Card *tmp;
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  {
+    if (player_index == 0)
+    {
+      head_of_previous_deck = players[player_index].hand_cards_;
+      continue;
+    }
+    tmp = players[player_index].hand_cards_;
+    players[player_index].hand_cards_ = head_of_previous_deck;
+    players[player_index - 1].hand_cards_ = tmp;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function checks if there are any cards left in the specified card lists.
+///
+/// @param chosen_cards Pointer to the head of the chosen cards linked list.
+/// @param hand_cards Pointer to the head of the hand cards linked list.
+///
+/// @return 1 if there are cards left in either list, 0 otherwise.
+///
+int checkIfCardsLeft(struct _Card_ *chosen_cards, struct _Card_ *hand_cards)
+{
+  if (chosen_cards != NULL)
+  {
+    return 1;
+  }
+  if (hand_cards != NULL)
+  {
+    return 1;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function prints the status information of a player, including their hand cards, chosen cards, and rows.
+///
+/// @param out stream to print to (the terminal mode only draws the standard output)
+/// @param players Pointer to the Player structure representing the player.
+///
+/// @return void
+///
+void printPlayerStatusInfo(FILE *out, Player *players)
+{
+  if (tui.enabled_ && out == stdout)
+  {
+    tuiPrintStatus(players);
+    return;
+  }
+  fprintf(out, "\n"
+               "Player %d:\n"
+               "  hand cards:", players->index + 1);
+  Card *current_card = players->hand_cards_;
+  while (current_card != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    fprintf(out, " %d_%c", current_card->number_, current_card->color_);
+    current_card = current_card->next_;
+  }
+  fprintf(out, "\n");
+  fprintf(out, "  chosen cards:");
+  current_card = players->chosen_cards_;
+  while (current_card != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    fprintf(out, " %d_%c", current_card->number_, current_card->color_);
+    current_card = current_card->next_;
+  }
+  for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+  {
+    current_card = players->row_[row_index];
+    if (current_card != NULL)
+    {
+      fprintf(out, "\n  row_%d:", row_index + 1);
+    }
+    while (current_card != NULL)
+    {
+      INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+      fprintf(out, " %d_%c", current_card->number_, current_card->color_);
+      current_card = current_card->next_;
+    }
+  }
+  fprintf(out, "\n\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Starts the terminal mode of the interactive game if the environment variable A3_TUI is set and the standard output
+/// is a terminal: the top TUI_LINES lines of the screen show the status of the current player and only the lines
+/// that changed are redrawn, everything else scrolls below them. The scroll region is reset when the program exits.
+/// SIGWINCH is caught without SA_RESTART, so a resize interrupts a waiting read and the status area is redrawn at once.
+///
+/// @return void
+//
+void tuiStart(void)
+{
+  const char *value = getenv("A3_TUI");
+  struct sigaction action;
+
+  if (value == NULL || value[0] == '\0' || !isatty(STDOUT_FILENO) || atexit(tuiStop) != 0)
+  {
+    return;
+  }
+  memset(&tui, 0, sizeof(Tui));
+  tuiReadSize();
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = tuiHandleResize;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGWINCH, &action, NULL);
+  tui.enabled_ = 1;
+  printf("\033[2J\033[%d;%dr\033[%d;1H", TUI_LINES + 2, tui.screen_rows_, TUI_LINES + 2);
+  fflush(stdout);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Ends the terminal mode: resets the scroll region and puts the cursor on the last line.
+///
+/// @return void
+//
+void tuiStop(void)
+{
+  if (tui.enabled_)
+  {
+    printf("\033[r\033[%d;1H\n", tui.screen_rows_);
+    fflush(stdout);
+    tui.enabled_ = 0;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the size of the terminal. A screen too small for the status area, or an unknown size, counts as 80 x 24.
+///
+/// @return void
+//
+void tuiReadSize(void)
+{
+  struct winsize size;
+  int known = ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0;
+
+  tui.screen_rows_ = known && size.ws_row > TUI_LINES + 2 ? size.ws_row : 24;
+  tui.screen_columns_ = known && size.ws_col > 0 ? size.ws_col : 80;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Handler of SIGWINCH: only marks the screen as resized, tuiRedraw does the work outside of the handler.
+///
+/// @param signal_number number of the signal (unused)
+///
+/// @return void
+//
+void tuiHandleResize(int signal_number)
+{
+  (void) signal_number;
+  tui.resized_ = 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Redraws the whole status area from the cached lines after the terminal was resized: the size is read again, the
+/// scroll region is set for the new number of rows and every line is written again, cut at the new width.
+///
+/// @return 1 if the status area was redrawn, 0 if the terminal was not resized
+//
+int tuiRedraw(void)
+{
+  if (!tui.enabled_ || !tui.resized_)
+  {
+    return 0;
+  }
+  tui.resized_ = 0;
+  tuiReadSize();
+  printf("\0337\033[%d;%dr", TUI_LINES + 2, tui.screen_rows_);
+  for (int line_index = 0; line_index < TUI_LINES; ++line_index)
+  {
+    const TuiLine *line = &tui.lines_[line_index];
+    printf("\033[%d;1H\033[K%.*s", line_index + 1, tui.screen_columns_, line->valid_ ? line->text_ : "");
+  }
+  printf("\0338");
+  fflush(stdout);
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Hashes the numbers and colors of a card list (FNV-1a), so an unchanged list is recognized without formatting it.
+///
+/// @param cards first card of the list (NULL for an empty list)
+/// @param seed start value that tells the lines apart
+///
+/// @return hash of the list
+//
+uint64_t tuiCardsHash(const Card *cards, uint64_t seed)
+{
+  uint64_t hash = 0xCBF29CE484222325ULL ^ seed;
+
+  for (; cards != NULL; cards = cards->next_)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    hash = (hash ^ ((uint64_t) cards->number_ << 8 | (unsigned char) cards->color_)) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Redraws one line of the status area if its content changed: the cached text is kept as long as the hash matches.
+/// Otherwise only the part after the prefix shared with the cached text is written, so a card appended to a row costs
+/// a few bytes. Nothing is written past the width of the terminal, so a long row never wraps into the lines below. The
+/// cursor is saved and restored around the update, so the input line of the player stays where it is.
+///
+/// @param line_index line of the status area (0 is the first line of the screen)
+/// @param hash hash of the content of the line
+/// @param label text in front of the cards (NULL for an empty line)
+/// @param cards cards to list after the label
+///
+/// @return void
+//
+void tuiUpdateLine(int line_index, uint64_t hash, const char *label, const Card *cards)
+{
+  TuiLine *line = &tui.lines_[line_index];
+  char text[TUI_LINE_SIZE] = "";
+  int length = 0;
+  int same = 0;
+
+  if (line->valid_ && line->hash_ == hash)
+  {
+    return;
+  }
+  if (label != NULL)
+  {
+    length = snprintf(text, TUI_LINE_SIZE, "%s", label);
+  }
+  for (; cards != NULL && length < TUI_LINE_SIZE; cards = cards->next_)
+  {
+    length += snprintf(text + length, (size_t) (TUI_LINE_SIZE - length), " %d_%c", cards->number_, cards->color_);
+  }
+  while (line->valid_ && text[same] != '\0' && text[same] == line->text_[same])
+  {
+    same++;
+  }
+  if (same < tui.screen_columns_)
+  {
+    const char *clear = line->valid_ && strlen(line->text_) <= strlen(text) ? "" : "\033[K";
+    printf("\0337\033[%d;%dH%s%.*s\0338", line_index + 1, same + 1, clear, tui.screen_columns_ - same, text + same);
+  }
+  memcpy(line->text_, text, sizeof(text));
+  line->valid_ = 1;
+  line->hash_ = hash;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Shows the status information of a player in the status area of the terminal mode (see printPlayerStatusInfo).
+///
+/// @param player player to show
+///
+/// @return void
+//
+void tuiPrintStatus(const Player *player)
+{
+  char label[BUFFER_SIZE];
+
+  tuiRedraw();
+  snprintf(label, sizeof(label), "Player %d:", player->index + 1);
+  tuiUpdateLine(0, (uint64_t) player->index, label, NULL);
+  tuiUpdateLine(1, tuiCardsHash(player->hand_cards_, 1), "  hand cards:", player->hand_cards_);
+  tuiUpdateLine(2, tuiCardsHash(player->chosen_cards_, 2), "  chosen cards:", player->chosen_cards_);
+  for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+  {
+    const Card *row = player->row_[row_index];
+    snprintf(label, sizeof(label), "  row_%d:", row_index + 1);
+    tuiUpdateLine(3 + row_index, tuiCardsHash(row, 3 + (uint64_t) row_index), row != NULL ? label : NULL, row);
+  }
+  fflush(stdout);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function processes the user command during the action phase and performs the corresponding action.
+///
+/// @param flow game flow of the current player (players, game, journal and output stream)
+/// @param string The user input string containing the command.
+///
+/// @return 0 on successful command execution, ERROR on invalid command, or an error code for other cases.
+///
+int actionPhaseCommands(GameFlow *flow, char *string)
+{
+  FILE *out = flow->out_;
+  Player *players = flow->players_;
+  int player_index = flow->player_index_;
+  Player *player = &players[player_index];
+  Journal *journal = &flow->journal_;
+  char *save;
+  int card = 0;
+  int row = 0;
+  int result;
+
+  if (PROBE_ENABLED(command_accepted) || PROBE_ENABLED(command_rejected))
+  {
+    probeCommandArguments(string, &card, &row);
+  }
+  char *token = strtok_r(string, " ", &save);
+  if (token == NULL)
+  {
+    fprintf(out, "Please enter a valid command!\n");
+    result = ERROR;
+  }
+  else if (stringCompareCaseInsensitive(token, "help") == 0)
+  {
+    result = handleHelpCommand(flow, &save);
+  }
+  else if (stringCompareCaseInsensitive(token, "place") == 0)
+  {
+    result = handlePlaceCommand(out, player, player_index, journal, &save);
+  }
+  else if (stringCompareCaseInsensitive(token, "discard") == 0)
+  {
+    result = handleDiscardCommand(out, player, player_index, journal, &save);
+  }
+  else if (stringCompareCaseInsensitive(token, "undo") == 0)
+  {
+    result = handleUndoCommand(out, players, journal, &save);
+  }
+  else if (stringCompareCaseInsensitive(token, "redo") == 0)
+  {
+    result = handleRedoCommand(out, players, journal, &save);
+  }
+  else if (stringCompareCaseInsensitive(token, "hint") == 0)
+  {
+    result = handleHintCommand(flow, player_index, &save);
+  }
+  else if (stringCompareCaseInsensitive(token, "quit") == 0)
+  {
+    result = handleQuitCommand(out, &save);
+  }
+  else
+  {
+    fprintf(out, "Please enter a valid command!\n");
+    result = ERROR;
+  }
+  if (result == ERROR)
+  {
+    PROBE(command_rejected, player_index, card, row);
+  }
+  else
+  {
+    PROBE(command_accepted, player_index, card, row);
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the card and row of a place or discard command for the command probes, before strtok splits the command.
+///
+/// @param string The user input string containing the command.
+/// @param card receives the card number (unchanged if there is none)
+/// @param row receives the row number as entered (unchanged if there is none)
+///
+/// @return void
+///
+void probeCommandArguments(const char *string, int *card, int *row)
+{
+  char command[8];
+  int first;
+  int second;
+  int count = sscanf(string, "%7s %d %d", command, &first, &second);
+
+  if (count == 3 && stringCompareCaseInsensitive(command, "place") == 0)
+  {
+    *row = first;
+    *card = second;
+  }
+  else if (count >= 2 && stringCompareCaseInsensitive(command, "discard") == 0)
+  {
+    *card = first;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "help" command, providing information about available commands or
+/// displaying an error message
+/// if incorrect parameters are provided.
+///
+/// @param flow game flow (output stream and whether save and load are available)
+/// @param save strtok_r state after the command
+///
+/// @return 0 on successful help display, ERROR on incorrect parameters.
+///
+int handleHelpCommand(const GameFlow *flow, char **save)
+{
+  char *token = strtok_r(NULL, "", save);
+
+  if (token != NULL)
+  {
+    fprintf(flow->out_, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+  else
+  {
+    fprintf(flow->out_, "%s%s%s%s", HELP_TEXT, HELP_TEXT_UNDO, flow->served_ ? "" : HELP_TEXT_FILES, HELP_TEXT_QUIT);
+    return 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "place" command, validating parameters and calling the placeCardInRow function
+/// accordingly.
+///
+/// @param out stream to print to
+/// @param player Pointer to the Player structure representing the current player.
+/// @param player_index Array-index of the current player.
+/// @param journal Journal the placed card is recorded in.
+/// @param save strtok_r state after the command
+///
+/// @return The result of the placeCardInRow function or an error code if parameters are incorrect.
+///
+int handlePlaceCommand(FILE *out, Player *player, int player_index, Journal *journal, char **save)
+{
+  int row, cardNumber;
+  char *row_token;
+  char *token;
+  char *endptr;
+  row_token = strtok_r(NULL, " ", save);
+
+  if (row_token == NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+  token = strtok_r(NULL, " ", save);
+  if (token == NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+
+  row = (int) strtol(row_token, &endptr, 10);
+
+  if (*endptr != '\0')
+  {
+    fprintf(out, "Please enter a valid row number!\n");
+    return ERROR;
+  }
+  if (checkOutOfBound(out, row) == ERROR)
+  {
+    return ERROR;
+  }
+
+  cardNumber = (int) strtol(token, &endptr, 10);
+
+  if (*endptr != '\0')
+  {
+    fprintf(out, "Please enter the number of a card in your hand cards!\n");
+    return ERROR;
+  }
+
+  token = strtok_r(NULL, " ", save);
+  if (token != NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+  JournalEntry entry = {.turn_ = (uint8_t) player_index};
+  int result = placeCardInRow(out, row - 1, cardNumber, player, &entry);
+  if (result != 0)
+  {
+    return result;
+  }
+  return journalRecord(journal, &entry);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "discard" command, validating parameters and calling the discardCard function accordingly.
+///
+/// @param out stream to print to
+/// @param player Pointer to the Player structure representing the current player.
+/// @param player_index Array-index of the current player.
+/// @param journal Journal the discarded card is recorded in.
+/// @param save strtok_r state after the command
+///
+/// @return The result of the discardCard function or an error code if parameters are incorrect.
+///
+int handleDiscardCommand(FILE *out, Player *player, int player_index, Journal *journal, char **save)
+{
+  char *token;
+  char *number = strtok_r(NULL, " ", save);
+  token = strtok_r(NULL, " ", save);
+
+  if (token != NULL || number == NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+
+  JournalEntry entry = {.turn_ = (uint8_t) player_index};
+  int result = discardCard(out, number, player, &entry);
+  if (result != 0)
+  {
+    return result;
+  }
+  return journalRecord(journal, &entry);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "undo" command: it takes back the last place or discard command of the current turn.
+///
+/// @param out stream to print to
+/// @param players An array of Player structures representing the players in the game.
+/// @param journal Journal of the place and discard commands.
+/// @param save strtok_r state after the command
+///
+/// @return 0 if a command was taken back, ERROR if there is none or the parameters are incorrect, or OUT_OF_MEMORY.
+///
+int handleUndoCommand(FILE *out, Player *players, Journal *journal, char **save)
+{
+  if (strtok_r(NULL, " ", save) != NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+  int result = journalUndo(journal, players);
+  if (result == ERROR)
+  {
+    fprintf(out, "Nothing to undo!\n");
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "redo" command: it repeats the last command taken back with undo.
+///
+/// @param out stream to print to
+/// @param players An array of Player structures representing the players in the game.
+/// @param journal Journal of the place and discard commands.
+/// @param save strtok_r state after the command
+///
+/// @return 0 if a command was repeated, ERROR if there is none or the parameters are incorrect.
+///
+int handleRedoCommand(FILE *out, Player *players, Journal *journal, char **save)
+{
+  if (strtok_r(NULL, " ", save) != NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+  int result = journalRedo(journal, players);
+  if (result == ERROR)
+  {
+    fprintf(out, "Nothing to redo!\n");
+  }
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "quit" command, validating parameters and signaling the program termination.
+///
+/// @param out stream to print to
+/// @param save strtok_r state after the command
+///
+/// @return 1 to signal program termination or ERROR if incorrect parameters are provided.
+///
+int handleQuitCommand(FILE *out, char **save)
+{
+  char *token = strtok_r(NULL, " ", save);
+
+  if (token != NULL)
+  {
+    fprintf(out, "Please enter the correct number of parameters!\n");
+    return ERROR;
+  }
+  return 1;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function discards a card from the chosen cards of a player, based on the provided card number.
+///
+/// @param out stream to print to
+/// @param strtok The string token representing the card number to be discarded.
+/// @param player Pointer to the Player structure representing the current player.
+/// @param entry Receives the move and the color of the card for the journal (NULL if not needed).
+///
+/// @return 0 on successful card discard, ERROR if player or chosen cards are NULL,
+/// or an error message if the card number is not found in the chosen cards.
+///
+int discardCard(FILE *out, char *strtok, Player *player, JournalEntry *entry)
+{
+  char *ptr;
+  if (player == NULL)
+  {
+    return ERROR;
+  }
+  if (player->chosen_cards_ == NULL)
+  {
+    return ERROR;
+  }
+
+  Card *head = player->chosen_cards_;
+  long number = strtol(strtok, &ptr, 10);
+
+  while (head != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    if (number == head->number_)
+    {
+      if (entry != NULL)
+      {
+        entry->move_ = (Move) {MOVE_DISCARD, (uint8_t) number, 0, 0};
+        entry->color_ = head->color_;
+      }
+      removeCardFromHand(&player->chosen_cards_, head);
+      return 0;
+    }
+    head = head->next_;
+  }
+  fprintf(out, "Please enter the number of a card in your chosen cards!\n");
+  return ERROR;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function checks if the provided row number is within the valid range.
+///
+/// @param out stream to print to
+/// @param row The row number to be checked.
+///
+/// @return 0 if the row number is within the valid range, or ERROR with an error message if out of bounds.
+///
+int checkOutOfBound(FILE *out, int row)
+{
+  if (row < MIN_ROW || row > MAX_ROW)
+  {
+    fprintf(out, "Please enter a valid row number!\n");
+    return ERROR;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function places a card in the specified row of a player's board, based on the provided card number.
+///
+/// @param out stream to print to
+/// @param row The row number where the card should be placed.
+/// @param number The card number to be placed in the row.
+/// @param player Pointer to the Player structure representing the current player.
+/// @param entry Receives the move, the new row card and the row card before it (NULL if the card starts the row) for
+///              the journal (NULL if not needed).
+///
+/// @return 0 on successful card placement, ERROR if out of memory or invalid card number,
+/// or an error message if the card cannot be placed in the chosen row.
+///
+int placeCardInRow(FILE *out, int row, int number, Player *player, JournalEntry *entry)
+{
+  Card *new_card = ACCOUNT_MALLOC(sizeof(Card));
+  if (new_card == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+  Card *head = player->chosen_cards_;
+  Card *temp;
+  Card *head_row = player->row_[row];
+
+  while (head != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    if (head->number_ == number)
+    {
+      new_card->number_ = head->number_;
+      new_card->color_ = head->color_;
+      new_card->next_ = NULL;
+
+      if (canPlaceCardInRow(head_row, number) == 0)
+      {
+        break;
+      }
+      if (entry != NULL)
+      {
+        entry->move_ = (Move) {MOVE_PLACE, (uint8_t) number, 0, (uint8_t) row};
+        entry->color_ = head->color_;
+        entry->card_ = new_card;
+        entry->previous_ = NULL;
+      }
+      if (player->row_[row] == NULL)
+      {
+        player->row_[row] = new_card;
+      }
+      else if (head->number_ < player->row_[row]->number_)
+      {
+        temp = player->row_[row];
+        player->row_[row] = new_card;
+        player->row_[row]->next_ = temp;
+      }
+      else
+      {
+        while (head_row->next_ != NULL)
+        {
+          INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+          head_row = head_row->next_;
+        }
+        head_row->next_ = new_card;
+        if (entry != NULL)
+        {
+          entry->previous_ = head_row;
+        }
+      }
+      removeCardFromHand(&player->chosen_cards_, head);
+      return 0;
+    }
+    head = head->next_;
+  }
+  if (head != NULL)
+  {
+    fprintf(out, "This card cannot extend the chosen row!\n");
+    ACCOUNT_FREE(new_card);
+    return ERROR;
+  }
+  fprintf(out, "Please enter the number of a card in your chosen cards!\n");
+  ACCOUNT_FREE(new_card);
+  return ERROR;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function checks if a card may be placed in a row: a row can only be created or extended at its beginning or
+/// its end.
+///
+/// @param row Pointer to the first card of the row (NULL if the row does not exist yet).
+/// @param number The card number to be placed in the row.
+///
+/// @return 1 if the card can be placed, 0 otherwise.
+///
+int canPlaceCardInRow(Card *row, int number)
+{
+  if (row == NULL || number < row->number_)
+  {
+    return 1;
+  }
+  while (row->next_ != NULL)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    row = row->next_;
+  }
+  return number > row->number_;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function appends a place or discard command to the journal. Commands taken back with undo can no longer be
+/// repeated afterwards.
+///
+/// @param journal Journal to append to.
+/// @param entry The recorded command.
+///
+/// @return 0 on success or OUT_OF_MEMORY.
+///
+int journalRecord(Journal *journal, const JournalEntry *entry)
+{
+  if (journal->length_ == journal->capacity_)
+  {
+    int capacity = journal->capacity_ == 0 ? 2 * MAX_CARD_PER_PLAYER : 2 * journal->capacity_;
+    JournalEntry *entries = ACCOUNT_REALLOC(journal->entries_, (size_t) capacity * sizeof(JournalEntry));
+    if (entries == NULL)
+    {
+      printf("Error: Out of memory\n");
+      return OUT_OF_MEMORY;
+    }
+    journal->entries_ = entries;
+    journal->capacity_ = capacity;
+  }
+  journal->entries_[journal->length_++] = *entry;
+  journal->end_ = journal->length_;
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function starts the turn of the next player: the commands of earlier turns can no longer be taken back, so
+/// they are forgotten and the journal only ever holds the commands of one turn. Also used after the cards of the
+/// players were replaced by a snapshot.
+///
+/// @param journal Journal of the game.
+///
+/// @return void
+///
+void journalStartTurn(Journal *journal)
+{
+  journal->length_ = 0;
+  journal->end_ = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function takes back the last command of the current turn in constant time. A placed card is unlinked from
+/// the end of the row it was added to and becomes a chosen card again; the row card keeps its memory, so redo and
+/// later journal entries can link to it again. A discarded card is created again.
+///
+/// @param journal Journal of the game.
+/// @param players An array of Player structures representing the players in the game.
+///
+/// @return 0 on success, ERROR if there is nothing to take back, or OUT_OF_MEMORY.
+///
+int journalUndo(Journal *journal, Player *players)
+{
+  if (journal->length_ == 0)
+  {
+    return ERROR;
+  }
+  JournalEntry *entry = &journal->entries_[journal->length_ - 1];
+  Player *player = &players[entry->turn_];
+  Card *card = entry->card_;
+
+  if (entry->move_.type_ == MOVE_PLACE)
+  {
+    if (entry->previous_ == NULL)
+    {
+      player->row_[entry->move_.row_] = card->next_;
+    }
+    else
+    {
+      entry->previous_->next_ = NULL;
+    }
+  }
+  else
+  {
+    card = ACCOUNT_MALLOC(sizeof(Card));
+    if (card == NULL)
+    {
+      printf("Error: Out of memory\n");
+      return OUT_OF_MEMORY;
+    }
+    card->number_ = entry->move_.card_;
+    card->color_ = entry->color_;
+  }
+  insertCardSorted(&player->chosen_cards_, card);
+  journal->length_--;
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function repeats the last command taken back with undo in constant time (a player has at most two chosen
+/// cards to search).
+///
+/// @param journal Journal of the game.
+/// @param players An array of Player structures representing the players in the game.
+///
+/// @return 0 on success or ERROR if there is nothing to repeat.
+///
+int journalRedo(Journal *journal, Player *players)
+{
+  if (journal->length_ == journal->end_)
+  {
+    return ERROR;
+  }
+  JournalEntry *entry = &journal->entries_[journal->length_++];
+  Player *player = &players[entry->turn_];
+  Card **link = &player->chosen_cards_;
+
+  while ((*link)->number_ != entry->move_.card_)
+  {
+    link = &(*link)->next_;
+  }
+  Card *card = *link;
+  if (entry->move_.type_ == MOVE_DISCARD)
+  {
+    removeCardFromHand(&player->chosen_cards_, card);
+    return 0;
+  }
+  *link = card->next_;
+  if (entry->previous_ == NULL)
+  {
+    card->next_ = player->row_[entry->move_.row_];
+    player->row_[entry->move_.row_] = card;
+  }
+  else
+  {
+    card->next_ = NULL;
+    entry->previous_->next_ = card;
+  }
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function processes the user command during the card choosing phase, validates parameters, and returns the
+/// card number to be chosen or signals program termination.
+///
+/// @param flow game flow (players, game and output stream)
+/// @param player_index Array-index of the current player.
+/// @param string The user input string containing the command.
+///
+/// @return The card number to be chosen (if a valid card number is provided), QUIT_GAME to signal program
+///         termination, HINT_SHOWN after a hint was printed, or ERROR with an error message if parameters are
+///         incorrect. A number that cannot be a card returns 0, so it is never mistaken for one of the other return
+///         values.
+///
+int cardChosingPhaseCommands(GameFlow *flow, int player_index, char *string)
+{
+  char *save;
+  char *token = strtok_r(string, " ", &save);
+
+  if (token == NULL)
+  {
+    fprintf(flow->out_, "Please enter the number of a card in your hand cards!\n");
+    return ERROR;
+  }
+  if (stringCompareCaseInsensitive(token, "quit") == 0)
+  {
+    token = strtok_r(NULL, " ", &save);
+    if (token != NULL)
+    {
+      fprintf(flow->out_, "Please enter the correct number of parameters!\n");
+      return ERROR;
+    }
+    return QUIT_GAME;
+  }
+  else if (stringCompareCaseInsensitive(token, "hint") == 0)
+  {
+    return handleHintCommand(flow, player_index, &save) == 0 ? HINT_SHOWN : ERROR;
+  }
+  else
+  {
+    char *endptr;
+    long number = strtol(token, &endptr, 10);
+
+    if (*endptr != '\0')
+    {
+      fprintf(flow->out_, "Please enter the number of a card in your hand cards!\n");
+      return ERROR;
+    }
+
+    token = strtok_r(NULL, " ", &save);
+    if (token != NULL)
+    {
+      fprintf(flow->out_, "Please enter the number of a card in your hand cards!\n");
+      return ERROR;
+    }
+
+    return number >= ERROR && number <= INT_MAX ? (int) number : 0;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+///
+/// This function compares two strings in a case-insensitive manner.
+///
+/// @param string1 The first string to be compared.
+/// @param string2 The second string to be compared.
+///
+/// @return 0 if the strings are equal (case-insensitive), 1 otherwise.
+///
+int stringCompareCaseInsensitive(const char *string1, const char *string2)
+{
+  while (*string1 && (*string1 == *string2 || tolower(*string1) == tolower(*string2)))
+  {
+    string1++;
+    string2++;
+  }
+
+  return (*string1 == *string2) ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function returns the points a card of the given color is worth.
+///
+/// @param color color character of the card (b, g, w, r)
+///
+/// @return points of the color or 0 for an unknown color
+//
+int colorPoints(char color)
+{
+  switch (color)
+  {
+    case 'b':
+      return BLUE;
+    case 'w':
+      return WHITE;
+    case 'g':
+      return GREEN;
+    case 'r':
+      return RED;
+    default:
+      return 0;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds a card number to a card set.
+///
+/// @param set card set to modify
+/// @param number card number (1 - 127)
+///
+/// @return void
+//
+void cardSetAdd(CardSet *set, int number)
+{
+  set->bits_[number >> 6] |= (uint64_t) 1 << (number & 63);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Removes a card number from a card set.
+///
+/// @param set card set to modify
+/// @param number card number (1 - 127)
+///
+/// @return void
+//
+void cardSetRemove(CardSet *set, int number)
+{
+  set->bits_[number >> 6] &= ~((uint64_t) 1 << (number & 63));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Checks if a card number is part of a card set.
+///
+/// @param set card set to check
+/// @param number card number (1 - 127)
+///
+/// @return 1 if the card is in the set, 0 otherwise
+//
+int cardSetContains(const CardSet *set, int number)
+{
+  if (number < 1 || number >= CARD_NUMBER_LIMIT)
+  {
+    return 0;
+  }
+  return (int) ((set->bits_[number >> 6] >> (number & 63)) & 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Counts the cards in a card set.
+///
+/// @param set card set to count
+///
+/// @return amount of cards in the set
+//
+int cardSetCount(const CardSet *set)
+{
+  return __builtin_popcountll(set->bits_[0]) + __builtin_popcountll(set->bits_[1]);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Finds the next card in a card set with a higher number than the given one. Iterating a set therefore looks like
+/// for (card = cardSetNext(set, 0); card != 0; card = cardSetNext(set, card)).
+///
+/// @param set card set to search
+/// @param number card number to start after (0 for the first card)
+///
+/// @return next card number or 0 if there is none
+//
+int cardSetNext(const CardSet *set, int number)
+{
+  for (int word = (number + 1) >> 6; word < 2; ++word)
+  {
+    uint64_t bits = set->bits_[word];
+    if (word == (number + 1) >> 6)
+    {
+      bits &= ~(uint64_t) 0 << ((number + 1) & 63);
+    }
+    if (bits != 0)
+    {
+      return (word << 6) + __builtin_ctzll(bits);
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Finds the position of a set bit by its rank with PDEP (or by clearing the lowest bits without BMI2).
+///
+/// @param bits word to search
+/// @param index rank of the bit (0 - popcount(bits) - 1)
+///
+/// @return position of the bit (0 - 63)
+//
+int bitSelect(uint64_t bits, int index)
+{
+#ifdef __BMI2__
+  bits = _pdep_u64((uint64_t) 1 << index, bits);
+#else
+  for (; index > 0; --index)
+  {
+    bits &= bits - 1;
+  }
+#endif
+  return __builtin_ctzll(bits);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Finds the card at a position of the ascending order of a card set without iterating the set: the popcount picks
+/// the word and bitSelect the bit.
+///
+/// @param set card set to search
+/// @param index position of the card (0 - cardSetCount(set) - 1)
+///
+/// @return card number
+//
+int cardSetSelect(const CardSet *set, int index)
+{
+  int low_count = __builtin_popcountll(set->bits_[0]);
+  int word = index >= low_count;
+
+  return (word << 6) + bitSelect(set->bits_[word], word ? index - low_count : index);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Converts the linked lists of all players into a compact search position and records the color of every card in
+/// the deck lookup table.
+///
+/// @param position position to fill
+/// @param deck deck lookup table to fill
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+/// @param phase phase the game is currently in
+/// @param turn Array-index of the player whose turn it is
+///
+/// @return void
+//
+void positionFromPlayers(Position *position, Deck *deck, Player *players, Game *game, Phase phase, int turn)
+{
+  memset(position, 0, sizeof(Position));
+  memset(deck, 0, sizeof(Deck));
+
+  for (int player_index = 0; player_index < game->amount_of_players_ && player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    for (Card *card = players[player_index].hand_cards_; card != NULL; card = card->next_)
+    {
+      cardSetAdd(&position->hand_cards_[player_index], card->number_);
+      deck->color_[card->number_] = card->color_;
+    }
+    for (Card *card = players[player_index].chosen_cards_; card != NULL; card = card->next_)
+    {
+      cardSetAdd(&position->chosen_cards_[player_index], card->number_);
+      deck->color_[card->number_] = card->color_;
+    }
+    for (int row_index = 0; row_index < MAX_ROW && row_index < ENGINE_ROWS; ++row_index)
+    {
+      RowState *row = &position->row_[player_index][row_index];
+      for (Card *card = players[player_index].row_[row_index]; card != NULL; card = card->next_)
+      {
+        if (row->length_ == 0)
+        {
+          row->low_ = (uint8_t) card->number_;
+        }
+        row->high_ = (uint8_t) card->number_;
+        row->length_++;
+        row->points_ += (uint8_t) colorPoints(card->color_);
+        deck->color_[card->number_] = card->color_;
+      }
+    }
+  }
+
+  for (int number = 0; number < CARD_NUMBER_LIMIT; ++number)
+  {
+    deck->points_[number] = (uint8_t) colorPoints(deck->color_[number]);
+  }
+
+  position->phase_ = (uint8_t) phase;
+  position->turn_ = (uint8_t) turn;
+  if (phase == PHASE_CHOOSING)
+  {
+    position->picked_ = (uint8_t) cardSetCount(&position->chosen_cards_[turn]);
+  }
+  settlePosition(position);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Moves the turn on to the next player who still has something to do and handles the phase transitions the same way
+/// runningGame does: after the choosing phase the hand cards are passed on, after the action phase the next round
+/// starts or the game is over.
+///
+/// @param position position to update
+///
+/// @return void
+//
+void settlePosition(Position *position)
+{
+  while (position->phase_ != PHASE_OVER)
+  {
+    if (position->phase_ == PHASE_CHOOSING)
+    {
+      if (position->turn_ < ENGINE_PLAYERS && cardSetCount(&position->hand_cards_[position->turn_]) != 0 &&
+          position->picked_ < 2)
+      {
+        return;
+      }
+      if (position->turn_ < ENGINE_PLAYERS)
+      {
+        position->turn_++;
+        position->picked_ = 0;
+        continue;
+      }
+      CardSet first_hand = position->hand_cards_[0];
+      for (int player_index = 0; player_index < ENGINE_PLAYERS - 1; ++player_index)
+      {
+        position->hand_cards_[player_index] = position->hand_cards_[player_index + 1];
+      }
+      position->hand_cards_[ENGINE_PLAYERS - 1] = first_hand;
+      position->phase_ = PHASE_ACTION;
+      position->turn_ = 0;
+    }
+    else
+    {
+      if (position->turn_ < ENGINE_PLAYERS && cardSetCount(&position->chosen_cards_[position->turn_]) != 0)
+      {
+        return;
+      }
+      if (position->turn_ < ENGINE_PLAYERS)
+      {
+        position->turn_++;
+        continue;
+      }
+      position->phase_ = PHASE_OVER;
+      position->turn_ = 0;
+      for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+      {
+        if (cardSetCount(&position->hand_cards_[player_index]) != 0)
+        {
+          position->phase_ = PHASE_CHOOSING;
+        }
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Generates all legal moves of the player whose turn it is. In the card choosing phase a move keeps two hand cards
+/// (or one, if the first card was already chosen), in the action phase a move places or discards one chosen card
+/// following the rules of placeCardInRow and discardCard.
+///
+/// @param position current position
+/// @param moves array with room for SEARCH_MAX_MOVES moves
+///
+/// @return amount of generated moves
+//
+int generateMoves(const Position *position, Move *moves)
+{
+  int count = 0;
+  int turn = position->turn_;
+
+  if (position->phase_ == PHASE_CHOOSING)
+  {
+    const CardSet *hand = &position->hand_cards_[turn];
+    int singles = position->picked_ == 1 || cardSetCount(hand) == 1;
+    for (int card = cardSetNext(hand, 0); card != 0; card = cardSetNext(hand, card))
+    {
+      if (singles)
+      {
+        moves[count++] = (Move) {MOVE_CHOOSE, (uint8_t) card, 0, 0};
+        continue;
+      }
+      for (int second = cardSetNext(hand, card); second != 0; second = cardSetNext(hand, second))
+      {
+        if (count < SEARCH_MAX_MOVES)
+        {
+          moves[count++] = (Move) {MOVE_CHOOSE, (uint8_t) card, (uint8_t) second, 0};
+        }
+      }
+    }
+  }
+  else if (position->phase_ == PHASE_ACTION)
+  {
+    const CardSet *chosen = &position->chosen_cards_[turn];
+    for (int card = cardSetNext(chosen, 0); card != 0; card = cardSetNext(chosen, card))
+    {
+      for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+      {
+        const RowState *row = &position->row_[turn][row_index];
+        if (row->length_ == 0 || card < row->low_ || card > row->high_)
+        {
+          moves[count++] = (Move) {MOVE_PLACE, (uint8_t) card, 0, (uint8_t) row_index};
+        }
+      }
+      moves[count++] = (Move) {MOVE_DISCARD, (uint8_t) card, 0, 0};
+    }
+  }
+  return count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Applies a legal move to a position.
+///
+/// @param position position to update
+/// @param deck deck lookup table with the points of every card
+/// @param move move generated by generateMoves
+///
+/// @return void
+//
+void applyMove(Position *position, const Deck *deck, Move move)
+{
+  int turn = position->turn_;
+
+  if (move.type_ == MOVE_CHOOSE)
+  {
+    cardSetRemove(&position->hand_cards_[turn], move.card_);
+    cardSetAdd(&position->chosen_cards_[turn], move.card_);
+    position->picked_++;
+    if (move.second_card_ != 0)
+    {
+      cardSetRemove(&position->hand_cards_[turn], move.second_card_);
+      cardSetAdd(&position->chosen_cards_[turn], move.second_card_);
+      position->picked_++;
+    }
+  }
+  else
+  {
+    cardSetRemove(&position->chosen_cards_[turn], move.card_);
+    if (move.type_ == MOVE_PLACE)
+    {
+      RowState *row = &position->row_[turn][move.row_];
+      if (row->length_ == 0 || move.card_ < row->low_)
+      {
+        row->low_ = move.card_;
+      }
+      if (row->length_ == 0 || move.card_ > row->high_)
+      {
+        row->high_ = move.card_;
+      }
+      row->length_++;
+      row->points_ += deck->points_[move.card_];
+    }
+  }
+  settlePosition(position);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Applies a legal move like applyMove and records in a journal entry what positionUnmake needs to take it back: the
+/// turn, the phase and the chosen count before the move and the old state of the row a card is placed in.
+///
+/// @param position position to update
+/// @param deck deck lookup table with the points of every card
+/// @param move move generated by generateMoves
+/// @param entry receives the journal entry of the move
+///
+/// @return void
+//
+void positionMake(Position *position, const Deck *deck, Move move, JournalEntry *entry)
+{
+  entry->move_ = move;
+  entry->turn_ = position->turn_;
+  entry->phase_ = position->phase_;
+  entry->picked_ = position->picked_;
+  if (move.type_ == MOVE_PLACE)
+  {
+    entry->row_ = position->row_[position->turn_][move.row_];
+  }
+  applyMove(position, deck, move);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Takes back the last move made with positionMake in constant time. A move that ended the card choosing phase also
+/// passed the hand cards on, so they are passed back.
+///
+/// @param position position to update
+/// @param entry journal entry of the move
+///
+/// @return void
+//
+void positionUnmake(Position *position, const JournalEntry *entry)
+{
+  int turn = entry->turn_;
+  Move move = entry->move_;
+
+  if (entry->phase_ == PHASE_CHOOSING && position->phase_ != PHASE_CHOOSING)
+  {
+    CardSet last_hand = position->hand_cards_[ENGINE_PLAYERS - 1];
+    for (int player_index = ENGINE_PLAYERS - 1; player_index > 0; --player_index)
+    {
+      position->hand_cards_[player_index] = position->hand_cards_[player_index - 1];
+    }
+    position->hand_cards_[0] = last_hand;
+  }
+  position->phase_ = entry->phase_;
+  position->turn_ = entry->turn_;
+  position->picked_ = entry->picked_;
+
+  if (move.type_ == MOVE_CHOOSE)
+  {
+    cardSetRemove(&position->chosen_cards_[turn], move.card_);
+    cardSetAdd(&position->hand_cards_[turn], move.card_);
+    if (move.second_card_ != 0)
+    {
+      cardSetRemove(&position->chosen_cards_[turn], move.second_card_);
+      cardSetAdd(&position->hand_cards_[turn], move.second_card_);
+    }
+  }
+  else
+  {
+    cardSetAdd(&position->chosen_cards_[turn], move.card_);
+    if (move.type_ == MOVE_PLACE)
+    {
+      position->row_[turn][move.row_] = entry->row_;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Calculates the points of a player by the rules: the points of the longest row (lowest index on ties) count twice.
+/// This is what printPoints prints for player 1. For player 2, printPoints keeps the longest row index of player 1
+/// unless player 2 has a strictly longer row, so the printed points of player 2 can differ from this value. The
+/// engine (hint, analysis, book, endgame table) deliberately scores by the rules.
+///
+/// @param position position to score
+/// @param player_index Array-index of player
+///
+/// @return points of the player
+//
+int scorePosition(const Position *position, int player_index)
+{
+  int total_points = 0;
+  int longest_length = 0;
+  int longest_points = 0;
+
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    const RowState *row = &position->row_[player_index][row_index];
+    total_points += row->points_;
+    if (row->length_ > longest_length)
+    {
+      longest_length = row->length_;
+      longest_points = row->points_;
+    }
+  }
+  return total_points + longest_points;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Evaluates a position as the score margin of player 1 over player 2.
+///
+/// @param position position to evaluate
+///
+/// @return score margin from the view of player 1
+//
+int evaluatePosition(const Position *position)
+{
+  return scorePosition(position, 0) - scorePosition(position, 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Checks every few thousand nodes whether the time budget of the search is used up.
+///
+/// @param search running search
+///
+/// @return 1 if the search has to stop, 0 otherwise
+//
+int searchTimeUp(Search *search)
+{
+  if ((search->nodes_ & 4095) == 0)
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > search->deadline_.tv_sec ||
+        (now.tv_sec == search->deadline_.tv_sec && now.tv_nsec >= search->deadline_.tv_nsec))
+    {
+      search->aborted_ = 1;
+    }
+  }
+  return search->aborted_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Depth limited alpha-beta search. Player 1 maximizes the score margin, player 2 minimizes it. The search uses no
+/// heap memory and never copies a position: every node keeps its moves on the stack and makes and unmakes them on the
+/// one position of the search, with a journal entry per ply.
+///
+/// @param search running search
+/// @param position position to search
+/// @param depth remaining depth in moves
+/// @param alpha lower bound
+/// @param beta upper bound
+///
+/// @return value of the position (undefined if the search was aborted)
+//
+int searchNode(Search *search, Position *position, int depth, int alpha, int beta)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  JournalEntry entry;
+
+  search->nodes_++;
+  if (searchTimeUp(search))
+  {
+    return 0;
+  }
+  if (position->phase_ == PHASE_OVER)
+  {
+    return evaluatePosition(position);
+  }
+  int value;
+  if (search->tablebase_ != NULL && tablebaseProbe(search->tablebase_, position, search->deck_, &value))
+  {
+    search->tablebase_hits_++;
+    return value;
+  }
+  if (depth == 0)
+  {
+    search->horizon_reached_ = 1;
+    return evaluatePosition(position);
+  }
+
+  int count = generateMoves(position, moves);
+  int maximizing = position->turn_ == 0;
+  int best = maximizing ? -SEARCH_INFINITY : SEARCH_INFINITY;
+
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    positionMake(position, search->deck_, moves[move_index], &entry);
+    value = searchNode(search, position, depth - 1, alpha, beta);
+    positionUnmake(position, &entry);
+    if (search->aborted_)
+    {
+      return 0;
+    }
+    if (maximizing)
+    {
+      best = value > best ? value : best;
+      alpha = best > alpha ? best : alpha;
+    }
+    else
+    {
+      best = value < best ? value : best;
+      beta = best < beta ? best : beta;
+    }
+    if (alpha >= beta)
+    {
+      break;
+    }
+  }
+  return best;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Searches all moves of the root position. The best move of the previous iteration is searched first.
+///
+/// @param search running search
+/// @param position root position (unchanged when the function returns)
+/// @param depth depth of this iteration
+/// @param best_move in: best move of the previous iteration, out: best move of this iteration
+///
+/// @return value of the root position (undefined if the search was aborted)
+//
+int searchRoot(Search *search, Position *position, int depth, Move *best_move)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  JournalEntry entry;
+  int count = generateMoves(position, moves);
+  int maximizing = position->turn_ == 0;
+  int best = maximizing ? -SEARCH_INFINITY : SEARCH_INFINITY;
+  int alpha = -SEARCH_INFINITY;
+  int beta = SEARCH_INFINITY;
+
+  for (int move_index = 1; move_index < count; ++move_index)
+  {
+    if (memcmp(&moves[move_index], best_move, sizeof(Move)) == 0)
+    {
+      moves[move_index] = moves[0];
+      moves[0] = *best_move;
+      break;
+    }
+  }
+
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    positionMake(position, search->deck_, moves[move_index], &entry);
+    int value = searchNode(search, position, depth - 1, alpha, beta);
+    positionUnmake(position, &entry);
+    if (search->aborted_)
+    {
+      return 0;
+    }
+    if ((maximizing && value > best) || (!maximizing && value < best))
+    {
+      best = value;
+      *best_move = moves[move_index];
+    }
+    if (maximizing)
+    {
+      alpha = best > alpha ? best : alpha;
+    }
+    else
+    {
+      beta = best < beta ? best : beta;
+    }
+  }
+  return best;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Iterative deepening search within a time budget. Every completed iteration replaces the result, an iteration that
+/// runs out of time is thrown away. The search stops early once no line reaches the depth limit anymore, because the
+/// result is exact then.
+///
+/// @param position root position
+/// @param deck deck lookup table with the points of every card
+/// @param tablebase endgame table to answer final round positions with (NULL or not loaded to search them)
+/// @param milliseconds time budget of the search
+/// @param result result of the deepest completed iteration (move_.type_ is MOVE_CHOOSE with card 0 if there is none)
+///
+/// @return void
+//
+void searchIterative(const Position *position, const Deck *deck, const Tablebase *tablebase, long milliseconds,
+                     SearchResult *result)
+{
+  Search search;
+  Position root = *position;
+  Move best_move = {MOVE_CHOOSE, 0, 0, 0};
+
+  memset(result, 0, sizeof(SearchResult));
+  memset(&search, 0, sizeof(Search));
+  search.deck_ = deck;
+  search.tablebase_ = tablebase;
+  clock_gettime(CLOCK_MONOTONIC, &search.deadline_);
+  search.deadline_.tv_sec += milliseconds / 1000;
+  search.deadline_.tv_nsec += (milliseconds % 1000) * 1000000L;
+  if (search.deadline_.tv_nsec >= 1000000000L)
+  {
+    search.deadline_.tv_sec++;
+    search.deadline_.tv_nsec -= 1000000000L;
+  }
+
+  if (position->phase_ == PHASE_OVER)
+  {
+    return;
+  }
+
+  for (int depth = 1; depth <= SEARCH_MAX_DEPTH; ++depth)
+  {
+    search.horizon_reached_ = 0;
+    int value = searchRoot(&search, &root, depth, &best_move);
+    if (search.aborted_)
+    {
+      break;
+    }
+    result->move_ = best_move;
+    result->value_ = value;
+    result->depth_ = depth;
+    result->exact_ = !search.horizon_reached_;
+    if (result->exact_)
+    {
+      break;
+    }
+  }
+  result->nodes_ = search.nodes_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function prints a move in the syntax of the commands that would play it.
+///
+/// @param out stream to print to
+/// @param move move to print
+///
+/// @return void
+//
+void printMove(FILE *out, Move move)
+{
+  switch (move.type_)
+  {
+    case MOVE_CHOOSE:
+      if (move.second_card_ != 0)
+      {
+        fprintf(out, "keep %d and %d", move.card_, move.second_card_);
+      }
+      else
+      {
+        fprintf(out, "keep %d", move.card_);
+      }
+      break;
+    case MOVE_PLACE:
+      fprintf(out, "place %d %d", move.row_ + 1, move.card_);
+      break;
+    default:
+      fprintf(out, "discard %d", move.card_);
+      break;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// This function handles the "hint" command: it searches the current position within the time budget (optional
+/// parameter in milliseconds, at most HINT_MAX_MILLISECONDS) and prints the best move and the expected score margin of
+/// the current player. A game of the server searches at most SERVER_HINT_MAX_MILLISECONDS, since the search runs on
+/// the thread that serves other games; its hints mostly come from the opening book, the outcome cache and the endgame
+/// table. While the players choose at the same time there is no hint, since the search expects them to choose one
+/// after another.
+///
+/// @param flow game flow (players, game, phase and output stream)
+/// @param player_index Array-index of the current player.
+/// @param save strtok_r state after the command
+///
+/// @return 0 after printing the hint, ERROR if the parameters are incorrect.
+///
+int handleHintCommand(GameFlow *flow, int player_index, char **save)
+{
+  long milliseconds = HINT_DEFAULT_MILLISECONDS;
+  char *token = strtok_r(NULL, " ", save);
+  char *endptr;
+
+  if (token != NULL)
+  {
+    errno = 0;
+    milliseconds = strtol(token, &endptr, 10);
+    if (*endptr != '\0' || errno == ERANGE || milliseconds <= 0)
+    {
+      fprintf(flow->out_, "Please enter a valid number of milliseconds!\n");
+      return ERROR;
+    }
+    if (strtok_r(NULL, " ", save) != NULL)
+    {
+      fprintf(flow->out_, "Please enter the correct number of parameters!\n");
+      return ERROR;
+    }
+  }
+  if (flow->simultaneous_ && flow->phase_ == PHASE_CHOOSING)
+  {
+    fprintf(flow->out_, "No hint available while the players choose at the same time!\n");
+    return ERROR;
+  }
+  if (milliseconds > HINT_MAX_MILLISECONDS)
+  {
+    milliseconds = HINT_MAX_MILLISECONDS;
+  }
+  if (flow->served_ && milliseconds > SERVER_HINT_MAX_MILLISECONDS)
+  {
+    milliseconds = SERVER_HINT_MAX_MILLISECONDS;
+  }
+
+  Position position;
+  Deck deck;
+  Engine engine;
+  positionFromPlayers(&position, &deck, flow->players_, flow->game_, flow->phase_, player_index);
+  if (flow->engine_ != NULL)
+  {
+    printHint(flow->out_, &position, &deck, flow->engine_, milliseconds);
+    return 0;
+  }
+  engineOpen(&engine);
+  printHint(flow->out_, &position, &deck, &engine, milliseconds);
+  engineClose(&engine);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Prints the best move of the player whose turn it is: from the opening book if the hand is in it, from the outcome
+/// cache if the position was solved before, otherwise found by a search within the time budget. Solved positions are
+/// added to the cache.
+///
+/// @param out stream to print to
+/// @param position current position
+/// @param deck deck lookup table with the points of every card
+/// @param engine opened endgame table and opening book
+/// @param milliseconds time budget of the search
+///
+/// @return 0 if a move was printed, ERROR if there is no move
+//
+int printHint(FILE *out, const Position *position, const Deck *deck, const Engine *engine, long milliseconds)
+{
+  SearchResult result;
+  CacheValue cached;
+  uint64_t key[2];
+
+  if (bookLookup(&engine->book_, position, deck, &result.move_, &result.value_))
+  {
+    fprintf(out, "Hint: ");
+    printMove(out, result.move_);
+    fprintf(out, " (expected margin %+d, opening book)\n", result.value_);
+    return 0;
+  }
+  cacheKey(key, CACHE_SOLVED, position, deck, NULL, NULL);
+  if (cacheLookup(&engine->cache_, key, &cached))
+  {
+    result = cached.result_;
+  }
+  else
+  {
+    searchIterative(position, deck, &engine->tablebase_, milliseconds, &result);
+    if (result.exact_ && result.move_.card_ != 0)
+    {
+      cached.result_ = result;
+      cacheStore(&engine->cache_, key, &cached);
+    }
+  }
+
+  if (result.move_.card_ == 0)
+  {
+    fprintf(out, "No hint available!\n");
+    return ERROR;
+  }
+
+  fprintf(out, "Hint: ");
+  printMove(out, result.move_);
+  fprintf(out, " (expected margin %+d, %s %d)\n", position->turn_ == 0 ? result.value_ : -result.value_,
+          result.exact_ ? "solved at depth" : "depth", result.depth_);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Command line tools that are started with "./a3 --<tool> ..." instead of a game.
+//
+const Tool TOOLS[] = {
+  {"--perft", "--perft <config file> <depth> [--divide] [--check]", runPerftTool},
+  {"--gen-tablebase", "--gen-tablebase <table file>", runTablebaseTool},
+  {"--gen-book", "--gen-book <book file> <config file>... [--games <n>] [--seed <n>]", runBookTool},
+  {"--analyze", "--analyze <config file> [--policies <policy>,<policy>] [--threads <n>] [--width <w>] "
+                "[--max-games <n>] [--seed <n>] [--export <file>] [--record <store file>] "
+                "[--archive <archive file>]", runAnalyzeTool},
+  {"--serve", "--serve <socket path> <config file> [--threads <n>] [--metrics <file>]", runServeTool},
+  {"--query", "--query <store file> games|winrate|points|longest|colors [--hold <player>:<card>[_<color>]] "
+              "[--deck <hash>] [--by deck] [--threads <n>]", runQueryTool},
+  {"--replay", "--replay <archive file> [--game <n>]", runReplayTool},
+  {"--bench", "--bench [--filter <name>] [--repetitions <n>] [--min-time <milliseconds>]", runBenchTool},
+  {"--gen-decks", "--gen-decks <n> [--seed <n>] [--colors <b>:<g>:<w>:<r>] [--threads <n>] [--output <prefix>]",
+   runDeckTool},
+  {"--stress", "--stress <cards> <hand size> <rows> [--players <n>] [--seed <n>]", runStressTool},
+  {"--tournament", "--tournament <policy file> <deck directory> [--games <n>] [--threads <n>] [--seed <n>]",
+   runTournamentTool},
+  {"--tune", "--tune [--iterations <n>] [--decks <n>] [--start <policy>] [--opponent <policy>] [--threads <n>] "
+             "[--seed <n>]", runTuneTool},
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Looks up the tool named by the first program argument and runs it.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+///
+/// @return exit code of the tool or 1 for an unknown tool
+//
+int runTool(int argc, char *argv[])
+{
+  size_t tool_count = sizeof(TOOLS) / sizeof(TOOLS[0]);
+  for (size_t tool_index = 0; tool_index < tool_count; ++tool_index)
+  {
+    if (strcmp(argv[1], TOOLS[tool_index].name_) == 0)
+    {
+      return TOOLS[tool_index].run_(argc, argv, TOOLS[tool_index].usage_);
+    }
+  }
+  printf("Usage: ./a3 <config file>\n");
+  for (size_t tool_index = 0; tool_index < tool_count; ++tool_index)
+  {
+    printf("       ./a3 %s\n", TOOLS[tool_index].usage_);
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Parses a config file and deals the cards exactly like a game would, but without printing the welcome message.
+///
+/// @param file_name string of the config file name
+/// @param game receives struct Game(holds all important values for the game)
+/// @param players receives the array of struct Player
+/// @param total_cards receives the linked list of all the cards parsed from config file
+///
+/// @return success(0) or the error code of the game(2, 3, 4)
+//
+int loadGame(char *file_name, Game **game, Player **players, Card **total_cards)
+{
+  *players = NULL;
+  *total_cards = NULL;
+  *game = ACCOUNT_MALLOC(sizeof(Game));
+  if (*game == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+
+  int result = parseConfigFile(file_name, total_cards, *game);
+  if (result != 0)
+  {
+    handleInvalidInput(*game, NULL, NULL);
+    return result;
+  }
+  if ((*game)->amount_of_players_ != ENGINE_PLAYERS)
+  {
+    printf("Error: Invalid file: %s\n", file_name);
+    handleInvalidInput(*game, NULL, *total_cards);
+    return 3;
+  }
+
+  *players = initializePlayers(*game);
+  if (*players == NULL)
+  {
+    handleInvalidInput(*game, NULL, *total_cards);
+    return OUT_OF_MEMORY;
+  }
+  if (cardDistribution(*players, *total_cards, *game) == OUT_OF_MEMORY)
+  {
+    handleInvalidInput(*game, *players, *total_cards);
+    return OUT_OF_MEMORY;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Loads a config file straight into the start position of a game.
+///
+/// @param file_name string of the config file name
+/// @param position receives the start position
+/// @param deck receives the deck lookup table
+///
+/// @return success(0) or the error code of the game(2, 3, 4)
+//
+int loadDeck(char *file_name, Position *position, Deck *deck)
+{
+  Game *game;
+  Player *players;
+  Card *total_cards;
+
+  int result = loadGame(file_name, &game, &players, &total_cards);
+  if (result != 0)
+  {
+    return result;
+  }
+  positionFromPlayers(position, deck, players, game, PHASE_CHOOSING, 0);
+  freeMemory(game, players, total_cards);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Calculates the seconds passed since a point in time.
+///
+/// @param start point in time (CLOCK_MONOTONIC)
+///
+/// @return passed seconds
+//
+double secondsSince(const struct timespec *start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double) (now.tv_sec - start->tv_sec) + (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Counts the cards of a linked list.
+///
+/// @param head The pointer to the first card in the linked list.
+///
+/// @return amount of cards
+//
+int countCards(Card *head)
+{
+  int count = 0;
+  for (; head != NULL; head = head->next_)
+  {
+    INSTRUMENT_COUNT(INSTRUMENT_NODES, 1);
+    count++;
+  }
+  return count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Creates a deep copy of a linked list of cards.
+///
+/// @param source The pointer to the first card in the list to copy.
+/// @param destination receives the copied list (all copied cards are freed again on failure)
+///
+/// @return success(0) or out of memory(4)
+//
+int copyCardList(Card *source, Card **destination)
+{
+  Card **tail = destination;
+  *destination = NULL;
+  for (; source != NULL; source = source->next_)
+  {
+    Card *new_card = ACCOUNT_MALLOC(sizeof(Card));
+    if (new_card == NULL)
+    {
+      freeCardList(*destination);
+      *destination = NULL;
+      return OUT_OF_MEMORY;
+    }
+    copyCardData(source, new_card);
+    *tail = new_card;
+    tail = &new_card->next_;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Creates a deep copy of all players including all their card lists.
+///
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return the copied array of struct Player or NULL if out of memory
+//
+Player *copyPlayers(Player *players, Game *game)
+{
+  Player *copy = ACCOUNT_CALLOC((size_t) game->amount_of_players_, sizeof(Player));
+  if (copy == NULL)
+  {
+    return NULL;
+  }
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  {
+    copy[player_index].index = players[player_index].index;
+    copy[player_index].player_points_ = players[player_index].player_points_;
+    copy[player_index].row_ = ACCOUNT_CALLOC((size_t) MAX_ROW, sizeof(Card *));
+    int result = copy[player_index].row_ == NULL ? OUT_OF_MEMORY : 0;
+    result |= copyCardList(players[player_index].hand_cards_, &copy[player_index].hand_cards_);
+    result |= copyCardList(players[player_index].chosen_cards_, &copy[player_index].chosen_cards_);
+    for (int row_index = 0; row_index < MAX_ROW && copy[player_index].row_ != NULL; ++row_index)
+    {
+      result |= copyCardList(players[player_index].row_[row_index], &copy[player_index].row_[row_index]);
+    }
+    if (result != 0)
+    {
+      freePlayers(copy, game);
+      return NULL;
+    }
+  }
+  return copy;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Compares two positions field by field.
+///
+/// @param first first position
+/// @param second second position
+///
+/// @return 1 if both positions are equal, 0 otherwise
+//
+int positionsEqual(const Position *first, const Position *second)
+{
+  return memcmp(first->hand_cards_, second->hand_cards_, sizeof(first->hand_cards_)) == 0 &&
+         memcmp(first->chosen_cards_, second->chosen_cards_, sizeof(first->chosen_cards_)) == 0 &&
+         memcmp(first->row_, second->row_, sizeof(first->row_)) == 0 && first->phase_ == second->phase_ &&
+         first->turn_ == second->turn_ && first->picked_ == second->picked_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Counts all positions reachable from a position in exactly depth moves (leaves) and all positions visited on the
+/// way (nodes). The moves are made and unmade on the position like in the search.
+///
+/// @param position start position (unchanged when the function returns)
+/// @param deck deck lookup table with the points of every card
+/// @param depth depth in moves
+/// @param counter counter to add the leaves and nodes to
+///
+/// @return void
+//
+void perft(Position *position, const Deck *deck, int depth, PerftCounter *counter)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  JournalEntry entry;
+
+  counter->nodes_++;
+  if (depth == 0)
+  {
+    counter->leaves_++;
+    return;
+  }
+  if (position->phase_ == PHASE_OVER)
+  {
+    return;
+  }
+
+  int count = generateMoves(position, moves);
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    positionMake(position, deck, moves[move_index], &entry);
+    perft(position, deck, depth - 1, counter);
+    positionUnmake(position, &entry);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Plays a generated move on the linked lists of the players with the functions the game itself uses
+/// (handleCardSelection, placeCardInRow, discardCard and passHandCards).
+///
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+/// @param position position the move was generated for
+/// @param move move to play
+///
+/// @return 0 if the game accepted the move, ERROR if it rejected it or out of memory(4)
+//
+int applyMoveToPlayers(Player *players, Game *game, const Position *position, Move move)
+{
+  Player *player = &players[position->turn_];
+  char number[16];
+
+  if (move.type_ == MOVE_PLACE)
+  {
+    return placeCardInRow(stdout, move.row_, move.card_, player, NULL);
+  }
+  if (move.type_ == MOVE_DISCARD)
+  {
+    snprintf(number, sizeof(number), "%d", move.card_);
+    return discardCard(stdout, number, player, NULL);
+  }
+
+  int cards[2] = {move.card_, move.second_card_};
+  for (int card_index = 0; card_index < 2 && cards[card_index] != 0; ++card_index)
+  {
+    Card *card = player->hand_cards_;
+    int numbers_entered = 0;
+    int error = 0;
+    while (card != NULL && card->number_ != cards[card_index])
+    {
+      card = card->next_;
+    }
+    if (card == NULL)
+    {
+      return ERROR;
+    }
+    if (handleCardSelection(player, &card, &numbers_entered, &error) != 0)
+    {
+      return OUT_OF_MEMORY;
+    }
+  }
+  if (position->turn_ == game->amount_of_players_ - 1 && countCards(player->chosen_cards_) == 2)
+  {
+    passHandCards(players, game);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Perft that cross-checks the move generator against the rules of the game: at every node the amount of generated
+/// moves has to match the moves the linked lists allow (canPlaceCardInRow), every generated move has to be accepted
+/// by the game functions and lead to the same position as applyMove, and positionUnmake has to restore the position.
+///
+/// @param position start position
+/// @param deck deck lookup table with the points of every card
+/// @param players players in the same state as the position
+/// @param game struct Game(holds all important values for the game)
+/// @param depth depth in moves
+/// @param counter counter to add the leaves, nodes and mismatches to
+///
+/// @return success(0) or out of memory(4)
+//
+int perftCheck(const Position *position, const Deck *deck, Player *players, Game *game, int depth,
+               PerftCounter *counter)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  Player *player = &players[position->turn_];
+  int expected = 0;
+
+  counter->nodes_++;
+  if (depth == 0)
+  {
+    counter->leaves_++;
+    return 0;
+  }
+  if (position->phase_ == PHASE_OVER)
+  {
+    return 0;
+  }
+
+  if (position->phase_ == PHASE_CHOOSING)
+  {
+    int hand_size = countCards(player->hand_cards_);
+    expected = (position->picked_ == 1 || hand_size == 1) ? hand_size : hand_size * (hand_size - 1) / 2;
+  }
+  else
+  {
+    for (Card *card = player->chosen_cards_; card != NULL; card = card->next_)
+    {
+      for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+      {
+        expected += canPlaceCardInRow(player->row_[row_index], card->number_);
+      }
+      expected++;
+    }
+  }
+
+  int count = generateMoves(position, moves);
+  if (count != expected)
+  {
+    printf("Mismatch: %d moves generated, the game allows %d\n", count, expected);
+    counter->mismatches_++;
+  }
+
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    Position child = *position;
+    Position reference;
+    Deck reference_deck;
+    JournalEntry entry;
+    positionMake(&child, deck, moves[move_index], &entry);
+    reference = child;
+    positionUnmake(&reference, &entry);
+    if (!positionsEqual(&reference, position))
+    {
+      printf("Mismatch: ");
+      printMove(stdout, moves[move_index]);
+      printf(" cannot be taken back\n");
+      counter->mismatches_++;
+    }
+
+    Player *copy = copyPlayers(players, game);
+    if (copy == NULL)
+    {
+      printf("Error: Out of memory\n");
+      return OUT_OF_MEMORY;
+    }
+    int result = applyMoveToPlayers(copy, game, position, moves[move_index]);
+    if (result == OUT_OF_MEMORY)
+    {
+      freePlayers(copy, game);
+      return OUT_OF_MEMORY;
+    }
+    positionFromPlayers(&reference, &reference_deck, copy, game, (Phase) child.phase_, child.turn_);
+    if (result != 0 || !positionsEqual(&child, &reference))
+    {
+      printf("Mismatch: ");
+      printMove(stdout, moves[move_index]);
+      printf(" %s\n", result != 0 ? "was rejected by the game" : "leads to a different position");
+      counter->mismatches_++;
+    }
+    else if (perftCheck(&child, deck, copy, game, depth - 1, counter) == OUT_OF_MEMORY)
+    {
+      freePlayers(copy, game);
+      return OUT_OF_MEMORY;
+    }
+    freePlayers(copy, game);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Runs the perft benchmark: "./a3 --perft <config file> <depth> [--divide] [--check]". Prints the leaves, nodes and
+/// nodes per second for every depth up to the given one. --divide splits the deepest count by the first move,
+/// --check additionally verifies the move generator against the game functions.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage, CHECK_FAILED on a mismatch or the error code of loading the config file
+//
+int runPerftTool(int argc, char *argv[], const char *tool_usage)
+{
+  int divide = 0;
+  int check = 0;
+  char *endptr;
+
+  if (argc < 4)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  long depth = strtol(argv[3], &endptr, 10);
+  if (*endptr != '\0' || depth < 0 || depth > SEARCH_MAX_DEPTH)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  for (int argument = 4; argument < argc; ++argument)
+  {
+    if (strcmp(argv[argument], "--divide") == 0)
+    {
+      divide = 1;
+    }
+    else if (strcmp(argv[argument], "--check") == 0)
+    {
+      check = 1;
+    }
+    else
+    {
+      printf("Usage: ./a3 %s\n", tool_usage);
+      return 1;
+    }
+  }
+
+  Game *game;
+  Player *players;
+  Card *total_cards;
+  Position position;
+  Deck deck;
+  int result = loadGame(argv[2], &game, &players, &total_cards);
+  if (result != 0)
+  {
+    return result;
+  }
+  positionFromPlayers(&position, &deck, players, game, PHASE_CHOOSING, 0);
+
+  for (int current_depth = 1; current_depth <= depth; ++current_depth)
+  {
+    PerftCounter counter = {0, 0, 0};
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    perft(&position, &deck, current_depth, &counter);
+    double seconds = secondsSince(&start);
+    printf("depth %d: %lu leaves, %lu nodes, %.3f s, %.0f nodes/s\n", current_depth, counter.leaves_,
+           counter.nodes_, seconds, seconds > 0 ? (double) counter.nodes_ / seconds : 0.0);
+  }
+
+  if (divide && depth > 0)
+  {
+    Move moves[SEARCH_MAX_MOVES];
+    int count = generateMoves(&position, moves);
+    printf("\n");
+    for (int move_index = 0; move_index < count; ++move_index)
+    {
+      PerftCounter counter = {0, 0, 0};
+      JournalEntry entry;
+      positionMake(&position, &deck, moves[move_index], &entry);
+      perft(&position, &deck, (int) depth - 1, &counter);
+      positionUnmake(&position, &entry);
+      printMove(stdout, moves[move_index]);
+      printf(": %lu\n", counter.leaves_);
+    }
+  }
+
+  if (check)
+  {
+    PerftCounter counter = {0, 0, 0};
+    result = perftCheck(&position, &deck, players, game, (int) depth, &counter);
+    if (result == 0)
+    {
+      printf("\ncheck: %lu nodes compared, %lu mismatches\n", counter.nodes_, counter.mismatches_);
+      result = counter.mismatches_ == 0 ? 0 : CHECK_FAILED;
+    }
+  }
+
+  freeMemory(game, players, total_cards);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the index of a card color in CARD_COLORS.
+///
+/// @param color color character of the card (b, g, w, r)
+///
+/// @return index of the color (0 - 3), 0 for an unknown color
+//
+int colorIndex(char color)
+{
+  const char *found = strchr(CARD_COLORS, color);
+  return (found == NULL || color == '\0') ? 0 : (int) (found - CARD_COLORS);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Maps a whole file read-only into memory.
+///
+/// @param file receives the mapping
+/// @param file_name path of the file (NULL for no file)
+///
+/// @return success(0) or ERROR if the file cannot be opened, is empty or cannot be mapped
+//
+int mapFile(MappedFile *file, const char *file_name)
+{
+  struct stat file_status;
+
+  memset(file, 0, sizeof(MappedFile));
+  if (file_name == NULL)
+  {
+    return ERROR;
+  }
+  int file_descriptor = open(file_name, O_RDONLY);
+  if (file_descriptor < 0)
+  {
+    return ERROR;
+  }
+  if (fstat(file_descriptor, &file_status) != 0 || file_status.st_size <= 0)
+  {
+    close(file_descriptor);
+    return ERROR;
+  }
+  void *data = mmap(NULL, (size_t) file_status.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+  close(file_descriptor);
+  if (data == MAP_FAILED)
+  {
+    return ERROR;
+  }
+  file->data_ = data;
+  file->size_ = (size_t) file_status.st_size;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Unmaps a file mapped by mapFile. Unmapping a file that was never mapped does nothing.
+///
+/// @param file mapping to release
+///
+/// @return void
+//
+void unmapFile(MappedFile *file)
+{
+  if (file->data_ != NULL)
+  {
+    munmap(file->data_, file->size_);
+  }
+  memset(file, 0, sizeof(MappedFile));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Maps an endgame table file into memory. The table stays usable until tablebaseClose is called, a table that could
+/// not be opened simply answers no positions.
+///
+/// @param table table to open
+/// @param file_name path of the table file (NULL for no table)
+///
+/// @return success(0) or ERROR if the file is missing or not a valid table
+//
+int tablebaseOpen(Tablebase *table, const char *file_name)
+{
+  size_t expected_size = sizeof(TablebaseHeader) + (size_t) TABLEBASE_ENTRIES * TABLEBASE_ENTRY_SIZE;
+
+  memset(table, 0, sizeof(Tablebase));
+  if (mapFile(&table->file_, file_name) != 0)
+  {
+    return ERROR;
+  }
+  const TablebaseHeader *header = table->file_.data_;
+  if (table->file_.size_ != expected_size || memcmp(header->magic_, "A3TB", 4) != 0 ||
+      header->version_ != TABLEBASE_VERSION || header->entry_count_ != TABLEBASE_ENTRIES ||
+      header->entry_size_ != TABLEBASE_ENTRY_SIZE)
+  {
+    unmapFile(&table->file_);
+    return ERROR;
+  }
+  table->entries_ = (const int8_t *) ((const char *) table->file_.data_ + sizeof(TablebaseHeader));
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Unmaps an endgame table.
+///
+/// @param table table to close
+///
+/// @return void
+//
+void tablebaseClose(Tablebase *table)
+{
+  unmapFile(&table->file_);
+  table->entries_ = NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Calculates the table index of a final round placement: one player places exactly two cards and never gets new
+/// ones. Only the order of the card numbers matters for the rules, so the key holds the colors of both cards, the
+/// shape of every row (where its first and last card lie relative to the two cards) and the row lengths, compressed
+/// so that differences of TABLEBASE_LENGTH_CAP or more (which two cards can no longer close) are stored as the cap.
+///
+/// @param position position of the player
+/// @param deck deck lookup table with the colors of every card
+/// @param player_index Array-index of player
+/// @param cards the two cards the player still has to place
+///
+/// @return table index or ERROR if the player does not have exactly two cards to place
+//
+int tablebaseIndex(const Position *position, const Deck *deck, int player_index, const CardSet *cards)
+{
+  int lengths[ENGINE_ROWS];
+  int sorted[ENGINE_ROWS];
+  int shape_code = 0;
+  int length_code = 0;
+
+  if (cardSetCount(cards) != 2)
+  {
+    return ERROR;
+  }
+  int first = cardSetNext(cards, 0);
+  int second = cardSetNext(cards, first);
+
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    const RowState *row = &position->row_[player_index][row_index];
+    int shape = 0;
+    if (row->length_ != 0)
+    {
+      shape = TABLEBASE_SHAPE_CODE[(first < row->low_) + (second < row->low_)]
+                                  [(first < row->high_) + (second < row->high_)];
+    }
+    shape_code = shape_code * TABLEBASE_SHAPES + shape;
+    lengths[row_index] = row->length_;
+    sorted[row_index] = row->length_;
+  }
+
+  for (int row_index = 1; row_index < ENGINE_ROWS; ++row_index)
+  {
+    for (int sort_index = row_index; sort_index > 0 && sorted[sort_index - 1] > sorted[sort_index]; --sort_index)
+    {
+      int temp = sorted[sort_index];
+      sorted[sort_index] = sorted[sort_index - 1];
+      sorted[sort_index - 1] = temp;
+    }
+  }
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    int compressed = 0;
+    for (int sort_index = 1; sort_index < ENGINE_ROWS && sorted[sort_index] <= lengths[row_index]; ++sort_index)
+    {
+      int difference = sorted[sort_index] - sorted[sort_index - 1];
+      compressed += difference < TABLEBASE_LENGTH_CAP ? difference : TABLEBASE_LENGTH_CAP;
+    }
+    length_code = length_code * TABLEBASE_LENGTHS + compressed;
+  }
+
+  int color_code = colorIndex(deck->color_[first]) * 4 + colorIndex(deck->color_[second]);
+  return (color_code * 343 + shape_code) * 343 + length_code;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Answers a position from the endgame table if no more hand cards will be passed: either every player is about to
+/// keep their last two hand cards, or all hands are empty and only chosen cards are left. Every player with two cards
+/// left costs one lookup, a player without cards keeps their current score.
+///
+/// @param table opened endgame table
+/// @param position position to answer
+/// @param deck deck lookup table with the colors of every card
+/// @param value receives the exact score margin of player 1
+///
+/// @return 1 if the position was answered, 0 otherwise
+//
+int tablebaseProbe(const Tablebase *table, const Position *position, const Deck *deck, int *value)
+{
+  const CardSet *cards;
+
+  if (table->entries_ == NULL)
+  {
+    return 0;
+  }
+  if (position->phase_ == PHASE_CHOOSING)
+  {
+    if (position->turn_ != 0 || position->picked_ != 0)
+    {
+      return 0;
+    }
+    cards = position->hand_cards_;
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      if (cardSetCount(&position->chosen_cards_[player_index]) != 0)
+      {
+        return 0;
+      }
+    }
+  }
+  else
+  {
+    cards = position->chosen_cards_;
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      if (cardSetCount(&position->hand_cards_[player_index]) != 0)
+      {
+        return 0;
+      }
+    }
+  }
+
+  int margin = 0;
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    int score = scorePosition(position, player_index);
+    if (cardSetCount(&cards[player_index]) != 0)
+    {
+      int index = tablebaseIndex(position, deck, player_index, &cards[player_index]);
+      if (index == ERROR)
+      {
+        return 0;
+      }
+      const int8_t *entry = &table->entries_[(size_t) index * TABLEBASE_ENTRY_SIZE];
+      int best = -SEARCH_INFINITY;
+      score = 0;
+      for (int row_index = 0; row_index <= ENGINE_ROWS; ++row_index)
+      {
+        int bonus = row_index < ENGINE_ROWS ? position->row_[player_index][row_index].points_ : 0;
+        if (row_index < ENGINE_ROWS)
+        {
+          score += bonus;
+        }
+        if (entry[row_index] >= 0 && entry[row_index] + bonus > best)
+        {
+          best = entry[row_index] + bonus;
+        }
+      }
+      score += best;
+    }
+    margin += player_index == 0 ? score : -score;
+  }
+  *value = margin;
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Plays every way of placing the chosen cards of player 1 and records the best result for every final longest row.
+/// The rows start without points, so the result is the sum of all placed cards plus the cards added to the longest
+/// row.
+///
+/// @param position position to solve
+/// @param deck deck lookup table with the points of every card
+/// @param entry table entry (best result per longest row, index ENGINE_ROWS if every row stays empty)
+///
+/// @return void
+//
+void tablebaseSolveNode(const Position *position, const Deck *deck, int8_t *entry)
+{
+  Move moves[SEARCH_MAX_MOVES];
+
+  if (position->phase_ != PHASE_ACTION)
+  {
+    int longest_row = ENGINE_ROWS;
+    int longest_length = 0;
+    int total_points = 0;
+    for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+    {
+      total_points += position->row_[0][row_index].points_;
+      if (position->row_[0][row_index].length_ > longest_length)
+      {
+        longest_length = position->row_[0][row_index].length_;
+        longest_row = row_index;
+      }
+    }
+    if (longest_row < ENGINE_ROWS)
+    {
+      total_points += position->row_[0][longest_row].points_;
+    }
+    if (total_points > entry[longest_row])
+    {
+      entry[longest_row] = (int8_t) total_points;
+    }
+    return;
+  }
+
+  int count = generateMoves(position, moves);
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    Position child = *position;
+    applyMove(&child, deck, moves[move_index]);
+    tablebaseSolveNode(&child, deck, entry);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Solves one table entry by building a representative position for its key: the two cards get the numbers 20 and
+/// 40 and every row gets first and last numbers in the gaps its shape describes.
+///
+/// @param index table index
+/// @param entry receives the table entry
+///
+/// @return void
+//
+void tablebaseSolveEntry(int index, int8_t *entry)
+{
+  const int gap_numbers[3] = {10, 30, 50};
+  Position position;
+  Deck deck;
+  int length_code = index % 343;
+  int shape_code = (index / 343) % 343;
+  int color_code = index / (343 * 343);
+  int has_empty_row = 0;
+
+  memset(&position, 0, sizeof(Position));
+  memset(&deck, 0, sizeof(Deck));
+  memset(entry, -1, TABLEBASE_ENTRY_SIZE);
+  deck.color_[20] = CARD_COLORS[color_code / 4];
+  deck.color_[40] = CARD_COLORS[color_code % 4];
+  deck.points_[20] = (uint8_t) colorPoints(deck.color_[20]);
+  deck.points_[40] = (uint8_t) colorPoints(deck.color_[40]);
+  cardSetAdd(&position.chosen_cards_[0], 20);
+  cardSetAdd(&position.chosen_cards_[0], 40);
+  position.phase_ = PHASE_ACTION;
+
+  for (int row_index = ENGINE_ROWS - 1; row_index >= 0; --row_index)
+  {
+    int shape = shape_code % TABLEBASE_SHAPES;
+    int length = length_code % TABLEBASE_LENGTHS;
+    RowState *row = &position.row_[0][row_index];
+    shape_code /= TABLEBASE_SHAPES;
+    length_code /= TABLEBASE_LENGTHS;
+    if (shape == 0)
+    {
+      has_empty_row = 1;
+      continue;
+    }
+    row->low_ = (uint8_t) gap_numbers[TABLEBASE_SHAPE_LOW[shape]];
+    row->high_ = (uint8_t) (gap_numbers[TABLEBASE_SHAPE_HIGH[shape]] +
+                            (TABLEBASE_SHAPE_LOW[shape] == TABLEBASE_SHAPE_HIGH[shape]));
+    row->length_ = (uint8_t) length;
+  }
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    RowState *row = &position.row_[0][row_index];
+    if (row->low_ != 0 && (!has_empty_row || row->length_ == 0))
+    {
+      row->length_++;
+    }
+  }
+  tablebaseSolveNode(&position, &deck, entry);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Generates the endgame table: "./a3 --gen-tablebase <table file>". The table does not depend on a deck, search and
+/// hint use it when the environment variable A3_TABLEBASE names the file.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage, 2 if the file cannot be written, 4 if out of memory
+//
+int runTablebaseTool(int argc, char *argv[], const char *tool_usage)
+{
+  TablebaseHeader header = {{'A', '3', 'T', 'B'}, TABLEBASE_VERSION, TABLEBASE_ENTRIES, TABLEBASE_ENTRY_SIZE};
+  struct timespec start;
+
+  if (argc != 3)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  int8_t *entries = ACCOUNT_MALLOC((size_t) TABLEBASE_ENTRIES * TABLEBASE_ENTRY_SIZE);
+  if (entries == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int index = 0; index < TABLEBASE_ENTRIES; ++index)
+  {
+    tablebaseSolveEntry(index, &entries[(size_t) index * TABLEBASE_ENTRY_SIZE]);
+  }
+
+  FILE *fp = fopen(argv[2], "wb");
+  if (fp == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    ACCOUNT_FREE(entries);
+    return 2;
+  }
+  size_t written = fwrite(&header, sizeof(header), 1, fp);
+  written += fwrite(entries, TABLEBASE_ENTRY_SIZE, TABLEBASE_ENTRIES, fp);
+  ACCOUNT_FREE(entries);
+  if (fclose(fp) != 0 || written != 1 + (size_t) TABLEBASE_ENTRIES)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    return 2;
+  }
+  printf("%d positions solved in %.1f s\n", TABLEBASE_ENTRIES, secondsSince(&start));
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the next number of a pseudo random sequence (splitmix64).
+///
+/// @param random state of the sequence
+///
+/// @return next pseudo random number
+//
+uint64_t randomNext(Random *random)
+{
+  uint64_t value = (random->state_ += 0x9E3779B97F4A7C15ULL);
+  value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+  return value ^ (value >> 31);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns a pseudo random number below a bound.
+///
+/// @param random state of the sequence
+/// @param bound exclusive upper bound (> 0)
+///
+/// @return pseudo random number in [0, bound)
+//
+int randomBelow(Random *random, int bound)
+{
+  return (int) (((randomNext(random) >> 32) * (uint64_t) bound) >> 32);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Rates a position for one player: the current score plus the points of every chosen card that still fits one of
+/// the player's rows.
+///
+/// @param position position to rate
+/// @param deck deck lookup table with the points of every card
+/// @param player_index Array-index of player
+///
+/// @return rating of the position
+//
+int heuristicScore(const Position *position, const Deck *deck, int player_index)
+{
+  int score = scorePosition(position, player_index);
+  const CardSet *chosen = &position->chosen_cards_[player_index];
+
+  for (int card = cardSetNext(chosen, 0); card != 0; card = cardSetNext(chosen, card))
+  {
+    for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+    {
+      const RowState *row = &position->row_[player_index][row_index];
+      if (row->length_ == 0 || card < row->low_ || card > row->high_)
+      {
+        score += deck->points_[card];
+        break;
+      }
+    }
+  }
+  return score;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Picks the move that rates best for the moving player after one move (heuristicScore). Without a random sequence
+/// the first of several equal moves wins, so the policy is deterministic; with one, a random best move is picked.
+///
+/// @param position position to move in (not over)
+/// @param deck deck lookup table with the points of every card
+/// @param random sequence for breaking ties (NULL to always pick the first best move)
+///
+/// @return the chosen move
+//
+Move greedyMove(const Position *position, const Deck *deck, Random *random)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  int count = generateMoves(position, moves);
+  int best_index = 0;
+  int best_score = -SEARCH_INFINITY;
+  int ties = 0;
+
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    Position child = *position;
+    applyMove(&child, deck, moves[move_index]);
+    int score = heuristicScore(&child, deck, position->turn_);
+    if (score > best_score)
+    {
+      best_score = score;
+      best_index = move_index;
+      ties = 1;
+    }
+    else if (score == best_score && random != NULL && randomBelow(random, ++ties) == 0)
+    {
+      best_index = move_index;
+    }
+  }
+  return moves[best_index];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Rates the rows and chosen cards of one player with the weights of a weighted policy: the points of the longest row
+/// (the bonus) times the longest weight, the share of card numbers that still extend a row (an empty row takes every
+/// number) times the headroom weight and the color values of every chosen card that still fits a row times the
+/// pending weight. The placed cards are not part of it, the rows only keep the sum of their points.
+///
+/// @param position position to rate
+/// @param deck deck lookup table with the color of every card
+/// @param player_index Array-index of player
+/// @param weights weights of the policy (POLICY_WEIGHTS)
+///
+/// @return rating of the position
+//
+double weightedScore(const Position *position, const Deck *deck, int player_index, const double *weights)
+{
+  const RowState *rows = position->row_[player_index];
+  const CardSet *chosen = &position->chosen_cards_[player_index];
+  int longest_length = 0;
+  int longest_points = 0;
+  int headroom = 0;
+  double pending = 0;
+
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    if (rows[row_index].length_ > longest_length)
+    {
+      longest_length = rows[row_index].length_;
+      longest_points = rows[row_index].points_;
+    }
+    headroom += rows[row_index].length_ == 0 ? MAX_CARD_NUMBER
+                                             : rows[row_index].low_ - 1 + MAX_CARD_NUMBER - rows[row_index].high_;
+  }
+  for (int card = cardSetNext(chosen, 0); card != 0; card = cardSetNext(chosen, card))
+  {
+    for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+    {
+      if (rows[row_index].length_ == 0 || card < rows[row_index].low_ || card > rows[row_index].high_)
+      {
+        pending += weights[colorIndex(deck->color_[card])];
+        break;
+      }
+    }
+  }
+  return weights[WEIGHT_LONGEST] * longest_points +
+         weights[WEIGHT_HEADROOM] * headroom / (ENGINE_ROWS * MAX_CARD_NUMBER) + weights[WEIGHT_PENDING] * pending;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Picks the move of a weighted policy: like greedyMove, but a placed card is worth the weight of its color and the
+/// rest of the position is rated by weightedScore. With the default weights (the Points of the colors, a longest and
+/// pending weight of 1 and no headroom) it picks the same moves as greedyMove.
+///
+/// @param position position to move in (not over)
+/// @param deck deck lookup table with the color of every card
+/// @param weights weights of the policy (POLICY_WEIGHTS)
+/// @param random sequence for breaking ties (NULL to always pick the first best move)
+///
+/// @return the chosen move
+//
+Move weightedMove(const Position *position, const Deck *deck, const double *weights, Random *random)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  int count = generateMoves(position, moves);
+  int best_index = 0;
+  double best_score = -INFINITY;
+  int ties = 0;
+
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    Position child = *position;
+    applyMove(&child, deck, moves[move_index]);
+    double score = weightedScore(&child, deck, position->turn_, weights);
+    if (moves[move_index].type_ == MOVE_PLACE)
+    {
+      score += weights[colorIndex(deck->color_[moves[move_index].card_])];
+    }
+    if (score > best_score)
+    {
+      best_score = score;
+      best_index = move_index;
+      ties = 1;
+    }
+    else if (score == best_score && random != NULL && randomBelow(random, ++ties) == 0)
+    {
+      best_index = move_index;
+    }
+  }
+  return moves[best_index];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Plays a position to the end with greedyMove for both players.
+///
+/// @param position position to play, holds the final position afterwards
+/// @param deck deck lookup table with the points of every card
+///
+/// @return final score margin of player 1
+//
+int playoutGreedy(Position *position, const Deck *deck)
+{
+  while (position->phase_ != PHASE_OVER)
+  {
+    applyMove(position, deck, greedyMove(position, deck, NULL));
+  }
+  return evaluatePosition(position);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Picks a random move for rollouts without generating the move list: two random hand cards in the card choosing
+/// phase, in the action phase a random chosen card in a random row it fits (see placeCardInRow), discarded only if it
+/// fits none.
+///
+/// @param position current position (not over)
+/// @param random sequence of the rollout
+///
+/// @return the chosen move
+//
+Move rolloutMove(const Position *position, Random *random)
+{
+  int turn = position->turn_;
+
+  if (position->phase_ == PHASE_CHOOSING)
+  {
+    const CardSet *hand = &position->hand_cards_[turn];
+    int count = cardSetCount(hand);
+    int first = randomBelow(random, count);
+    if (position->picked_ == 1 || count == 1)
+    {
+      return (Move) {MOVE_CHOOSE, (uint8_t) cardSetSelect(hand, first), 0, 0};
+    }
+    int second = randomBelow(random, count - 1);
+    second += second >= first;
+    return (Move) {MOVE_CHOOSE, (uint8_t) cardSetSelect(hand, first < second ? first : second),
+                   (uint8_t) cardSetSelect(hand, first < second ? second : first), 0};
+  }
+
+  const CardSet *chosen = &position->chosen_cards_[turn];
+  int card = cardSetSelect(chosen, randomBelow(random, cardSetCount(chosen)));
+  unsigned rows = 0;
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    const RowState *row = &position->row_[turn][row_index];
+    rows |= (unsigned) (row->length_ == 0 || card < row->low_ || card > row->high_) << row_index;
+  }
+  if (rows == 0)
+  {
+    return (Move) {MOVE_DISCARD, (uint8_t) card, 0, 0};
+  }
+  for (int skip = randomBelow(random, __builtin_popcount(rows)); skip > 0; --skip)
+  {
+    rows &= rows - 1;
+  }
+  return (Move) {MOVE_PLACE, (uint8_t) card, 0, (uint8_t) __builtin_ctz(rows)};
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Takes a random number below a small bound from the next 16 bits of a random number.
+///
+/// @param bits random bits, shifted by 16 bits
+/// @param bound exclusive upper bound (1 - 65536)
+///
+/// @return random number in [0, bound)
+//
+int rolloutBelow(uint64_t *bits, int bound)
+{
+  int value = (int) (((*bits & 0xFFFF) * (uint64_t) bound) >> 16);
+  *bits >>= 16;
+  return value;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Places a card in a random row of a player it fits (see placeCardInRow) or discards it if it fits none. The rows
+/// it fits are a mask of three bits, the row is looked up in ROLLOUT_ROW. A discarded card goes to the extra row
+/// rows[ENGINE_ROWS] that is never scored, and the bounds are updated with conditional moves, so no branch depends on
+/// the random cards.
+///
+/// @param rows rows of the player and one extra row for discarded cards
+/// @param deck deck lookup table with the points of every card
+/// @param card card to place
+/// @param bits random bits, shifted by 16 bits
+///
+/// @return void
+//
+void rolloutPlace(RowState *rows, const Deck *deck, int card, uint64_t *bits)
+{
+  unsigned mask = 0;
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    const RowState *row = &rows[row_index];
+    mask |= (unsigned) ((row->length_ == 0) | (card < row->low_) | (card > row->high_)) << row_index;
+  }
+  RowState *row = &rows[ROLLOUT_ROW[mask][rolloutBelow(bits, ROLLOUT_ROW_COUNT[mask])]];
+  int empty = row->length_ == 0;
+  row->low_ = (uint8_t) (empty | (card < row->low_) ? card : row->low_);
+  row->high_ = (uint8_t) (empty | (card > row->high_) ? card : row->high_);
+  row->length_++;
+  row->points_ = (uint8_t) (row->points_ + deck->points_[card]);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Plays a position to the end with random moves for both players, like rolloutMove: two random hand cards per
+/// round, every chosen card in a random row it fits. Moves are made with rolloutMove up to the start of the next
+/// round; from there on the hands and rows are copied once into local arrays, so picking a card is one multiplication,
+/// and every round of a player costs two random numbers. Uses no heap memory.
+///
+/// @param position position to play, holds the final position afterwards
+/// @param deck deck lookup table with the points of every card
+/// @param random sequence of the rollout
+///
+/// @return final score margin of player 1
+//
+int playoutRandom(Position *position, const Deck *deck, Random *random)
+{
+  uint8_t cards[ENGINE_PLAYERS][CARD_NUMBER_LIMIT];
+  RowState rows[ENGINE_PLAYERS][ENGINE_ROWS + 1];
+  int counts[ENGINE_PLAYERS];
+  int hands[ENGINE_PLAYERS];
+
+  while (position->phase_ != PHASE_OVER &&
+         (position->phase_ != PHASE_CHOOSING || position->turn_ != 0 || position->picked_ != 0 ||
+          cardSetCount(&position->chosen_cards_[0]) + cardSetCount(&position->chosen_cards_[1]) != 0))
+  {
+    applyMove(position, deck, rolloutMove(position, random));
+  }
+  if (position->phase_ == PHASE_OVER)
+  {
+    return evaluatePosition(position);
+  }
+
+  int cards_left = 0;
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    hands[player_index] = player_index;
+    counts[player_index] = 0;
+    for (int word = 0; word < 2; ++word)
+    {
+      for (uint64_t bits = position->hand_cards_[player_index].bits_[word]; bits != 0; bits &= bits - 1)
+      {
+        cards[player_index][counts[player_index]++] = (uint8_t) ((word << 6) + __builtin_ctzll(bits));
+      }
+    }
+    cards_left += counts[player_index];
+    memset(&position->hand_cards_[player_index], 0, sizeof(CardSet));
+    memcpy(rows[player_index], position->row_[player_index], sizeof(position->row_[player_index]));
+  }
+
+  while (cards_left != 0)
+  {
+    uint8_t chosen[ENGINE_PLAYERS][2];
+    int chosen_count[ENGINE_PLAYERS];
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      int hand = hands[player_index];
+      uint64_t bits = randomNext(random);
+      chosen_count[player_index] = counts[hand] < 2 ? counts[hand] : 2;
+      for (int pick = 0; pick < chosen_count[player_index]; ++pick)
+      {
+        int index = rolloutBelow(&bits, counts[hand]);
+        chosen[player_index][pick] = cards[hand][index];
+        cards[hand][index] = cards[hand][--counts[hand]];
+      }
+      cards_left -= chosen_count[player_index];
+    }
+
+    int first_hand = hands[0];
+    for (int player_index = 0; player_index < ENGINE_PLAYERS - 1; ++player_index)
+    {
+      hands[player_index] = hands[player_index + 1];
+    }
+    hands[ENGINE_PLAYERS - 1] = first_hand;
+
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      uint64_t bits = randomNext(random);
+      int first = chosen_count[player_index] == 2 ? rolloutBelow(&bits, 2) : 0;
+      for (int pick = 0; pick < chosen_count[player_index]; ++pick)
+      {
+        rolloutPlace(rows[player_index], deck, chosen[player_index][pick ^ first], &bits);
+      }
+    }
+  }
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    memcpy(position->row_[player_index], rows[player_index], sizeof(position->row_[player_index]));
+  }
+  position->phase_ = PHASE_OVER;
+  position->turn_ = 0;
+  position->picked_ = 0;
+  return evaluatePosition(position);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Encodes a dealt hand canonically: the cards in ascending order, 9 bits each (number and color index).
+///
+/// @param hand hand cards
+/// @param deck deck lookup table with the colors of every card
+/// @param key receives the two key words
+///
+/// @return success(0) or ERROR if the hand does not have MAX_CARD_PER_PLAYER cards
+//
+int bookKey(const CardSet *hand, const Deck *deck, uint64_t *key)
+{
+  int card_index = 0;
+
+  if (cardSetCount(hand) != MAX_CARD_PER_PLAYER)
+  {
+    return ERROR;
+  }
+  key[0] = 0;
+  key[1] = 0;
+  for (int card = cardSetNext(hand, 0); card != 0; card = cardSetNext(hand, card), ++card_index)
+  {
+    uint64_t *word = &key[card_index / 7];
+    *word = (*word << 9) | ((uint64_t) card << 2) | (uint64_t) colorIndex(deck->color_[card]);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Orders book entries by their key.
+///
+/// @param first first BookEntry
+/// @param second second BookEntry
+///
+/// @return negative, zero or positive like strcmp
+//
+int compareBookEntries(const void *first, const void *second)
+{
+  const BookEntry *first_entry = first;
+  const BookEntry *second_entry = second;
+
+  for (int word = 0; word < 2; ++word)
+  {
+    if (first_entry->key_[word] != second_entry->key_[word])
+    {
+      return first_entry->key_[word] < second_entry->key_[word] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Maps an opening book file into memory.
+///
+/// @param book book to open
+/// @param file_name path of the book file (NULL for no book)
+///
+/// @return success(0) or ERROR if the file is missing or not a valid book
+//
+int bookOpen(OpeningBook *book, const char *file_name)
+{
+  memset(book, 0, sizeof(OpeningBook));
+  if (mapFile(&book->file_, file_name) != 0)
+  {
+    return ERROR;
+  }
+  const BookHeader *header = book->file_.data_;
+  if (book->file_.size_ < sizeof(BookHeader) || memcmp(header->magic_, "A3OB", 4) != 0 ||
+      header->version_ != BOOK_VERSION || header->entry_size_ != sizeof(BookEntry) ||
+      book->file_.size_ != sizeof(BookHeader) + (size_t) header->entry_count_ * sizeof(BookEntry))
+  {
+    unmapFile(&book->file_);
+    return ERROR;
+  }
+  book->entries_ = (const BookEntry *) ((const char *) book->file_.data_ + sizeof(BookHeader));
+  book->entry_count_ = header->entry_count_;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Unmaps an opening book.
+///
+/// @param book book to close
+///
+/// @return void
+//
+void bookClose(OpeningBook *book)
+{
+  unmapFile(&book->file_);
+  book->entries_ = NULL;
+  book->entry_count_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Looks up the first choice of a player in the opening book. Only positions in which the player still holds the
+/// whole dealt hand and has no rows yet are in the book.
+///
+/// @param book opened opening book
+/// @param position current position
+/// @param deck deck lookup table with the colors of every card
+/// @param move receives the recommended move
+/// @param value receives the expected score margin of the player
+///
+/// @return 1 if the hand is in the book, 0 otherwise
+//
+int bookLookup(const OpeningBook *book, const Position *position, const Deck *deck, Move *move, int *value)
+{
+  BookEntry key_entry;
+  int turn = position->turn_;
+
+  if (book->entries_ == NULL || position->phase_ != PHASE_CHOOSING || position->picked_ != 0 ||
+      cardSetCount(&position->chosen_cards_[turn]) != 0)
+  {
+    return 0;
+  }
+  for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+  {
+    if (position->row_[turn][row_index].length_ != 0)
+    {
+      return 0;
+    }
+  }
+  if (bookKey(&position->hand_cards_[turn], deck, key_entry.key_) != 0)
+  {
+    return 0;
+  }
+
+  const BookEntry *entry = bsearch(&key_entry, book->entries_, book->entry_count_, sizeof(BookEntry),
+                                   compareBookEntries);
+  if (entry == NULL)
+  {
+    return 0;
+  }
+  *move = (Move) {MOVE_CHOOSE, entry->first_card_, entry->second_card_, 0};
+  *value = (entry->value_ + (entry->value_ >= 0 ? 5 : -5)) / 10;
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Rates every pair of a dealt hand by batch simulation: the hand is played as player 1 against random opponent hands
+/// (random numbers from the cards not in the hand, colors drawn without replacement from the other cards of the
+/// deck), both players continue with greedyMove. Every pair is played against the same opponent hands so that the
+/// comparison between pairs is fair.
+///
+/// @param hand dealt hand cards
+/// @param deck deck lookup table with the colors of all dealt cards
+/// @param games amount of simulated games per pair
+/// @param seed seed of the opponent hands
+/// @param entry receives key, best pair, expected margin (tenths of points) and games
+///
+/// @return void
+//
+void bookSimulateHand(const CardSet *hand, const Deck *deck, int games, uint64_t seed, BookEntry *entry)
+{
+  long best_total = 0;
+  int first_pair = 1;
+  char remaining[CARD_NUMBER_LIMIT];
+  int remaining_count = 0;
+
+  for (int card = 1; card < CARD_NUMBER_LIMIT; ++card)
+  {
+    if (deck->color_[card] != 0 && !cardSetContains(hand, card))
+    {
+      remaining[remaining_count++] = deck->color_[card];
+    }
+  }
+  bookKey(hand, deck, entry->key_);
+  entry->games_ = (uint32_t) games;
+  for (int first = cardSetNext(hand, 0); first != 0; first = cardSetNext(hand, first))
+  {
+    for (int second = cardSetNext(hand, first); second != 0; second = cardSetNext(hand, second))
+    {
+      long total = 0;
+      for (int game_index = 0; game_index < games; ++game_index)
+      {
+        Random random = {seed + (uint64_t) game_index * 0xD1B54A32D192ED03ULL};
+        Position position;
+        Deck game_deck = *deck;
+        char colors[CARD_NUMBER_LIMIT];
+        memcpy(colors, remaining, (size_t) remaining_count);
+        memset(&position, 0, sizeof(Position));
+        position.hand_cards_[0] = *hand;
+        for (int dealt = 0; dealt < MAX_CARD_PER_PLAYER;)
+        {
+          int card = 1 + randomBelow(&random, MAX_CARD_NUMBER);
+          if (!cardSetContains(hand, card) && !cardSetContains(&position.hand_cards_[1], card))
+          {
+            cardSetAdd(&position.hand_cards_[1], card);
+            if (dealt < remaining_count)
+            {
+              int pick = dealt + randomBelow(&random, remaining_count - dealt);
+              game_deck.color_[card] = colors[pick];
+              colors[pick] = colors[dealt];
+            }
+            else
+            {
+              game_deck.color_[card] = CARD_COLORS[randomBelow(&random, ENGINE_COLORS)];
+            }
+            game_deck.points_[card] = (uint8_t) colorPoints(game_deck.color_[card]);
+            dealt++;
+          }
+        }
+        applyMove(&position, &game_deck, (Move) {MOVE_CHOOSE, (uint8_t) first, (uint8_t) second, 0});
+        total += playoutGreedy(&position, &game_deck);
+      }
+      if (first_pair || total > best_total)
+      {
+        first_pair = 0;
+        best_total = total;
+        entry->first_card_ = (uint8_t) first;
+        entry->second_card_ = (uint8_t) second;
+      }
+    }
+  }
+  entry->value_ = (int16_t) (games > 0 ? best_total * 10 / games : 0);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Generates the opening book: "./a3 --gen-book <book file> <config file>... [--games <n>] [--seed <n>]". Both dealt
+/// hands of every config file are simulated, sorted by key and written to the book. Hint uses the book when the
+/// environment variable A3_BOOK names the file.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage, 2 if the book cannot be written or the error code of loading a config file
+//
+int runBookTool(int argc, char *argv[], const char *tool_usage)
+{
+  long games = BOOK_DEFAULT_GAMES;
+  long seed = 1;
+  uint32_t entry_count = 0;
+  int config_count = 0;
+  char *endptr = "";
+
+  int usage = argc < 4;
+  for (int argument = 3; argument < argc && !usage; ++argument)
+  {
+    if (strncmp(argv[argument], "--", 2) != 0)
+    {
+      config_count++;
+      continue;
+    }
+    const char *value = argument + 1 < argc ? argv[++argument] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument - 1], "--games") == 0)
+    {
+      games = strtol(value, &endptr, 10);
+      usage = games <= 0 || games > INT32_MAX;
+    }
+    else if (strcmp(argv[argument - 1], "--seed") == 0)
+    {
+      seed = strtol(value, &endptr, 10);
+      usage = seed <= 0;
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
+  }
+  if (usage || config_count == 0)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  BookEntry *entries = ACCOUNT_MALLOC(sizeof(BookEntry) * (size_t) config_count * ENGINE_PLAYERS);
+  if (entries == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+
+  for (int argument = 3; argument < argc; ++argument)
+  {
+    if (strncmp(argv[argument], "--", 2) == 0)
+    {
+      argument++;
+      continue;
+    }
+
+    Position position;
+    Deck deck;
+    int result = loadDeck(argv[argument], &position, &deck);
+    if (result != 0)
+    {
+      ACCOUNT_FREE(entries);
+      return result;
+    }
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      if (cardSetCount(&position.hand_cards_[player_index]) == MAX_CARD_PER_PLAYER)
+      {
+        bookSimulateHand(&position.hand_cards_[player_index], &deck, (int) games, (uint64_t) seed,
+                         &entries[entry_count++]);
+      }
+    }
+  }
+
+  qsort(entries, entry_count, sizeof(BookEntry), compareBookEntries);
+  uint32_t unique_count = 0;
+  for (uint32_t entry_index = 0; entry_index < entry_count; ++entry_index)
+  {
+    if (unique_count == 0 || compareBookEntries(&entries[unique_count - 1], &entries[entry_index]) != 0)
+    {
+      entries[unique_count++] = entries[entry_index];
+    }
+  }
+
+  BookHeader header = {{'A', '3', 'O', 'B'}, BOOK_VERSION, unique_count, sizeof(BookEntry)};
+  FILE *fp = fopen(argv[2], "wb");
+  if (fp == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    ACCOUNT_FREE(entries);
+    return 2;
+  }
+  size_t written = fwrite(&header, sizeof(header), 1, fp);
+  written += fwrite(entries, sizeof(BookEntry), unique_count, fp);
+  ACCOUNT_FREE(entries);
+  if (fclose(fp) != 0 || written != 1 + (size_t) unique_count)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    return 2;
+  }
+  printf("%u hands written to the opening book\n", unique_count);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens the outcome cache file (created if it does not exist yet). The file is mapped shared, so several processes
+/// and threads can use it at the same time; without write permission it is mapped read-only and only looked up.
+///
+/// @param cache receives the cache (slots_ is NULL if it cannot be used)
+/// @param file_name name of the cache file (NULL to use no cache)
+///
+/// @return success(0) or ERROR
+//
+int cacheOpen(OutcomeCache *cache, const char *file_name)
+{
+  size_t size = sizeof(CacheHeader) + CACHE_SLOTS * sizeof(CacheSlot);
+  struct stat file_status;
+
+  memset(cache, 0, sizeof(OutcomeCache));
+  if (file_name == NULL)
+  {
+    return ERROR;
+  }
+  cache->writable_ = 1;
+  int file_descriptor = open(file_name, O_RDWR | O_CREAT, 0644);
+  if (file_descriptor < 0)
+  {
+    cache->writable_ = 0;
+    file_descriptor = open(file_name, O_RDONLY);
+  }
+  if (file_descriptor < 0)
+  {
+    return ERROR;
+  }
+  if (fstat(file_descriptor, &file_status) == 0 && file_status.st_size == 0 && cache->writable_)
+  {
+    CacheHeader header = {{'A', '3', 'O', 'C'}, CACHE_VERSION, CACHE_SLOTS, sizeof(CacheSlot)};
+    if (ftruncate(file_descriptor, (off_t) size) != 0 || pwrite(file_descriptor, &header, sizeof(header), 0) !=
+        (ssize_t) sizeof(header))
+    {
+      close(file_descriptor);
+      return ERROR;
+    }
+  }
+  else if (fstat(file_descriptor, &file_status) != 0 || (size_t) file_status.st_size != size)
+  {
+    close(file_descriptor);
+    return ERROR;
+  }
+  void *data = mmap(NULL, size, cache->writable_ ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED,
+                    file_descriptor, 0);
+  close(file_descriptor);
+  if (data == MAP_FAILED)
+  {
+    return ERROR;
+  }
+  cache->file_.data_ = data;
+  cache->file_.size_ = size;
+  const CacheHeader *header = data;
+  if (memcmp(header->magic_, "A3OC", 4) != 0 || header->version_ != CACHE_VERSION ||
+      header->slot_count_ != CACHE_SLOTS || header->slot_size_ != sizeof(CacheSlot))
+  {
+    cacheClose(cache);
+    return ERROR;
+  }
+  cache->slots_ = (CacheSlot *) ((char *) data + sizeof(CacheHeader));
+  cache->slot_count_ = header->slot_count_;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Unmaps an outcome cache.
+///
+/// @param cache cache to close
+///
+/// @return void
+//
+void cacheClose(OutcomeCache *cache)
+{
+  unmapFile(&cache->file_);
+  memset(cache, 0, sizeof(OutcomeCache));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Builds the 128-bit content address of an outcome: a hash of everything the outcome depends on, i.e. the kind of
+/// outcome, the rules, the position with the points of every card still in play, the policy pair with the weights of
+/// a weighted policy and the seed, width and game limit of an analysis. The config files of two equal deals get the
+/// same address, no matter which cards follow the dealt ones.
+///
+/// @param key receives the two key words (never 0, 0)
+/// @param kind kind of the outcome
+/// @param position position the outcome belongs to (the start position for an analysis)
+/// @param deck deck lookup table with the points of every card
+/// @param policies policies of both players (NULL if the outcome does not depend on them)
+/// @param job analysis the outcome belongs to (NULL if it is not an analysis)
+///
+/// @return void
+//
+void cacheKey(uint64_t *key, CacheKind kind, const Position *position, const Deck *deck, const Policy *policies,
+              const AnalysisJob *job)
+{
+  CacheContent content;
+  uint64_t word;
+
+  memset(&content, 0, sizeof(CacheContent));
+  content.kind_ = (uint32_t) kind;
+  content.rules_[0] = RULES_VERSION;
+  content.rules_[1] = ENGINE_ROWS;
+  content.rules_[2] = (uint32_t) MAX_CARD_PER_PLAYER;
+  memcpy(content.hand_cards_, position->hand_cards_, sizeof(content.hand_cards_));
+  memcpy(content.chosen_cards_, position->chosen_cards_, sizeof(content.chosen_cards_));
+  memcpy(content.row_, position->row_, sizeof(content.row_));
+  content.phase_ = position->phase_;
+  content.turn_ = position->turn_;
+  content.picked_ = position->picked_;
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    for (int card = cardSetNext(&position->hand_cards_[player_index], 0); card != 0;
+         card = cardSetNext(&position->hand_cards_[player_index], card))
+    {
+      content.points_[card] = deck->points_[card];
+    }
+    for (int card = cardSetNext(&position->chosen_cards_[player_index], 0); card != 0;
+         card = cardSetNext(&position->chosen_cards_[player_index], card))
+    {
+      content.points_[card] = deck->points_[card];
+    }
+    if (policies != NULL)
+    {
+      content.policy_types_[player_index] = (uint8_t) policies[player_index].type_;
+      content.policy_milliseconds_[player_index] = policies[player_index].milliseconds_;
+      if (policies[player_index].type_ == POLICY_WEIGHTED)
+      {
+        memcpy(content.policy_weights_[player_index], policies[player_index].weights_,
+               sizeof(content.policy_weights_[player_index]));
+      }
+    }
+  }
+  if (job != NULL)
+  {
+    content.analysis_seed_ = job->seed_;
+    content.analysis_max_games_ = job->max_games_;
+    content.analysis_width_ = job->width_;
+  }
+
+  Random lanes[2] = {{0x243F6A8885A308D3ULL}, {0x13198A2E03707344ULL}};
+  for (size_t offset = 0; offset < sizeof(CacheContent); offset += sizeof(word))
+  {
+    memcpy(&word, (const char *) &content + offset, sizeof(word));
+    for (int lane = 0; lane < 2; ++lane)
+    {
+      lanes[lane].state_ ^= word;
+      key[lane] = randomNext(&lanes[lane]);
+    }
+  }
+  key[0] |= 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Looks up an outcome without any lock: every slot is guarded by a sequence number that is odd while the slot is
+/// written, and a reader retries the next probe if the number changed while it copied the slot.
+///
+/// @param cache opened cache
+/// @param key content address built by cacheKey
+/// @param value receives the outcome
+///
+/// @return 1 if the outcome was found, 0 otherwise
+//
+int cacheLookup(const OutcomeCache *cache, const uint64_t *key, CacheValue *value)
+{
+  if (cache->slots_ == NULL)
+  {
+    return 0;
+  }
+  for (uint32_t probe = 0; probe < CACHE_PROBES; ++probe)
+  {
+    CacheSlot *slot = &cache->slots_[(key[0] + probe) % cache->slot_count_];
+    uint64_t sequence = atomic_load_explicit(&slot->sequence_, memory_order_acquire);
+    uint64_t stored_key[2];
+    CacheValue stored_value;
+    if (sequence & 1)
+    {
+      continue;
+    }
+    memcpy(stored_key, slot->key_, sizeof(stored_key));
+    memcpy(&stored_value, &slot->value_, sizeof(CacheValue));
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->sequence_, memory_order_relaxed) == sequence &&
+        stored_key[0] == key[0] && stored_key[1] == key[1])
+    {
+      *value = stored_value;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Stores an outcome in the slot that already holds its key, in a free slot or in the first probed slot. A writer owns
+/// a slot by making its sequence number odd; if another writer owns it right now the outcome is simply not stored.
+///
+/// @param cache opened cache
+/// @param key content address built by cacheKey
+/// @param value outcome to store
+///
+/// @return void
+//
+void cacheStore(const OutcomeCache *cache, const uint64_t *key, const CacheValue *value)
+{
+  if (cache->slots_ == NULL || !cache->writable_)
+  {
+    return;
+  }
+  CacheSlot *target = &cache->slots_[key[0] % cache->slot_count_];
+  for (uint32_t probe = 0; probe < CACHE_PROBES; ++probe)
+  {
+    CacheSlot *slot = &cache->slots_[(key[0] + probe) % cache->slot_count_];
+    if (slot->key_[0] == key[0] && slot->key_[1] == key[1])
+    {
+      target = slot;
+      break;
+    }
+    if (slot->key_[0] == 0 && target->key_[0] != 0)
+    {
+      target = slot;
+    }
+  }
+
+  uint64_t sequence = atomic_load_explicit(&target->sequence_, memory_order_relaxed);
+  if ((sequence & 1) || !atomic_compare_exchange_strong(&target->sequence_, &sequence, sequence + 1))
+  {
+    return;
+  }
+  memcpy(target->key_, key, sizeof(target->key_));
+  memcpy(&target->value_, value, sizeof(CacheValue));
+  atomic_store_explicit(&target->sequence_, sequence + 2, memory_order_release);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens the endgame table, the opening book and the outcome cache named by the environment variables A3_TABLEBASE,
+/// A3_BOOK and A3_CACHE. Missing files are fine, the engine then searches those positions instead.
+///
+/// @param engine engine to open
+///
+/// @return void
+//
+void engineOpen(Engine *engine)
+{
+  tablebaseOpen(&engine->tablebase_, getenv("A3_TABLEBASE"));
+  bookOpen(&engine->book_, getenv("A3_BOOK"));
+  cacheOpen(&engine->cache_, getenv("A3_CACHE"));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Closes the endgame table, the opening book and the outcome cache of an engine.
+///
+/// @param engine engine to close
+///
+/// @return void
+//
+void engineClose(Engine *engine)
+{
+  tablebaseClose(&engine->tablebase_);
+  bookClose(&engine->book_);
+  cacheClose(&engine->cache_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Parses a policy name: "random", "greedy", "rollout", "search[:<milliseconds per move>]" or
+/// "weighted[:<weight>,...]". The weights of a weighted policy are given in the order of POLICY_WEIGHT_NAMES, missing
+/// ones keep POLICY_DEFAULT_WEIGHTS.
+///
+/// @param text policy name
+/// @param policy receives the policy
+///
+/// @return success(0) or ERROR for an unknown policy
+//
+int parsePolicy(const char *text, Policy *policy)
+{
+  char *endptr;
+
+  policy->milliseconds_ = POLICY_DEFAULT_MILLISECONDS;
+  memcpy(policy->weights_, POLICY_DEFAULT_WEIGHTS, sizeof(policy->weights_));
+  if (strcmp(text, "random") == 0)
+  {
+    policy->type_ = POLICY_RANDOM;
+    return 0;
+  }
+  if (strcmp(text, "greedy") == 0)
+  {
+    policy->type_ = POLICY_GREEDY;
+    return 0;
+  }
+  if (strcmp(text, "rollout") == 0)
+  {
+    policy->type_ = POLICY_ROLLOUT;
+    return 0;
+  }
+  if (strncmp(text, "weighted", 8) == 0)
+  {
+    policy->type_ = POLICY_WEIGHTED;
+    const char *cursor = text + 8;
+    for (int weight = 0; weight < POLICY_WEIGHTS && *cursor == (weight == 0 ? ':' : ','); ++weight)
+    {
+      policy->weights_[weight] = strtod(cursor + 1, &endptr);
+      if (endptr == cursor + 1 || !isfinite(policy->weights_[weight]))
+      {
+        return ERROR;
+      }
+      cursor = endptr;
+    }
+    return *cursor == '\0' ? 0 : ERROR;
+  }
+  if (strncmp(text, "search", 6) == 0)
+  {
+    policy->type_ = POLICY_SEARCH;
+    if (text[6] == '\0')
+    {
+      return 0;
+    }
+    if (text[6] == ':')
+    {
+      policy->milliseconds_ = strtol(text + 7, &endptr, 10);
+      if (*endptr == '\0' && policy->milliseconds_ > 0)
+      {
+        return 0;
+      }
+    }
+  }
+  return ERROR;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Lets a policy pick a move. The search policy takes the first choice from the opening book if the hand is in it
+/// and answers final round positions from the endgame table.
+///
+/// @param policy policy of the moving player
+/// @param position position to move in (not over)
+/// @param deck deck lookup table with the points of every card
+/// @param engine opened endgame table and opening book
+/// @param random sequence of the game
+///
+/// @return the chosen move
+//
+Move policyMove(const Policy *policy, const Position *position, const Deck *deck, const Engine *engine,
+                Random *random)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  SearchResult result;
+
+  switch (policy->type_)
+  {
+    case POLICY_RANDOM:
+      return moves[randomBelow(random, generateMoves(position, moves))];
+    case POLICY_GREEDY:
+      return greedyMove(position, deck, random);
+    case POLICY_ROLLOUT:
+      return rolloutMove(position, random);
+    case POLICY_WEIGHTED:
+      return weightedMove(position, deck, policy->weights_, random);
+    default:
+      if (bookLookup(&engine->book_, position, deck, &result.move_, &result.value_))
+      {
+        return result.move_;
+      }
+      searchIterative(position, deck, &engine->tablebase_, policy->milliseconds_, &result);
+      return result.move_.card_ != 0 ? result.move_ : greedyMove(position, deck, random);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Plays one game from a start position to the end.
+///
+/// @param start start position
+/// @param deck deck lookup table with the points of every card
+/// @param policies policy of every player
+/// @param engine opened endgame table and opening book
+/// @param random sequence of the game
+/// @param final_position receives the final position
+/// @param records receives a trajectory record of every decision (NULL if not needed)
+/// @param record_count receives the amount of records (NULL if not needed)
+/// @param game_record receives the game record for the game store, except for the deal (NULL if not needed)
+///
+/// @return final score margin of player 1
+//
+int playGame(const Position *start, const Deck *deck, const Policy *policies, const Engine *engine, Random *random,
+             Position *final_position, TrajectoryRecord *records, int *record_count, GameRecord *game_record)
+{
+  int count = 0;
+
+  if (game_record != NULL)
+  {
+    memset(game_record, 0, sizeof(GameRecord));
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      const CardSet *hand = &start->hand_cards_[player_index];
+      game_record->hand_cards_[player_index] = *hand;
+      for (int card = cardSetNext(hand, 0); card != 0; card = cardSetNext(hand, card))
+      {
+        int color = colorIndex(deck->color_[card]);
+        if (color & 1)
+        {
+          cardSetAdd(&game_record->hand_colors_[player_index][0], card);
+        }
+        if (color & 2)
+        {
+          cardSetAdd(&game_record->hand_colors_[player_index][1], card);
+        }
+      }
+    }
+  }
+
+  *final_position = *start;
+  while (final_position->phase_ != PHASE_OVER)
+  {
+    Move move = policyMove(&policies[final_position->turn_], final_position, deck, engine, random);
+    if (records != NULL && count < TRAJECTORY_GAME_RECORDS)
+    {
+      trajectoryRecord(&records[count++], final_position, move);
+    }
+    if (game_record != NULL && move.type_ == MOVE_PLACE)
+    {
+      game_record->color_count_[final_position->turn_][colorIndex(deck->color_[move.card_])]++;
+    }
+    applyMove(final_position, deck, move);
+  }
+  if (game_record != NULL)
+  {
+    int margin = evaluatePosition(final_position);
+    game_record->winner_ = (int8_t) (margin > 0 ? 0 : (margin < 0 ? 1 : ENGINE_PLAYERS));
+    for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+    {
+      game_record->points_[player_index] = (int16_t) scorePosition(final_position, player_index);
+      for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+      {
+        game_record->row_length_[player_index][row_index] = final_position->row_[player_index][row_index].length_;
+      }
+    }
+  }
+  if (records != NULL)
+  {
+    for (int record_index = 0; record_index < count; ++record_index)
+    {
+      for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+      {
+        records[record_index].final_score_[player_index] = (int16_t) scorePosition(final_position, player_index);
+      }
+    }
+    *record_count = count;
+  }
+  return evaluatePosition(final_position);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Fills the features of a decision into a trajectory record: the hand and chosen cards of both players as bit masks,
+/// the first card, last card and length of every row, the scores so far and the move. The game number and the final
+/// scores are filled in later.
+///
+/// @param record record to fill
+/// @param position position the decision is made in
+/// @param move chosen move
+///
+/// @return void
+//
+void trajectoryRecord(TrajectoryRecord *record, const Position *position, Move move)
+{
+  memset(record, 0, sizeof(TrajectoryRecord));
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    record->hand_cards_[player_index] = position->hand_cards_[player_index];
+    record->chosen_cards_[player_index] = position->chosen_cards_[player_index];
+    record->score_[player_index] = (int16_t) scorePosition(position, player_index);
+    for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+    {
+      record->row_low_[player_index][row_index] = position->row_[player_index][row_index].low_;
+      record->row_high_[player_index][row_index] = position->row_[player_index][row_index].high_;
+      record->row_length_[player_index][row_index] = position->row_[player_index][row_index].length_;
+    }
+  }
+  record->move_ = move;
+  record->phase_ = position->phase_;
+  record->turn_ = position->turn_;
+  record->picked_ = position->picked_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Creates a trajectory file, writes its header (with the points of every card of the deck) and starts the thread
+/// that writes the records. The simulation threads fill one buffer while the thread writes the other one.
+///
+/// @param writer writer to start
+/// @param file_name name of the trajectory file
+/// @param deck deck lookup table with the points of every card
+///
+/// @return success(0), 2 if the file cannot be written or OUT_OF_MEMORY
+//
+int trajectoryOpen(TrajectoryWriter *writer, const char *file_name, const Deck *deck)
+{
+  TrajectoryHeader header = {{'A', '3', 'T', 'R'}, TRAJECTORY_VERSION, sizeof(TrajectoryRecord), 0, {0}};
+
+  memset(writer, 0, sizeof(TrajectoryWriter));
+  memcpy(header.points_, deck->points_, sizeof(header.points_));
+  writer->buffers_[0] = ACCOUNT_MALLOC(2 * TRAJECTORY_BUFFER_RECORDS * sizeof(TrajectoryRecord));
+  if (writer->buffers_[0] == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+  writer->buffers_[1] = writer->buffers_[0] + TRAJECTORY_BUFFER_RECORDS;
+  writer->file_ = fopen(file_name, "wb");
+  if (writer->file_ == NULL || fwrite(&header, sizeof(header), 1, writer->file_) != 1)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    if (writer->file_ != NULL)
+    {
+      fclose(writer->file_);
+    }
+    ACCOUNT_FREE(writer->buffers_[0]);
+    return 2;
+  }
+  pthread_mutex_init(&writer->mutex_, NULL);
+  pthread_cond_init(&writer->full_, NULL);
+  pthread_cond_init(&writer->free_, NULL);
+  if (pthread_create(&writer->thread_, NULL, trajectoryWriterThread, writer) != 0)
+  {
+    printf("Error: Out of memory\n");
+    pthread_mutex_destroy(&writer->mutex_);
+    pthread_cond_destroy(&writer->full_);
+    pthread_cond_destroy(&writer->free_);
+    fclose(writer->file_);
+    ACCOUNT_FREE(writer->buffers_[0]);
+    return OUT_OF_MEMORY;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Thread of a trajectory writer: writes every buffer handed over by trajectoryAppend or trajectoryClose to the file,
+/// without holding the lock, until the writer is closed.
+///
+/// @param argument TrajectoryWriter of the thread
+///
+/// @return NULL
+//
+void *trajectoryWriterThread(void *argument)
+{
+  TrajectoryWriter *writer = argument;
+
+  pthread_mutex_lock(&writer->mutex_);
+  for (;;)
+  {
+    while (!writer->writing_ && !writer->closing_)
+    {
+      pthread_cond_wait(&writer->full_, &writer->mutex_);
+    }
+    if (!writer->writing_)
+    {
+      break;
+    }
+    int buffer = 1 - writer->active_;
+    pthread_mutex_unlock(&writer->mutex_);
+    size_t written = fwrite(writer->buffers_[buffer], sizeof(TrajectoryRecord), writer->length_[buffer],
+                            writer->file_);
+    pthread_mutex_lock(&writer->mutex_);
+    writer->error_ = writer->error_ || written != writer->length_[buffer];
+    writer->writing_ = 0;
+    pthread_cond_broadcast(&writer->free_);
+  }
+  pthread_mutex_unlock(&writer->mutex_);
+  return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Appends the records of a whole chunk of games at once. The game numbers of the records count from 0 within the
+/// chunk and are moved behind the games appended before. A full buffer is handed over to the writer thread; the
+/// caller only waits if the writer thread is still busy with the other buffer by then.
+///
+/// @param writer started writer
+/// @param records records of the games
+/// @param count amount of records (at most TRAJECTORY_BUFFER_RECORDS)
+/// @param games amount of games in the chunk
+///
+/// @return void
+//
+void trajectoryAppend(TrajectoryWriter *writer, const TrajectoryRecord *records, int count, int games)
+{
+  pthread_mutex_lock(&writer->mutex_);
+  if (writer->length_[writer->active_] + (size_t) count > TRAJECTORY_BUFFER_RECORDS)
+  {
+    while (writer->writing_)
+    {
+      pthread_cond_wait(&writer->free_, &writer->mutex_);
+    }
+    writer->active_ = 1 - writer->active_;
+    writer->length_[writer->active_] = 0;
+    writer->writing_ = 1;
+    pthread_cond_signal(&writer->full_);
+  }
+  TrajectoryRecord *destination = &writer->buffers_[writer->active_][writer->length_[writer->active_]];
+  memcpy(destination, records, (size_t) count * sizeof(TrajectoryRecord));
+  for (int record_index = 0; record_index < count; ++record_index)
+  {
+    destination[record_index].game_ += writer->games_;
+  }
+  writer->length_[writer->active_] += (size_t) count;
+  writer->games_ += (uint32_t) games;
+  writer->records_ += (unsigned long) count;
+  pthread_mutex_unlock(&writer->mutex_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Hands the last buffer over, waits for the writer thread and closes the trajectory file.
+///
+/// @param writer started writer
+///
+/// @return success(0) or ERROR if a record could not be written
+//
+int trajectoryClose(TrajectoryWriter *writer)
+{
+  pthread_mutex_lock(&writer->mutex_);
+  while (writer->writing_)
+  {
+    pthread_cond_wait(&writer->free_, &writer->mutex_);
+  }
+  if (writer->length_[writer->active_] != 0)
+  {
+    writer->active_ = 1 - writer->active_;
+    writer->writing_ = 1;
+  }
+  writer->closing_ = 1;
+  pthread_cond_signal(&writer->full_);
+  pthread_mutex_unlock(&writer->mutex_);
+  pthread_join(writer->thread_, NULL);
+
+  int error = writer->error_;
+  error = fclose(writer->file_) != 0 || error;
+  pthread_mutex_destroy(&writer->mutex_);
+  pthread_cond_destroy(&writer->full_);
+  pthread_cond_destroy(&writer->free_);
+  ACCOUNT_FREE(writer->buffers_[0]);
+  return error ? ERROR : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Hashes a deal: the dealt hands with the points of every card (see cacheKey). Config files that only differ after
+/// the dealt cards get the same hash.
+///
+/// @param start start position of the deal
+/// @param deck deck lookup table with the points of every card
+///
+/// @return hash of the deal (not negative)
+//
+int64_t dealHash(const Position *start, const Deck *deck)
+{
+  uint64_t key[2];
+  cacheKey(key, CACHE_DEAL, start, deck, NULL, NULL);
+  return (int64_t) (key[0] >> 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens a game store for appending. Games are collected and written in blocks of STORE_BLOCK_GAMES games.
+///
+/// @param writer receives the writer
+/// @param file_name name of the game store file
+///
+/// @return success(0), 2 if the file cannot be opened or OUT_OF_MEMORY
+//
+int storeOpen(StoreWriter *writer, const char *file_name)
+{
+  memset(writer, 0, sizeof(StoreWriter));
+  writer->games_ = ACCOUNT_MALLOC(STORE_BLOCK_GAMES * sizeof(GameRecord));
+  if (writer->games_ == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+  writer->file_ = fopen(file_name, "ab");
+  if (writer->file_ == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    ACCOUNT_FREE(writer->games_);
+    return 2;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the width of a column of the game store in bytes.
+///
+/// @param column StoreColumn
+///
+/// @return width of one value
+//
+int storeColumnWidth(int column)
+{
+  if (column == STORE_DEAL)
+  {
+    return sizeof(int64_t);
+  }
+  if (column >= STORE_POINTS && column < STORE_ROW_LENGTH)
+  {
+    return sizeof(int16_t);
+  }
+  if (column >= STORE_HAND_COLORS)
+  {
+    return 2 * sizeof(CardSet);
+  }
+  if (column >= STORE_HAND)
+  {
+    return sizeof(CardSet);
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the value of a numeric column (everything but the hands) of a game record.
+///
+/// @param record game record
+/// @param column StoreColumn below STORE_HAND
+///
+/// @return value
+//
+int64_t gameRecordValue(const GameRecord *record, int column)
+{
+  if (column == STORE_DEAL)
+  {
+    return record->deal_;
+  }
+  if (column == STORE_WINNER)
+  {
+    return record->winner_;
+  }
+  if (column < STORE_ROW_LENGTH)
+  {
+    return record->points_[column - STORE_POINTS];
+  }
+  if (column < STORE_COLOR_COUNT)
+  {
+    int index = column - STORE_ROW_LENGTH;
+    return record->row_length_[index / ENGINE_ROWS][index % ENGINE_ROWS];
+  }
+  int index = column - STORE_COLOR_COUNT;
+  return record->color_count_[index / ENGINE_COLORS][index % ENGINE_COLORS];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes the collected games as one block: a header with the offset, the minimum and the maximum of every column
+/// and the union of the hands, followed by the columns, each one aligned to STORE_ALIGNMENT bytes.
+///
+/// @param writer opened writer
+///
+/// @return success(0), ERROR if the block cannot be written or OUT_OF_MEMORY
+//
+int storeFlush(StoreWriter *writer)
+{
+  size_t count = (size_t) writer->game_count_;
+  size_t size = sizeof(StoreBlockHeader);
+
+  if (count == 0)
+  {
+    return 0;
+  }
+  for (int column = 0; column < STORE_COLUMN_COUNT; ++column)
+  {
+    size += (count * (size_t) storeColumnWidth(column) + STORE_ALIGNMENT - 1) / STORE_ALIGNMENT * STORE_ALIGNMENT;
+  }
+  uint8_t *block = ACCOUNT_CALLOC(1, size);
+  if (block == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+  StoreBlockHeader *header = (StoreBlockHeader *) block;
+  memcpy(header->magic_, "A3GS", 4);
+  header->version_ = STORE_VERSION;
+  header->game_count_ = (uint32_t) count;
+  header->column_count_ = STORE_COLUMN_COUNT;
+  header->block_size_ = size;
+
+  uint64_t offset = sizeof(StoreBlockHeader);
+  for (int column = 0; column < STORE_COLUMN_COUNT; ++column)
+  {
+    StoreColumnInfo *info = &header->columns_[column];
+    int width = storeColumnWidth(column);
+    uint8_t *values = block + offset;
+    info->offset_ = offset;
+    offset += (count * (size_t) width + STORE_ALIGNMENT - 1) / STORE_ALIGNMENT * STORE_ALIGNMENT;
+    for (size_t game = 0; game < count; ++game)
+    {
+      const GameRecord *record = &writer->games_[game];
+      if (column >= STORE_HAND_COLORS)
+      {
+        memcpy(values + game * (size_t) width, record->hand_colors_[column - STORE_HAND_COLORS], (size_t) width);
+        continue;
+      }
+      if (column >= STORE_HAND)
+      {
+        const CardSet *hand = &record->hand_cards_[column - STORE_HAND];
+        memcpy(values + game * (size_t) width, hand, (size_t) width);
+        header->held_[column - STORE_HAND].bits_[0] |= hand->bits_[0];
+        header->held_[column - STORE_HAND].bits_[1] |= hand->bits_[1];
+        continue;
+      }
+      int64_t value = gameRecordValue(record, column);
+      if (width == sizeof(int64_t))
+      {
+        ((int64_t *) values)[game] = value;
+      }
+      else if (width == sizeof(int16_t))
+      {
+        ((int16_t *) values)[game] = (int16_t) value;
+      }
+      else
+      {
+        ((int8_t *) values)[game] = (int8_t) value;
+      }
+      info->min_ = game == 0 || value < info->min_ ? value : info->min_;
+      info->max_ = game == 0 || value > info->max_ ? value : info->max_;
+    }
+  }
+
+  size_t written = fwrite(block, size, 1, writer->file_);
+  ACCOUNT_FREE(block);
+  writer->written_ += (long) count;
+  writer->game_count_ = 0;
+  return written == 1 ? 0 : ERROR;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds finished games to the game store.
+///
+/// @param writer opened writer
+/// @param games game records
+/// @param count amount of game records
+///
+/// @return success(0), ERROR if a block cannot be written or OUT_OF_MEMORY
+//
+int storeAppend(StoreWriter *writer, const GameRecord *games, int count)
+{
+  for (int game = 0; game < count; ++game)
+  {
+    writer->games_[writer->game_count_++] = games[game];
+    if (writer->game_count_ == STORE_BLOCK_GAMES)
+    {
+      int result = storeFlush(writer);
+      if (result != 0)
+      {
+        return result;
+      }
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes the last block and closes the game store.
+///
+/// @param writer opened writer
+///
+/// @return success(0), ERROR if a block cannot be written or OUT_OF_MEMORY
+//
+int storeClose(StoreWriter *writer)
+{
+  int result = writer->error_ != 0 ? writer->error_ : storeFlush(writer);
+  if (fclose(writer->file_) != 0 && result == 0)
+  {
+    result = ERROR;
+  }
+  ACCOUNT_FREE(writer->games_);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds the result of a finished game to the statistics. A win of player 1 counts 1, a draw 0.5.
+///
+/// @param stats statistics to update
+/// @param final_position final position of the game
+///
+/// @return void
+//
+void gameStatsAdd(GameStats *stats, const Position *final_position)
+{
+  int margin = evaluatePosition(final_position);
+  double win = margin > 0 ? 1.0 : (margin == 0 ? 0.5 : 0.0);
+
+  stats->games_++;
+  stats->win_sum_ += win;
+  stats->margin_sum_ += margin;
+  stats->margin_squares_ += (double) margin * margin;
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    double points = scorePosition(final_position, player_index);
+    stats->points_sum_[player_index] += points;
+    stats->points_squares_[player_index] += points * points;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds the statistics of other games to the statistics.
+///
+/// @param stats statistics to update
+/// @param other statistics to add
+///
+/// @return void
+//
+void gameStatsMerge(GameStats *stats, const GameStats *other)
+{
+  stats->games_ += other->games_;
+  stats->win_sum_ += other->win_sum_;
+  stats->margin_sum_ += other->margin_sum_;
+  stats->margin_squares_ += other->margin_squares_;
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    stats->points_sum_[player_index] += other->points_sum_[player_index];
+    stats->points_squares_[player_index] += other->points_squares_[player_index];
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Calculates the sample standard deviation from a sum and a sum of squares.
+///
+/// @param sum sum of all values
+/// @param squares sum of all squared values
+/// @param count amount of values
+///
+/// @return sample standard deviation (0 for less than two values)
+//
+double gameStatsDeviation(double sum, double squares, long count)
+{
+  if (count < 2)
+  {
+    return 0.0;
+  }
+  double variance = (squares - sum * sum / (double) count) / (double) (count - 1);
+  return variance > 0 ? sqrt(variance) : 0.0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Calculates the width of the 95 % confidence interval of the win rate of player 1 (Agresti-Coull, so a deck that
+/// one player always wins does not stop after the first batch with a width of 0). Draws count as half a win, which
+/// only makes the interval wider than necessary.
+///
+/// @param stats statistics of the played games
+///
+/// @return width of the interval
+//
+double gameStatsWinWidth(const GameStats *stats)
+{
+  double games = (double) stats->games_ + 4;
+  double rate = (stats->win_sum_ + 2) / games;
+  return 2 * CONFIDENCE_Z * sqrt(rate * (1 - rate) / games);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Thread of the deck analysis: plays batches of games until the confidence interval of the win rate is narrow
+/// enough or the maximum amount of games is reached. The games of a batch are reserved before it is played, so the
+/// last batch is cut to the maximum, and every batch draws its random numbers from a generator seeded with its index.
+/// Finished batches wait in a slot until all batches before them are merged, and the stop rule is checked after
+/// every merged batch, so the result only depends on the seed and not on the amount of threads. A thread waits
+/// before it starts a batch that is batch_slots_ batches ahead of the merged ones. Only one thread at a time merges;
+/// it writes the outputs of a merged batch without holding the lock of the job, while the other threads go on.
+///
+/// @param argument AnalysisWorker of the thread
+///
+/// @return NULL
+//
+void *analysisWorker(void *argument)
+{
+  AnalysisWorker *worker = argument;
+  AnalysisJob *job = worker->job_;
+  Position final_position;
+  int record_count;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&job->mutex_);
+    while (!job->stop_ && job->next_game_ < job->max_games_ &&
+           job->next_game_ / ANALYSIS_BATCH >= job->merged_batches_ + job->batch_slots_)
+    {
+      pthread_cond_wait(&job->merged_, &job->mutex_);
+    }
+    long first_game = job->next_game_;
+    long game_count = job->stop_ ? 0 : job->max_games_ - first_game;
+    game_count = game_count < ANALYSIS_BATCH ? game_count : ANALYSIS_BATCH;
+    job->next_game_ += game_count;
+    pthread_mutex_unlock(&job->mutex_);
+    if (game_count <= 0)
+    {
+      break;
+    }
+
+    long batch_index = first_game / ANALYSIS_BATCH;
+    AnalysisBatch *batch = &job->batches_[batch_index % job->batch_slots_];
+    Random random = {job->seed_ + (uint64_t) batch_index * 0xA0761D6478BD642FULL};
+    memset(&batch->stats_, 0, sizeof(GameStats));
+    batch->record_count_ = 0;
+    batch->rank_error_ = 0;
+    for (int game_index = 0; game_index < game_count; ++game_index)
+    {
+      TrajectoryRecord *records = batch->records_ != NULL ? batch->records_ + batch->record_count_ : NULL;
+      playGame(job->start_, job->deck_, job->policies_, job->engine_, &random, &final_position, records,
+               &record_count, job->store_ != NULL ? &batch->games_[game_index] : NULL);
+      if (job->store_ != NULL)
+      {
+        batch->games_[game_index].deal_ = job->deal_;
+      }
+      gameStatsAdd(&batch->stats_, &final_position);
+      if (records == NULL)
+      {
+        continue;
+      }
+      for (int record_index = 0; record_index < record_count; ++record_index)
+      {
+        records[record_index].game_ = (uint32_t) game_index;
+      }
+      if (job->archive_ != NULL && batch->rank_error_ == 0)
+      {
+        batch->rank_error_ = archiveRankGame(job->start_, job->deck_, records, record_count,
+                                             batch->ranks_ + batch->record_count_);
+      }
+      batch->record_count_ += record_count;
+    }
+
+    pthread_mutex_lock(&job->mutex_);
+    batch->done_ = 1;
+    while (!job->merging_)
+    {
+      AnalysisBatch *next = &job->batches_[job->merged_batches_ % job->batch_slots_];
+      if (job->stop_ || !next->done_)
+      {
+        break;
+      }
+      gameStatsMerge(&job->stats_, &next->stats_);
+      if (job->stats_.games_ >= ANALYSIS_MIN_GAMES && gameStatsWinWidth(&job->stats_) < job->width_)
+      {
+        job->stop_ = 1;
+      }
+      job->merging_ = 1;
+      pthread_mutex_unlock(&job->mutex_);
+      analysisEmit(job, next);
+      pthread_mutex_lock(&job->mutex_);
+      job->merging_ = 0;
+      next->done_ = 0;
+      job->merged_batches_++;
+      pthread_cond_broadcast(&job->merged_);
+    }
+    pthread_mutex_unlock(&job->mutex_);
+  }
+  return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes the outputs of a merged batch of the deck analysis in the order of the batches: the decisions of its games
+/// go to the trajectory file as one chunk, its game records to the game store and the ranked moves of every game to
+/// the archive.
+///
+/// @param job running analysis
+/// @param batch merged batch
+///
+/// @return void
+//
+void analysisEmit(AnalysisJob *job, const AnalysisBatch *batch)
+{
+  if (job->writer_ != NULL)
+  {
+    trajectoryAppend(job->writer_, batch->records_, batch->record_count_, (int) batch->stats_.games_);
+  }
+  if (job->store_ != NULL && job->store_->error_ == 0)
+  {
+    job->store_->error_ = storeAppend(job->store_, batch->games_, (int) batch->stats_.games_);
+  }
+  if (job->archive_ != NULL)
+  {
+    ArchiveDeck entry;
+    archiveDeckFrom(&entry, job->start_, job->deck_);
+    int first = 0;
+    for (uint32_t game = 0; game < (uint32_t) batch->stats_.games_; ++game)
+    {
+      int last = first;
+      while (last < batch->record_count_ && batch->records_[last].game_ == game)
+      {
+        ++last;
+      }
+      archiveAppend(job->archive_, &entry, batch->rank_error_ == 0 ? batch->ranks_ + first : NULL, last - first);
+      first = last;
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Estimates the first player advantage and the score variance of a deck by self-play:
+/// "./a3 --analyze <config file> [--policies <policy>,<policy>] [--threads <n>] [--width <w>] [--max-games <n>]
+/// [--seed <n>] [--export <file>] [--record <store file>] [--archive <archive file>]". The games run on several
+/// threads and stop once the 95 % confidence interval of the win rate of player 1 is narrower than the requested width
+/// (default 0.02). Statistics of the same deal, policy pair, seed, width and game limit from the outcome cache are
+/// used instead.
+/// "--export <file>" writes every decision of the games to a trajectory file, "--record <store file>" appends the
+/// outcome of every game to a game store and "--archive <archive file>" appends the moves of every game to an
+/// archive.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage or the error code of loading the config file
+//
+int runAnalyzeTool(int argc, char *argv[], const char *tool_usage)
+{
+  Policy policies[ENGINE_PLAYERS] = {{POLICY_GREEDY, POLICY_DEFAULT_MILLISECONDS, {0}},
+                                     {POLICY_GREEDY, POLICY_DEFAULT_MILLISECONDS, {0}}};
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  AnalysisJob job;
+  TrajectoryWriter writer;
+  StoreWriter store;
+  ArchiveWriter archive;
+  const char *export_name = NULL;
+  const char *store_name = NULL;
+  const char *archive_name = NULL;
+  char *endptr = "";
+
+  memset(&job, 0, sizeof(AnalysisJob));
+  job.seed_ = 1;
+  job.max_games_ = ANALYSIS_DEFAULT_MAX_GAMES;
+  job.width_ = ANALYSIS_DEFAULT_WIDTH;
+
+  int usage = argc < 3;
+  for (int argument = 3; argument < argc && !usage; argument += 2)
+  {
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument], "--policies") == 0)
+    {
+      char names[BUFFER_SIZE];
+      snprintf(names, sizeof(names), "%s", value);
+      char *second = strchr(names, ',');
+      if (second != NULL)
+      {
+        *second++ = '\0';
+      }
+      usage = second == NULL || parsePolicy(names, &policies[0]) != 0 || parsePolicy(second, &policies[1]) != 0;
+    }
+    else if (strcmp(argv[argument], "--threads") == 0)
+    {
+      threads = strtol(value, &endptr, 10);
+      usage = threads <= 0;
+    }
+    else if (strcmp(argv[argument], "--width") == 0)
+    {
+      job.width_ = strtod(value, &endptr);
+      usage = job.width_ <= 0;
+    }
+    else if (strcmp(argv[argument], "--max-games") == 0)
+    {
+      job.max_games_ = strtol(value, &endptr, 10);
+      usage = job.max_games_ <= 0;
+    }
+    else if (strcmp(argv[argument], "--seed") == 0)
+    {
+      job.seed_ = strtoull(value, &endptr, 10);
+    }
+    else if (strcmp(argv[argument], "--export") == 0)
+    {
+      export_name = value;
+    }
+    else if (strcmp(argv[argument], "--record") == 0)
+    {
+      store_name = value;
+    }
+    else if (strcmp(argv[argument], "--archive") == 0)
+    {
+      archive_name = value;
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
+  }
+  if (usage)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+
+  Position start;
+  Deck deck;
+  Engine engine;
+  CacheValue cached;
+  uint64_t key[2];
+  int result = loadDeck(argv[2], &start, &deck);
+  if (result != 0)
+  {
+    return result;
+  }
+  engineOpen(&engine);
+  cacheKey(key, CACHE_ANALYSIS, &start, &deck, policies, &job);
+  if (export_name == NULL && store_name == NULL && archive_name == NULL && cacheLookup(&engine.cache_, key, &cached))
+  {
+    engineClose(&engine);
+    job.stats_ = cached.stats_;
+    printf("games: %ld (outcome cache)\n", job.stats_.games_);
+    printAnalysis(&job.stats_);
+    return 0;
+  }
+  AnalysisWorker *workers = ACCOUNT_MALLOC(sizeof(AnalysisWorker) * (size_t) threads);
+  job.batch_slots_ = 2 * threads;
+  job.batches_ = ACCOUNT_CALLOC((size_t) job.batch_slots_, sizeof(AnalysisBatch));
+  TrajectoryRecord *batch_records = NULL;
+  ArchiveRank *batch_ranks = NULL;
+  int keep_records = export_name != NULL || archive_name != NULL;
+  if (keep_records)
+  {
+    batch_records = ACCOUNT_MALLOC(sizeof(TrajectoryRecord) * ANALYSIS_BATCH * TRAJECTORY_GAME_RECORDS *
+                                   (size_t) job.batch_slots_);
+  }
+  if (archive_name != NULL)
+  {
+    batch_ranks = ACCOUNT_MALLOC(sizeof(ArchiveRank) * ANALYSIS_BATCH * TRAJECTORY_GAME_RECORDS *
+                                 (size_t) job.batch_slots_);
+  }
+  if (workers == NULL || job.batches_ == NULL || (keep_records && batch_records == NULL) ||
+      (archive_name != NULL && batch_ranks == NULL))
+  {
+    printf("Error: Out of memory\n");
+    engineClose(&engine);
+    ACCOUNT_FREE(workers);
+    ACCOUNT_FREE(job.batches_);
+    ACCOUNT_FREE(batch_records);
+    ACCOUNT_FREE(batch_ranks);
+    return OUT_OF_MEMORY;
+  }
+  for (int slot_index = 0; batch_records != NULL && slot_index < job.batch_slots_; ++slot_index)
+  {
+    size_t offset = (size_t) slot_index * ANALYSIS_BATCH * TRAJECTORY_GAME_RECORDS;
+    job.batches_[slot_index].records_ = batch_records + offset;
+    job.batches_[slot_index].ranks_ = batch_ranks != NULL ? batch_ranks + offset : NULL;
+  }
+  if (export_name != NULL)
+  {
+    result = trajectoryOpen(&writer, export_name, &deck);
+    if (result != 0)
+    {
+      engineClose(&engine);
+      ACCOUNT_FREE(workers);
+      ACCOUNT_FREE(job.batches_);
+      ACCOUNT_FREE(batch_records);
+      ACCOUNT_FREE(batch_ranks);
+      return result;
+    }
+    job.writer_ = &writer;
+  }
+  if (store_name != NULL)
+  {
+    result = storeOpen(&store, store_name);
+    if (result != 0)
+    {
+      if (export_name != NULL)
+      {
+        trajectoryClose(&writer);
+      }
+      engineClose(&engine);
+      ACCOUNT_FREE(workers);
+      ACCOUNT_FREE(job.batches_);
+      ACCOUNT_FREE(batch_records);
+      ACCOUNT_FREE(batch_ranks);
+      return result;
+    }
+    job.store_ = &store;
+    job.deal_ = dealHash(&start, &deck);
+  }
+  if (archive_name != NULL)
+  {
+    result = archiveOpen(&archive, archive_name);
+    if (result != 0)
+    {
+      if (export_name != NULL)
+      {
+        trajectoryClose(&writer);
+      }
+      if (store_name != NULL)
+      {
+        storeClose(&store);
+      }
+      engineClose(&engine);
+      ACCOUNT_FREE(workers);
+      ACCOUNT_FREE(job.batches_);
+      ACCOUNT_FREE(batch_records);
+      ACCOUNT_FREE(batch_ranks);
+      return result;
+    }
+    job.archive_ = &archive;
+  }
+  job.start_ = &start;
+  job.deck_ = &deck;
+  job.policies_ = policies;
+  job.engine_ = &engine;
+  pthread_mutex_init(&job.mutex_, NULL);
+  pthread_cond_init(&job.merged_, NULL);
+
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  long started_threads = 0;
+  for (; started_threads < threads; ++started_threads)
+  {
+    workers[started_threads].job_ = &job;
+    if (pthread_create(&workers[started_threads].thread_, NULL, analysisWorker, &workers[started_threads]) != 0)
+    {
+      break;
+    }
+  }
+  if (started_threads == 0)
+  {
+    analysisWorker(&(AnalysisWorker) {&job, 0});
+  }
+  for (long thread_index = 0; thread_index < started_threads; ++thread_index)
+  {
+    pthread_join(workers[thread_index].thread_, NULL);
+  }
+  if (export_name != NULL && trajectoryClose(&writer) != 0)
+  {
+    printf("Error: Cannot write file: %s\n", export_name);
+    result = 2;
+  }
+  if (store_name != NULL)
+  {
+    int store_result = storeClose(&store);
+    if (store_result == ERROR)
+    {
+      printf("Error: Cannot write file: %s\n", store_name);
+      store_result = 2;
+    }
+    result = result != 0 ? result : store_result;
+  }
+  if (archive_name != NULL)
+  {
+    int archive_result = archiveClose(&archive);
+    if (archive_result == ERROR)
+    {
+      printf("Error: Cannot write file: %s\n", archive_name);
+      archive_result = 2;
+    }
+    result = result != 0 ? result : archive_result;
+  }
+  double seconds = secondsSince(&started);
+  pthread_mutex_destroy(&job.mutex_);
+  pthread_cond_destroy(&job.merged_);
+  cached.stats_ = job.stats_;
+  cacheStore(&engine.cache_, key, &cached);
+  engineClose(&engine);
+  ACCOUNT_FREE(workers);
+  ACCOUNT_FREE(job.batches_);
+  ACCOUNT_FREE(batch_records);
+  ACCOUNT_FREE(batch_ranks);
+
+  printf("games: %ld (%ld threads, %.2f s)\n", job.stats_.games_, started_threads > 0 ? started_threads : 1, seconds);
+  printAnalysis(&job.stats_);
+  if (export_name != NULL && result == 0)
+  {
+    printf("%lu decisions of %u games exported\n", writer.records_, writer.games_);
+  }
+  if (store_name != NULL && result == 0)
+  {
+    printf("%ld games of deck %016llx recorded\n", store.written_, (unsigned long long) job.deal_);
+  }
+  if (archive_name != NULL && result == 0)
+  {
+    printf("%ld games archived in %lu bytes (%.2f bytes per game)\n", archive.games_, archive.bytes_,
+           archive.games_ > 0 ? (double) archive.bytes_ / (double) archive.games_ : 0.0);
+  }
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Prints the result of a deck analysis.
+///
+/// @param stats statistics of the played games
+///
+/// @return void
+//
+void printAnalysis(const GameStats *stats)
+{
+  double games = (double) stats->games_;
+  printf("player 1 win rate: %.4f +- %.4f (95 %% confidence)\n", stats->win_sum_ / games,
+         gameStatsWinWidth(stats) / 2);
+  printf("first player advantage: %+.4f\n", stats->win_sum_ / games - 0.5);
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    printf("player %d points: mean %.2f, standard deviation %.2f\n", player_index + 1,
+           stats->points_sum_[player_index] / games,
+           gameStatsDeviation(stats->points_sum_[player_index], stats->points_squares_[player_index],
+                              stats->games_));
+  }
+  printf("score margin: mean %+.2f, standard deviation %.2f\n", stats->margin_sum_ / games,
+         gameStatsDeviation(stats->margin_sum_, stats->margin_squares_, stats->games_));
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads a value of a numeric column (everything but the hands) of a game store block.
+///
+/// @param block block of the mapped game store
+/// @param column StoreColumn below STORE_HAND
+/// @param game index of the game in the block
+///
+/// @return value
+//
+int64_t storeValue(const StoreBlockHeader *block, int column, uint32_t game)
+{
+  const uint8_t *values = (const uint8_t *) block + block->columns_[column].offset_;
+  switch (storeColumnWidth(column))
+  {
+    case sizeof(int64_t):
+      return ((const int64_t *) values)[game];
+    case sizeof(int16_t):
+      return ((const int16_t *) values)[game];
+    default:
+      return ((const int8_t *) values)[game];
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Checks the header of a game store block and that all of its columns lie inside of the block.
+///
+/// @param block block of the mapped game store
+/// @param size bytes left in the file from the start of the block
+///
+/// @return 1 if the block is valid, 0 otherwise
+//
+int storeBlockValid(const StoreBlockHeader *block, size_t size)
+{
+  if (size < sizeof(StoreBlockHeader) || memcmp(block->magic_, "A3GS", 4) != 0 || block->version_ != STORE_VERSION ||
+      block->column_count_ != STORE_COLUMN_COUNT || block->game_count_ == 0 ||
+      block->block_size_ < sizeof(StoreBlockHeader) || block->block_size_ > size ||
+      block->block_size_ % STORE_ALIGNMENT != 0)
+  {
+    return 0;
+  }
+  for (int column = 0; column < STORE_COLUMN_COUNT; ++column)
+  {
+    uint64_t offset = block->columns_[column].offset_;
+    uint64_t length = (uint64_t) block->game_count_ * (uint64_t) storeColumnWidth(column);
+    if (offset < sizeof(StoreBlockHeader) || offset % STORE_ALIGNMENT != 0 || offset > block->block_size_ ||
+        length > block->block_size_ - offset)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Finds the totals of a deal in a hash table of groups and adds them if they are missing. The table grows when it
+/// is half full.
+///
+/// @param groups open addressing hash table of totals by deal
+/// @param deal hash of the deal
+///
+/// @return totals of the deal or NULL if out of memory
+//
+QueryTotals *queryGroupsFind(QueryGroups *groups, int64_t deal)
+{
+  if (2 * (groups->count_ + 1) > groups->capacity_)
+  {
+    size_t capacity = groups->capacity_ == 0 ? 64 : 2 * groups->capacity_;
+    QueryTotals *table = ACCOUNT_CALLOC(capacity, sizeof(QueryTotals));
+    if (table == NULL)
+    {
+      return NULL;
+    }
+    for (size_t index = 0; index < groups->capacity_; ++index)
+    {
+      if (groups->groups_[index].games_ != 0)
+      {
+        size_t slot = (size_t) groups->groups_[index].deal_ & (capacity - 1);
+        while (table[slot].games_ != 0)
+        {
+          slot = (slot + 1) & (capacity - 1);
+        }
+        table[slot] = groups->groups_[index];
+      }
+    }
+    ACCOUNT_FREE(groups->groups_);
+    groups->groups_ = table;
+    groups->capacity_ = capacity;
+  }
+  size_t slot = (size_t) deal & (groups->capacity_ - 1);
+  while (groups->groups_[slot].games_ != 0 && groups->groups_[slot].deal_ != deal)
+  {
+    slot = (slot + 1) & (groups->capacity_ - 1);
+  }
+  return &groups->groups_[slot];
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds totals to other totals.
+///
+/// @param totals totals to add to
+/// @param other totals to add
+///
+/// @return void
+//
+void queryTotalsMerge(QueryTotals *totals, const QueryTotals *other)
+{
+  totals->games_ += other->games_;
+  totals->win_sum_ += other->win_sum_;
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    for (int color = 0; color < ENGINE_COLORS; ++color)
+    {
+      totals->sum_[player_index][color] += other->sum_[player_index][color];
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds the games of a block that match the filters of a query to the totals of a worker. A block is skipped
+/// without reading its columns if its header shows that none of its games can match. Only the columns needed by the
+/// filters and the measure are read.
+///
+/// @param job query
+/// @param block block of the mapped game store
+/// @param worker worker to add the totals to
+///
+/// @return 1 if the block was scanned, 0 if it was skipped, OUT_OF_MEMORY
+//
+int queryBlock(const QueryJob *job, const StoreBlockHeader *block, QueryWorker *worker)
+{
+  const uint8_t *base = (const uint8_t *) block;
+  const StoreColumnInfo *deal_info = &block->columns_[STORE_DEAL];
+
+  if (job->hold_card_ != 0 && !cardSetContains(&block->held_[job->hold_player_], job->hold_card_))
+  {
+    return 0;
+  }
+  if (job->deal_ >= 0 && (job->deal_ < deal_info->min_ || job->deal_ > deal_info->max_))
+  {
+    return 0;
+  }
+  const int64_t *deals = (const int64_t *) (base + deal_info->offset_);
+  const CardSet *hands = (const CardSet *) (base + block->columns_[STORE_HAND + job->hold_player_].offset_);
+  const CardSet *hand_colors =
+    (const CardSet *) (base + block->columns_[STORE_HAND_COLORS + job->hold_player_].offset_);
+  int filter_deal = job->deal_ >= 0 && deal_info->min_ != deal_info->max_;
+
+  for (uint32_t game = 0; game < block->game_count_; ++game)
+  {
+    if ((filter_deal && deals[game] != job->deal_) ||
+        (job->hold_card_ != 0 && !cardSetContains(&hands[game], job->hold_card_)))
+    {
+      continue;
+    }
+    if (job->hold_color_ >= 0)
+    {
+      int color = cardSetContains(&hand_colors[2 * game], job->hold_card_) |
+                  cardSetContains(&hand_colors[2 * game + 1], job->hold_card_) << 1;
+      if (color != job->hold_color_)
+      {
+        continue;
+      }
+    }
+    QueryTotals *totals = &worker->totals_;
+    if (job->by_deal_)
+    {
+      totals = queryGroupsFind(&worker->groups_, deals[game]);
+      if (totals == NULL)
+      {
+        return OUT_OF_MEMORY;
+      }
+      totals->deal_ = deals[game];
+    }
+    totals->games_++;
+    switch (job->measure_)
+    {
+      case QUERY_WINRATE:
+      {
+        int64_t winner = storeValue(block, STORE_WINNER, game);
+        totals->win_sum_ += winner == 0 ? 1.0 : (winner == ENGINE_PLAYERS ? 0.5 : 0.0);
+        break;
+      }
+      case QUERY_POINTS:
+        for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+        {
+          totals->sum_[player_index][0] += (double) storeValue(block, STORE_POINTS + player_index, game);
+        }
+        break;
+      case QUERY_LONGEST:
+        for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+        {
+          int64_t longest = 0;
+          for (int row_index = 0; row_index < ENGINE_ROWS; ++row_index)
+          {
+            int64_t length = storeValue(block, STORE_ROW_LENGTH + player_index * ENGINE_ROWS + row_index, game);
+            longest = length > longest ? length : longest;
+          }
+          totals->sum_[player_index][0] += (double) longest;
+        }
+        break;
+      case QUERY_COLORS:
+        for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+        {
+          for (int color = 0; color < ENGINE_COLORS; ++color)
+          {
+            totals->sum_[player_index][color] +=
+              (double) storeValue(block, STORE_COLOR_COUNT + player_index * ENGINE_COLORS + color, game);
+          }
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Thread of a query: takes blocks of the game store one after another until all of them are taken.
+///
+/// @param argument QueryWorker of the thread
+///
+/// @return NULL
+//
+void *queryWorker(void *argument)
+{
+  QueryWorker *worker = argument;
+  QueryJob *job = worker->job_;
+  int scanned_blocks = 0;
+  int error = 0;
+
+  for (;;)
+  {
+    pthread_mutex_lock(&job->mutex_);
+    int block_index = job->error_ == 0 && job->next_block_ < job->block_count_ ? job->next_block_++ : -1;
+    pthread_mutex_unlock(&job->mutex_);
+    if (block_index < 0)
+    {
+      break;
+    }
+    int result = queryBlock(job, job->blocks_[block_index], worker);
+    if (result == OUT_OF_MEMORY)
+    {
+      error = result;
+      break;
+    }
+    scanned_blocks += result;
+  }
+
+  pthread_mutex_lock(&job->mutex_);
+  job->scanned_blocks_ += scanned_blocks;
+  job->error_ = job->error_ != 0 ? job->error_ : error;
+  pthread_mutex_unlock(&job->mutex_);
+  return NULL;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Orders totals by the hash of their deal for qsort.
+///
+/// @param first first QueryTotals
+/// @param second second QueryTotals
+///
+/// @return negative, zero or positive like strcmp
+//
+int compareQueryTotals(const void *first, const void *second)
+{
+  int64_t first_deal = ((const QueryTotals *) first)->deal_;
+  int64_t second_deal = ((const QueryTotals *) second)->deal_;
+  return (first_deal > second_deal) - (first_deal < second_deal);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Prints the measure of a query for a group of games on the current line.
+///
+/// @param totals totals of the games
+/// @param measure measure of the query
+///
+/// @return void
+//
+void printQueryTotals(const QueryTotals *totals, QueryMeasure measure)
+{
+  double games = totals->games_ > 0 ? (double) totals->games_ : 1.0;
+
+  printf("%ld games", totals->games_);
+  if (measure == QUERY_WINRATE)
+  {
+    printf(", player 1 win rate %.4f", totals->win_sum_ / games);
+  }
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    if (measure == QUERY_POINTS || measure == QUERY_LONGEST)
+    {
+      printf(", player %d %s %.2f", player_index + 1, measure == QUERY_POINTS ? "points" : "longest row",
+             totals->sum_[player_index][0] / games);
+    }
+    else if (measure == QUERY_COLORS)
+    {
+      printf(", player %d", player_index + 1);
+      for (int color = 0; color < ENGINE_COLORS; ++color)
+      {
+        printf(" %c %.2f", CARD_COLORS[color], totals->sum_[player_index][color] / games);
+      }
+    }
+  }
+  printf("\n");
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Aggregates the games of a game store written by "--analyze --record":
+/// "./a3 --query <store file> games|winrate|points|longest|colors [--hold <player>:<card>[_<color>]]
+/// [--deck <hash>] [--by deck] [--threads <n>]". "--hold" only counts games where the player was dealt the card
+/// (of the color), "--deck" only the games of one deal and "--by deck" prints one line per deal. The blocks of the
+/// store are scanned on several threads.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage, 2 if the file cannot be opened, 3 if it is invalid or OUT_OF_MEMORY
+//
+int runQueryTool(int argc, char *argv[], const char *tool_usage)
+{
+  QueryJob job;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  char *endptr = "";
+
+  memset(&job, 0, sizeof(QueryJob));
+  job.hold_color_ = ERROR;
+  job.deal_ = ERROR;
+
+  int usage = argc < 4;
+  for (int measure = 0; measure <= QUERY_COLORS && !usage; ++measure)
+  {
+    if (strcmp(argv[3], QUERY_MEASURES[measure]) == 0)
+    {
+      job.measure_ = (QueryMeasure) measure;
+      break;
+    }
+    usage = measure == QUERY_COLORS;
+  }
+  for (int argument = 4; argument < argc && !usage; argument += 2)
+  {
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument], "--hold") == 0)
+    {
+      job.hold_player_ = (int) strtol(value, &endptr, 10) - 1;
+      usage = job.hold_player_ < 0 || job.hold_player_ >= ENGINE_PLAYERS || *endptr != ':';
+      if (!usage)
+      {
+        job.hold_card_ = (int) strtol(endptr + 1, &endptr, 10);
+        usage = job.hold_card_ < 1 || job.hold_card_ > MAX_CARD_NUMBER;
+      }
+      if (!usage && *endptr == '_')
+      {
+        const char *color = strchr(CARD_COLORS, endptr[1]);
+        usage = color == NULL || endptr[1] == '\0' || endptr[2] != '\0';
+        job.hold_color_ = usage ? ERROR : (int) (color - CARD_COLORS);
+        endptr = "";
+      }
+    }
+    else if (strcmp(argv[argument], "--deck") == 0)
+    {
+      job.deal_ = (int64_t) strtoull(value, &endptr, 16);
+      usage = job.deal_ < 0;
+    }
+    else if (strcmp(argv[argument], "--by") == 0)
+    {
+      job.by_deal_ = 1;
+      usage = strcmp(value, "deck") != 0;
+    }
+    else if (strcmp(argv[argument], "--threads") == 0)
+    {
+      threads = strtol(value, &endptr, 10);
+      usage = threads <= 0;
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
+  }
+  if (usage)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+
+  MappedFile file;
+  if (mapFile(&file, argv[2]) != 0)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    return 2;
+  }
+  const uint8_t *data = file.data_;
+  size_t block_capacity = 0;
+  for (size_t offset = 0; offset < file.size_;)
+  {
+    const StoreBlockHeader *block = (const StoreBlockHeader *) (data + offset);
+    if (offset % STORE_ALIGNMENT != 0 || !storeBlockValid(block, file.size_ - offset))
+    {
+      printf("Error: Invalid file: %s\n", argv[2]);
+      unmapFile(&file);
+      return 3;
+    }
+    offset += block->block_size_;
+    ++block_capacity;
+  }
+  threads = threads < QUERY_MAX_THREADS ? threads : QUERY_MAX_THREADS;
+  job.blocks_ = ACCOUNT_MALLOC(block_capacity * sizeof(StoreBlockHeader *));
+  QueryWorker *workers = ACCOUNT_CALLOC((size_t) threads, sizeof(QueryWorker));
+  if (job.blocks_ == NULL || workers == NULL)
+  {
+    printf("Error: Out of memory\n");
+    ACCOUNT_FREE(job.blocks_);
+    ACCOUNT_FREE(workers);
+    unmapFile(&file);
+    return OUT_OF_MEMORY;
+  }
+  for (size_t offset = 0; offset < file.size_; offset += job.blocks_[job.block_count_++]->block_size_)
+  {
+    job.blocks_[job.block_count_] = (const StoreBlockHeader *) (data + offset);
+  }
+  pthread_mutex_init(&job.mutex_, NULL);
+
+  long started_threads = 0;
+  for (; started_threads < threads; ++started_threads)
+  {
+    workers[started_threads].job_ = &job;
+    if (pthread_create(&workers[started_threads].thread_, NULL, queryWorker, &workers[started_threads]) != 0)
+    {
+      break;
+    }
+  }
+  for (long thread_index = 0; thread_index < started_threads; ++thread_index)
+  {
+    pthread_join(workers[thread_index].thread_, NULL);
+  }
+  if (started_threads == 0)
+  {
+    workers[started_threads++].job_ = &job;
+    queryWorker(&workers[0]);
+  }
+  pthread_mutex_destroy(&job.mutex_);
+
+  QueryWorker *merged = &workers[0];
+  int result = job.error_;
+  for (long thread_index = 1; thread_index < started_threads && result == 0; ++thread_index)
+  {
+    queryTotalsMerge(&merged->totals_, &workers[thread_index].totals_);
+    const QueryGroups *groups = &workers[thread_index].groups_;
+    for (size_t index = 0; index < groups->capacity_ && result == 0; ++index)
+    {
+      if (groups->groups_[index].games_ != 0)
+      {
+        QueryTotals *totals = queryGroupsFind(&merged->groups_, groups->groups_[index].deal_);
+        result = totals == NULL ? OUT_OF_MEMORY : 0;
+        if (totals != NULL)
+        {
+          totals->deal_ = groups->groups_[index].deal_;
+          queryTotalsMerge(totals, &groups->groups_[index]);
+        }
+      }
+    }
+  }
+  if (result == 0)
+  {
+    size_t count = 0;
+    for (size_t index = 0; index < merged->groups_.capacity_; ++index)
+    {
+      if (merged->groups_.groups_[index].games_ != 0)
+      {
+        merged->groups_.groups_[count++] = merged->groups_.groups_[index];
+        queryTotalsMerge(&merged->totals_, &merged->groups_.groups_[index]);
+      }
+    }
+    if (count != 0)
+    {
+      qsort(merged->groups_.groups_, count, sizeof(QueryTotals), compareQueryTotals);
+    }
+    printf("%d of %d blocks scanned\n", job.scanned_blocks_, job.block_count_);
+    for (size_t index = 0; index < count; ++index)
+    {
+      printf("deck %016llx: ", (unsigned long long) merged->groups_.groups_[index].deal_);
+      printQueryTotals(&merged->groups_.groups_[index], job.measure_);
+    }
+    printf("all decks: ");
+    printQueryTotals(&merged->totals_, job.measure_);
+  }
+  else
+  {
+    printf("Error: Out of memory\n");
+  }
+
+  for (long thread_index = 0; thread_index < threads; ++thread_index)
+  {
+    ACCOUNT_FREE(workers[thread_index].groups_.groups_);
+  }
+  ACCOUNT_FREE(workers);
+  ACCOUNT_FREE(job.blocks_);
+  unmapFile(&file);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Resets the adaptive frequencies of a symbol alphabet: every symbol starts with frequency 1.
+///
+/// @param frequencies frequencies to reset
+/// @param count amount of symbols
+///
+/// @return void
+//
+void archiveFrequenciesInit(ArchiveFrequencies *frequencies, int count)
+{
+  memset(frequencies, 0, sizeof(ArchiveFrequencies));
+  for (int symbol = 0; symbol < count; ++symbol)
+  {
+    frequencies->frequency_[symbol] = 1;
+  }
+  frequencies->total_ = (uint32_t) count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Counts a coded symbol. All frequencies are halved once their total exceeds ARCHIVE_MAX_TOTAL, so recent symbols
+/// weigh more and the range coder keeps enough precision.
+///
+/// @param frequencies frequencies of the alphabet
+/// @param symbol coded symbol
+/// @param count amount of symbols
+///
+/// @return void
+//
+void archiveFrequenciesUpdate(ArchiveFrequencies *frequencies, int symbol, int count)
+{
+  frequencies->frequency_[symbol] = (uint16_t) (frequencies->frequency_[symbol] + ARCHIVE_INCREMENT);
+  frequencies->total_ += ARCHIVE_INCREMENT;
+  if (frequencies->total_ > ARCHIVE_MAX_TOTAL)
+  {
+    frequencies->total_ = 0;
+    for (int index = 0; index < count; ++index)
+    {
+      frequencies->frequency_[index] = (uint16_t) ((frequencies->frequency_[index] + 1) / 2);
+      frequencies->total_ += frequencies->frequency_[index];
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Resets the model of an archive block: one alphabet for the deck of a game and one alphabet of move ranks for every
+/// amount of legal moves.
+///
+/// @param model model to reset
+///
+/// @return void
+//
+void archiveModelInit(ArchiveModel *model)
+{
+  archiveFrequenciesInit(&model->decks_, ARCHIVE_MAX_DECKS);
+  for (int count = 0; count <= SEARCH_MAX_MOVES; ++count)
+  {
+    archiveFrequenciesInit(&model->moves_[count], count);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Starts a range coded stream. The output buffer is kept for the next stream.
+///
+/// @param encoder encoder to start
+///
+/// @return void
+//
+void rangeEncoderInit(RangeEncoder *encoder)
+{
+  encoder->length_ = 0;
+  encoder->low_ = 0;
+  encoder->cache_size_ = 1;
+  encoder->range_ = UINT32_MAX;
+  encoder->cache_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Moves the top byte of the low end of the range to the output. Bytes that a later carry could still change are
+/// held back (cache) until the carry is known.
+///
+/// @param encoder encoder of the stream
+///
+/// @return void
+//
+void rangeShiftLow(RangeEncoder *encoder)
+{
+  if ((uint32_t) encoder->low_ < 0xFF000000u || (encoder->low_ >> 32) != 0)
+  {
+    uint8_t carry = (uint8_t) (encoder->low_ >> 32);
+    uint8_t byte = encoder->cache_;
+    do
+    {
+      if (encoder->length_ == encoder->capacity_)
+      {
+        size_t capacity = encoder->capacity_ == 0 ? 65536 : 2 * encoder->capacity_;
+        uint8_t *data = ACCOUNT_REALLOC(encoder->data_, capacity);
+        if (data == NULL)
+        {
+          encoder->error_ = OUT_OF_MEMORY;
+          encoder->length_ = 0;
+        }
+        else
+        {
+          encoder->data_ = data;
+          encoder->capacity_ = capacity;
+        }
+      }
+      if (encoder->length_ < encoder->capacity_)
+      {
+        encoder->data_[encoder->length_++] = (uint8_t) (byte + carry);
+      }
+      byte = 0xFF;
+    } while (--encoder->cache_size_ != 0);
+    encoder->cache_ = (uint8_t) (encoder->low_ >> 24);
+  }
+  encoder->cache_size_++;
+  encoder->low_ = (encoder->low_ & 0x00FFFFFF) << 8;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Codes a symbol with its adaptive frequency and counts it.
+///
+/// @param encoder encoder of the stream
+/// @param frequencies frequencies of the alphabet
+/// @param count amount of symbols
+/// @param symbol symbol to code (below count)
+///
+/// @return void
+//
+void rangeEncodeSymbol(RangeEncoder *encoder, ArchiveFrequencies *frequencies, int count, int symbol)
+{
+  uint32_t cumulative = 0;
+  for (int index = 0; index < symbol; ++index)
+  {
+    cumulative += frequencies->frequency_[index];
+  }
+  encoder->range_ /= frequencies->total_;
+  encoder->low_ += (uint64_t) cumulative * encoder->range_;
+  encoder->range_ *= frequencies->frequency_[symbol];
+  while (encoder->range_ < ARCHIVE_RANGE_TOP)
+  {
+    encoder->range_ <<= 8;
+    rangeShiftLow(encoder);
+  }
+  archiveFrequenciesUpdate(frequencies, symbol, count);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Ends a range coded stream: writes out the rest of the low end of the range.
+///
+/// @param encoder encoder of the stream
+///
+/// @return void
+//
+void rangeEncoderFinish(RangeEncoder *encoder)
+{
+  for (int byte = 0; byte < 5; ++byte)
+  {
+    rangeShiftLow(encoder);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Starts decoding a range coded stream.
+///
+/// @param decoder decoder to start
+/// @param data coded stream
+/// @param size length of the stream in bytes
+///
+/// @return void
+//
+void rangeDecoderInit(RangeDecoder *decoder, const uint8_t *data, size_t size)
+{
+  decoder->data_ = data;
+  decoder->size_ = size;
+  decoder->position_ = 0;
+  decoder->code_ = 0;
+  decoder->range_ = UINT32_MAX;
+  decoder->error_ = 0;
+  for (int byte = 0; byte < 5; ++byte)
+  {
+    decoder->code_ = (decoder->code_ << 8) | rangeNextByte(decoder);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the next byte of a coded stream. Reading past its end marks the stream as corrupt.
+///
+/// @param decoder decoder of the stream
+///
+/// @return next byte (0 past the end)
+//
+uint8_t rangeNextByte(RangeDecoder *decoder)
+{
+  if (decoder->position_ < decoder->size_)
+  {
+    return decoder->data_[decoder->position_++];
+  }
+  decoder->error_ = 1;
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Decodes a symbol coded by rangeEncodeSymbol and counts it.
+///
+/// @param decoder decoder of the stream
+/// @param frequencies frequencies of the alphabet (same state as when the symbol was coded)
+/// @param count amount of symbols
+///
+/// @return symbol or ERROR if the stream is corrupt
+//
+int rangeDecodeSymbol(RangeDecoder *decoder, ArchiveFrequencies *frequencies, int count)
+{
+  decoder->range_ /= frequencies->total_;
+  uint32_t value = decoder->code_ / decoder->range_;
+  if (value >= frequencies->total_)
+  {
+    decoder->error_ = 1;
+    return ERROR;
+  }
+  uint32_t cumulative = 0;
+  int symbol = 0;
+  while (cumulative + frequencies->frequency_[symbol] <= value)
+  {
+    cumulative += frequencies->frequency_[symbol++];
+  }
+  decoder->code_ -= cumulative * decoder->range_;
+  decoder->range_ *= frequencies->frequency_[symbol];
+  while (decoder->range_ < ARCHIVE_RANGE_TOP)
+  {
+    decoder->code_ = (decoder->code_ << 8) | rangeNextByte(decoder);
+    decoder->range_ <<= 8;
+  }
+  archiveFrequenciesUpdate(frequencies, symbol, count);
+  return symbol;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Generates the legal moves of a position ordered by how likely a player makes them: best rating after the move
+/// first (heuristicScore, like greedyMove), equal moves in the order of generateMoves. Archived moves are coded as
+/// their rank in this order, so the moves of good players mostly become rank 0.
+///
+/// @param position position to move in (not over)
+/// @param deck deck lookup table with the points of every card
+/// @param moves receives the ordered moves (at least SEARCH_MAX_MOVES)
+///
+/// @return amount of moves
+//
+int archiveRankMoves(const Position *position, const Deck *deck, Move *moves)
+{
+  int scores[SEARCH_MAX_MOVES];
+  int count = generateMoves(position, moves);
+
+  for (int move_index = 0; move_index < count; ++move_index)
+  {
+    Position child = *position;
+    applyMove(&child, deck, moves[move_index]);
+    int score = heuristicScore(&child, deck, position->turn_);
+    Move move = moves[move_index];
+    int insert = move_index;
+    for (; insert > 0 && scores[insert - 1] < score; --insert)
+    {
+      scores[insert] = scores[insert - 1];
+      moves[insert] = moves[insert - 1];
+    }
+    scores[insert] = score;
+    moves[insert] = move;
+  }
+  return count;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Describes a deal for the deck dictionary of an archive: the dealt hands and the color of every dealt card.
+///
+/// @param entry receives the description
+/// @param start start position of the deal
+/// @param deck deck lookup table with the color of every card
+///
+/// @return void
+//
+void archiveDeckFrom(ArchiveDeck *entry, const Position *start, const Deck *deck)
+{
+  memset(entry, 0, sizeof(ArchiveDeck));
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    const CardSet *hand = &start->hand_cards_[player_index];
+    entry->hand_cards_[player_index] = *hand;
+    for (int card = cardSetNext(hand, 0); card != 0; card = cardSetNext(hand, card))
+    {
+      int color = colorIndex(deck->color_[card]);
+      if (color & 1)
+      {
+        cardSetAdd(&entry->hand_colors_[player_index][0], card);
+      }
+      if (color & 2)
+      {
+        cardSetAdd(&entry->hand_colors_[player_index][1], card);
+      }
+    }
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Rebuilds the start position and the deck of a deal from the deck dictionary of an archive, like loadDeck.
+///
+/// @param entry description of the deal
+/// @param start receives the start position
+/// @param deck receives the deck lookup table
+///
+/// @return void
+//
+void archiveDeckStart(const ArchiveDeck *entry, Position *start, Deck *deck)
+{
+  memset(start, 0, sizeof(Position));
+  memset(deck, 0, sizeof(Deck));
+  for (int player_index = 0; player_index < ENGINE_PLAYERS; ++player_index)
+  {
+    const CardSet *hand = &entry->hand_cards_[player_index];
+    start->hand_cards_[player_index] = *hand;
+    for (int card = cardSetNext(hand, 0); card != 0; card = cardSetNext(hand, card))
+    {
+      int color = cardSetContains(&entry->hand_colors_[player_index][0], card) |
+                  cardSetContains(&entry->hand_colors_[player_index][1], card) << 1;
+      deck->color_[card] = CARD_COLORS[color];
+    }
+  }
+  for (int number = 0; number < CARD_NUMBER_LIMIT; ++number)
+  {
+    deck->points_[number] = (uint8_t) colorPoints(deck->color_[number]);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens an archive for appending games.
+///
+/// @param archive receives the writer
+/// @param file_name name of the archive file
+///
+/// @return success(0) or 2 if the file cannot be opened
+//
+int archiveOpen(ArchiveWriter *archive, const char *file_name)
+{
+  memset(archive, 0, sizeof(ArchiveWriter));
+  archive->file_ = fopen(file_name, "ab");
+  if (archive->file_ == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    return 2;
+  }
+  rangeEncoderInit(&archive->encoder_);
+  archiveModelInit(&archive->model_);
+  pthread_mutex_init(&archive->mutex_, NULL);
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes the collected games as one block: a header, the deck dictionary and the range coded games. Every block
+/// starts with a fresh model, so it can be decoded on its own.
+///
+/// @param archive opened writer
+///
+/// @return success(0), ERROR if the block cannot be written or OUT_OF_MEMORY
+//
+int archiveFlush(ArchiveWriter *archive)
+{
+  ArchiveBlockHeader header;
+
+  if (archive->game_count_ == 0)
+  {
+    return 0;
+  }
+  rangeEncoderFinish(&archive->encoder_);
+  if (archive->encoder_.error_ != 0)
+  {
+    return archive->encoder_.error_;
+  }
+  memset(&header, 0, sizeof(ArchiveBlockHeader));
+  memcpy(header.magic_, "A3AR", 4);
+  header.version_ = ARCHIVE_VERSION;
+  header.game_count_ = archive->game_count_;
+  header.deck_count_ = (uint32_t) archive->deck_count_;
+  header.payload_size_ = (uint32_t) archive->encoder_.length_;
+  header.ranking_version_ = ARCHIVE_RANKING_VERSION;
+  int written = fwrite(&header, sizeof(ArchiveBlockHeader), 1, archive->file_) == 1 &&
+                fwrite(archive->decks_, sizeof(ArchiveDeck), (size_t) archive->deck_count_, archive->file_) ==
+                  (size_t) archive->deck_count_ &&
+                fwrite(archive->encoder_.data_, 1, archive->encoder_.length_, archive->file_) ==
+                  archive->encoder_.length_;
+  archive->bytes_ += sizeof(ArchiveBlockHeader) + sizeof(ArchiveDeck) * (size_t) archive->deck_count_ +
+                     archive->encoder_.length_;
+  archive->games_ += archive->game_count_;
+  archive->game_count_ = 0;
+  archive->deck_count_ = 0;
+  rangeEncoderInit(&archive->encoder_);
+  archiveModelInit(&archive->model_);
+  return written ? 0 : ERROR;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Ranks every move of a finished game for the archive: the rank (archiveRankMoves) of the move and the amount of
+/// legal moves it was chosen from. Needs no writer, so the games can be ranked on several threads.
+///
+/// @param start start position of the game
+/// @param deck deck lookup table of the game
+/// @param records trajectory records of every decision of the game
+/// @param count amount of records
+/// @param ranks receives a rank for every record
+///
+/// @return success(0) or ERROR if a move is not legal or the game is not over
+//
+int archiveRankGame(const Position *start, const Deck *deck, const TrajectoryRecord *records, int count,
+                    ArchiveRank *ranks)
+{
+  Move moves[SEARCH_MAX_MOVES];
+  Position position = *start;
+
+  for (int record = 0; record < count; ++record)
+  {
+    Move move = records[record].move_;
+    int move_count = archiveRankMoves(&position, deck, moves);
+    int rank = 0;
+    while (rank < move_count && memcmp(&moves[rank], &move, sizeof(Move)) != 0)
+    {
+      ++rank;
+    }
+    if (rank == move_count)
+    {
+      return ERROR;
+    }
+    ranks[record].rank_ = (uint8_t) rank;
+    ranks[record].move_count_ = (uint8_t) move_count;
+    applyMove(&position, deck, move);
+  }
+  return position.phase_ == PHASE_OVER ? 0 : ERROR;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds a finished game to an archive: the index of its deal in the deck dictionary of the block, followed by the
+/// ranks of its moves (archiveRankGame), both range coded with adaptive frequencies. Moves without an alternative
+/// take no space. Can be called from several threads; only the coding is done under the lock of the archive.
+///
+/// @param archive opened writer
+/// @param entry deal of the game (archiveDeckFrom)
+/// @param ranks ranked moves of the game or NULL if the game could not be ranked
+/// @param count amount of ranked moves
+///
+/// @return void
+//
+void archiveAppend(ArchiveWriter *archive, const ArchiveDeck *entry, const ArchiveRank *ranks, int count)
+{
+  pthread_mutex_lock(&archive->mutex_);
+  if (ranks == NULL && archive->error_ == 0)
+  {
+    archive->error_ = ERROR;
+  }
+  if (archive->error_ != 0)
+  {
+    pthread_mutex_unlock(&archive->mutex_);
+    return;
+  }
+  int deck_index = 0;
+  while (deck_index < archive->deck_count_ && memcmp(&archive->decks_[deck_index], entry, sizeof(ArchiveDeck)) != 0)
+  {
+    ++deck_index;
+  }
+  if (deck_index == ARCHIVE_MAX_DECKS)
+  {
+    archive->error_ = archiveFlush(archive);
+    deck_index = 0;
+  }
+  if (deck_index == archive->deck_count_)
+  {
+    archive->decks_[archive->deck_count_++] = *entry;
+  }
+  rangeEncodeSymbol(&archive->encoder_, &archive->model_.decks_, ARCHIVE_MAX_DECKS, deck_index);
+  for (int record = 0; record < count; ++record)
+  {
+    if (ranks[record].move_count_ > 1)
+    {
+      rangeEncodeSymbol(&archive->encoder_, &archive->model_.moves_[ranks[record].move_count_],
+                        ranks[record].move_count_, ranks[record].rank_);
+    }
+  }
+  if (archive->error_ == 0 && ++archive->game_count_ == ARCHIVE_BLOCK_GAMES)
+  {
+    archive->error_ = archiveFlush(archive);
+  }
+  pthread_mutex_unlock(&archive->mutex_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes the last block and closes an archive.
+///
+/// @param archive opened writer
+///
+/// @return success(0), ERROR if a block cannot be written or a game cannot be archived, OUT_OF_MEMORY
+//
+int archiveClose(ArchiveWriter *archive)
+{
+  int result = archive->error_ != 0 ? archive->error_ : archiveFlush(archive);
+  if (fclose(archive->file_) != 0 && result == 0)
+  {
+    result = ERROR;
+  }
+  pthread_mutex_destroy(&archive->mutex_);
+  ACCOUNT_FREE(archive->encoder_.data_);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Replays the games of an archive written by "--analyze --archive": "./a3 --replay <archive file> [--game <n>]".
+/// The archive is read block by block and every game is decoded move by move straight into the position of the
+/// engine, so only one block is in memory at a time. Prints the statistics of all games like "--analyze" or, with
+/// "--game <n>", the moves of the n-th game.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage, 2 if the file cannot be opened, 3 if it is invalid or OUT_OF_MEMORY
+//
+int runReplayTool(int argc, char *argv[], const char *tool_usage)
+{
+  long show_game = 0;
+  char *endptr = "";
+
+  if (argc == 5 && strcmp(argv[3], "--game") == 0)
+  {
+    show_game = strtol(argv[4], &endptr, 10);
+  }
+  if ((argc != 3 && argc != 5) || (argc == 5 && (show_game <= 0 || *endptr != '\0')))
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  FILE *file = fopen(argv[2], "rb");
+  if (file == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", argv[2]);
+    return 2;
+  }
+
+  ArchiveBlockHeader header;
+  ArchiveDeck decks[ARCHIVE_MAX_DECKS];
+  ArchiveModel model;
+  RangeDecoder decoder;
+  GameStats stats;
+  Move moves[SEARCH_MAX_MOVES];
+  uint8_t *payload = NULL;
+  size_t payload_capacity = 0;
+  long blocks = 0;
+  unsigned long bytes = 0;
+  int result = 0;
+
+  memset(&stats, 0, sizeof(GameStats));
+  while (result == 0 && (show_game == 0 || stats.games_ < show_game))
+  {
+    size_t header_read = fread(&header, 1, sizeof(ArchiveBlockHeader), file);
+    if (header_read == 0 && feof(file))
+    {
+      break;
+    }
+    if (header_read != sizeof(ArchiveBlockHeader) || memcmp(header.magic_, "A3AR", 4) != 0 ||
+        header.version_ != ARCHIVE_VERSION || header.ranking_version_ != ARCHIVE_RANKING_VERSION ||
+        header.game_count_ == 0 || header.game_count_ > ARCHIVE_BLOCK_GAMES || header.deck_count_ == 0 ||
+        header.deck_count_ > ARCHIVE_MAX_DECKS ||
+        fread(decks, sizeof(ArchiveDeck), header.deck_count_, file) != header.deck_count_)
+    {
+      result = 3;
+      break;
+    }
+    if (header.payload_size_ > payload_capacity)
+    {
+      uint8_t *data = ACCOUNT_REALLOC(payload, header.payload_size_);
+      if (data == NULL)
+      {
+        result = OUT_OF_MEMORY;
+        break;
+      }
+      payload = data;
+      payload_capacity = header.payload_size_;
+    }
+    if (fread(payload, 1, header.payload_size_, file) != header.payload_size_)
+    {
+      result = 3;
+      break;
+    }
+    blocks++;
+    bytes += sizeof(ArchiveBlockHeader) + sizeof(ArchiveDeck) * header.deck_count_ + header.payload_size_;
+
+    rangeDecoderInit(&decoder, payload, header.payload_size_);
+    archiveModelInit(&model);
+    for (uint32_t game = 0; game < header.game_count_ && result == 0; ++game)
+    {
+      Position position;
+      Deck deck;
+      int deck_index = rangeDecodeSymbol(&decoder, &model.decks_, ARCHIVE_MAX_DECKS);
+      if (deck_index < 0 || deck_index >= (int) header.deck_count_)
+      {
+        result = 3;
+        break;
+      }
+      archiveDeckStart(&decks[deck_index], &position, &deck);
+      int show = stats.games_ + 1 == show_game;
+      if (show)
+      {
+        printf("game %ld, deck %016llx:\n", show_game, (unsigned long long) dealHash(&position, &deck));
+      }
+      while (position.phase_ != PHASE_OVER && result == 0)
+      {
+        int move_count = archiveRankMoves(&position, &deck, moves);
+        int rank = move_count > 1 ? rangeDecodeSymbol(&decoder, &model.moves_[move_count], move_count) : 0;
+        if (rank < 0 || decoder.error_)
+        {
+          result = 3;
+          break;
+        }
+        if (show)
+        {
+          printf("player %d: ", position.turn_ + 1);
+          printMove(stdout, moves[rank]);
+          printf("\n");
+        }
+        applyMove(&position, &deck, moves[rank]);
+      }
+      if (result == 0)
+      {
+        gameStatsAdd(&stats, &position);
+      }
+      if (show && result == 0)
+      {
+        printf("player 1 points: %d, player 2 points: %d\n", scorePosition(&position, 0), scorePosition(&position, 1));
+        break;
+      }
+    }
+  }
+  fclose(file);
+  ACCOUNT_FREE(payload);
+
+  if (result == OUT_OF_MEMORY)
+  {
+    printf("Error: Out of memory\n");
+    return result;
+  }
+  if (result != 0)
+  {
+    printf("Error: Invalid file: %s\n", argv[2]);
+    return result;
+  }
+  if (show_game != 0)
+  {
+    if (stats.games_ < show_game)
+    {
+      printf("Error: The archive has only %ld games\n", stats.games_);
+      return 3;
+    }
+    return 0;
+  }
+  printf("games: %ld (%ld blocks, %lu bytes, %.2f bytes per game)\n", stats.games_, blocks, bytes,
+         stats.games_ > 0 ? (double) bytes / (double) stats.games_ : 0.0);
+  if (stats.games_ > 0)
+  {
+    printAnalysis(&stats);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes a config file with random cards for the benchmarks: every card number appears at most once.
+///
+/// @param file_name template of the file name ending in XXXXXX (receives the name of the created file)
+/// @param player_count amount of players (10 cards each)
+/// @param random sequence of the cards
+///
+/// @return success(0) or 2 if the file cannot be created
+//
+int benchWriteConfig(char *file_name, int player_count, Random *random)
+{
+  int numbers[MAX_CARD_NUMBER];
+  int file_descriptor = mkstemp(file_name);
+  FILE *file = file_descriptor < 0 ? NULL : fdopen(file_descriptor, "w");
+
+  if (file == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    if (file_descriptor >= 0)
+    {
+      close(file_descriptor);
+    }
+    return 2;
+  }
+  for (int index = 0; index < MAX_CARD_NUMBER; ++index)
+  {
+    numbers[index] = index + 1;
+  }
+  fprintf(file, "ESP\n%d\n", player_count);
+  for (int index = 0; index < player_count * MAX_CARD_PER_PLAYER && index < MAX_CARD_NUMBER; ++index)
+  {
+    int pick = index + randomBelow(random, MAX_CARD_NUMBER - index);
+    int number = numbers[pick];
+    numbers[pick] = numbers[index];
+    fprintf(file, "%d_%c\n", number, CARD_COLORS[randomBelow(random, ENGINE_COLORS)]);
+  }
+  return fclose(file) == 0 ? 0 : 2;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Prepares the inputs of all benchmarks: a config file of BENCH_LARGE_PLAYERS players and one of a normal game, the
+/// dealt and partly played players of the normal game and the commands of a whole game between two greedy players.
+///
+/// @param context receives the inputs
+///
+/// @return success(0) or the error code of the failed step
+//
+int benchSetup(BenchContext *context)
+{
+  Random random = {1};
+  Position position;
+  Deck deck;
+
+  memset(context, 0, sizeof(BenchContext));
+  snprintf(context->large_config_, sizeof(context->large_config_), "/tmp/a3_bench_XXXXXX");
+  snprintf(context->game_config_, sizeof(context->game_config_), "/tmp/a3_bench_XXXXXX");
+  int result = benchWriteConfig(context->large_config_, BENCH_LARGE_PLAYERS, &random);
+  if (result != 0)
+  {
+    context->large_config_[0] = '\0';
+    return result;
+  }
+  result = benchWriteConfig(context->game_config_, ENGINE_PLAYERS, &random);
+  if (result != 0)
+  {
+    context->game_config_[0] = '\0';
+    return result;
+  }
+  snprintf(context->missing_file_, sizeof(context->missing_file_), "%s.points", context->game_config_);
+
+  for (int index = 0; index < MAX_CARD_NUMBER; ++index)
+  {
+    Card *card = &context->cards_[context->card_count_++];
+    card->number_ = (int) ((unsigned) index * 37u % (unsigned) MAX_CARD_NUMBER) + 1;
+    card->color_ = CARD_COLORS[index % ENGINE_COLORS];
+  }
+
+  result = parseConfigFile(context->game_config_, &context->total_cards_, &context->game_);
+  if (result != 0)
+  {
+    return result;
+  }
+  context->players_ = initializePlayers(&context->game_);
+  if (context->players_ == NULL || cardDistribution(context->players_, context->total_cards_, &context->game_) != 0)
+  {
+    return OUT_OF_MEMORY;
+  }
+  for (int player_index = 0; player_index < context->game_.amount_of_players_; ++player_index)
+  {
+    Player *player = &context->players_[player_index];
+    for (int placed = 0; placed < BENCH_ROW_CARDS && player->hand_cards_ != NULL; ++placed)
+    {
+      Card *card = player->hand_cards_;
+      int selected = 0;
+      int error = 0;
+      if (handleCardSelection(player, &card, &selected, &error) != 0)
+      {
+        return OUT_OF_MEMORY;
+      }
+      result = placeCardInRow(stdout, placed % MAX_ROW, player->chosen_cards_->number_, player, NULL);
+      if (result != 0)
+      {
+        return result;
+      }
+    }
+  }
+
+  result = loadDeck(context->game_config_, &position, &deck);
+  context->start_ = position;
+  context->deck_ = deck;
+  while (result == 0 && position.phase_ != PHASE_OVER && context->script_length_ + 2 <= BENCH_SCRIPT_LINES)
+  {
+    Move move = greedyMove(&position, &deck, NULL);
+    char *line = context->script_[context->script_length_++];
+    switch (move.type_)
+    {
+      case MOVE_CHOOSE:
+        snprintf(line, BENCH_LINE_SIZE, "%d", move.card_);
+        if (move.second_card_ != 0)
+        {
+          snprintf(context->script_[context->script_length_++], BENCH_LINE_SIZE, "%d", move.second_card_);
+        }
+        break;
+      case MOVE_PLACE:
+        snprintf(line, BENCH_LINE_SIZE, "place %d %d", move.row_ + 1, move.card_);
+        break;
+      default:
+        snprintf(line, BENCH_LINE_SIZE, "discard %d", move.card_);
+        break;
+    }
+    applyMove(&position, &deck, move);
+  }
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Frees the inputs of the benchmarks and deletes their config files.
+///
+/// @param context inputs of the benchmarks
+///
+/// @return void
+//
+void benchTeardown(BenchContext *context)
+{
+  if (context->players_ != NULL)
+  {
+    freePlayers(context->players_, &context->game_);
+  }
+  freeCardList(context->total_cards_);
+  ACCOUNT_FREE(context->game_.file_name_);
+  if (context->large_config_[0] != '\0')
+  {
+    unlink(context->large_config_);
+  }
+  if (context->game_config_[0] != '\0')
+  {
+    unlink(context->game_config_);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: parses the config file of BENCH_LARGE_PLAYERS players.
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0) or the error code of parseConfigFile
+//
+int benchParseConfig(BenchContext *context, long iterations)
+{
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    Game game;
+    Card *cards = NULL;
+    int result = parseConfigFile(context->large_config_, &cards, &game);
+    if (result != 0)
+    {
+      return result;
+    }
+    freeCardList(cards);
+    ACCOUNT_FREE(game.file_name_);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: inserts all card numbers in scattered order into a sorted list (one operation per card).
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0)
+//
+int benchInsertSorted(BenchContext *context, long iterations)
+{
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    Card *head = NULL;
+    for (int index = 0; index < context->card_count_; ++index)
+    {
+      insertCardSorted(&head, &context->cards_[index]);
+    }
+    context->sink_ += head->number_;
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: deals the cards of the normal game to new players.
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0) or OUT_OF_MEMORY
+//
+int benchCardDistribution(BenchContext *context, long iterations)
+{
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    Player *players = initializePlayers(&context->game_);
+    if (players == NULL)
+    {
+      return OUT_OF_MEMORY;
+    }
+    int result = cardDistribution(players, context->total_cards_, &context->game_);
+    freePlayers(players, &context->game_);
+    if (result != 0)
+    {
+      return result;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: chooses and places 10 ascending cards in each of the three rows of a player (one operation per card).
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0), OUT_OF_MEMORY or the error code of placeCardInRow
+//
+int benchPlaceCard(BenchContext *context, long iterations)
+{
+  Card *rows[MAX_ROW];
+  Player player = {0, NULL, NULL, rows, 0};
+
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    memset(rows, 0, sizeof(rows));
+    int result = 0;
+    for (int row_index = 0; row_index < MAX_ROW && result == 0; ++row_index)
+    {
+      for (int index = 0; index < MAX_CARD_PER_PLAYER && result == 0; ++index)
+      {
+        Card *card = ACCOUNT_MALLOC(sizeof(Card));
+        if (card == NULL)
+        {
+          result = OUT_OF_MEMORY;
+          break;
+        }
+        card->number_ = row_index * 40 + index * 4 + 1;
+        card->color_ = CARD_COLORS[index % ENGINE_COLORS];
+        insertCardSorted(&player.chosen_cards_, card);
+        result = placeCardInRow(stdout, row_index, card->number_, &player, NULL);
+      }
+    }
+    context->sink_ += rows[0] != NULL ? rows[0]->number_ : 0;
+    freeCardList(player.chosen_cards_);
+    player.chosen_cards_ = NULL;
+    for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+    {
+      freeCardList(rows[row_index]);
+    }
+    if (result != 0)
+    {
+      return result;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: adds up the rows of both players of the partly played game (one operation per row).
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0)
+//
+int benchCalculatePoints(BenchContext *context, long iterations)
+{
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    for (int player_index = 0; player_index < context->game_.amount_of_players_; ++player_index)
+    {
+      int total_points = 0;
+      for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+      {
+        int counter = 0;
+        total_points = calculatePoints(&counter, context->players_[player_index].row_[row_index], total_points);
+        context->sink_ += counter;
+      }
+      context->sink_ += total_points;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: prints the final points of the partly played game. The results file does not exist, so nothing is
+/// written to it.
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0)
+//
+int benchPrintPoints(BenchContext *context, long iterations)
+{
+  Game game = context->game_;
+  game.file_name_ = context->missing_file_;
+
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    printPoints(stdout, context->players_, &game);
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: prints the status of every player of the partly played game (one operation per player).
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0)
+//
+int benchPrintStatus(BenchContext *context, long iterations)
+{
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    for (int player_index = 0; player_index < context->game_.amount_of_players_; ++player_index)
+    {
+      printPlayerStatusInfo(stdout, &context->players_[player_index]);
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark: plays the normal game from the config file to the points like "./a3 <config file>", with the commands
+/// of two greedy players as input.
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+///
+/// @return success(0), OUT_OF_MEMORY, the error code of parseConfigFile or ERROR if the commands did not end the game
+//
+int benchHeadlessGame(BenchContext *context, long iterations)
+{
+  char line[BENCH_LINE_SIZE];
+
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    GameFlow flow;
+    Card *cards = NULL;
+    Game *game = ACCOUNT_MALLOC(sizeof(Game));
+    if (game == NULL)
+    {
+      return OUT_OF_MEMORY;
+    }
+    int result = parseConfigFile(context->game_config_, &cards, game);
+    if (result != 0)
+    {
+      ACCOUNT_FREE(game);
+      return result;
+    }
+    Player *players = initializePlayers(game);
+    if (players == NULL)
+    {
+      freeMemory(game, NULL, cards);
+      return OUT_OF_MEMORY;
+    }
+    if (cardDistribution(players, cards, game) != 0)
+    {
+      freeMemory(game, players, cards);
+      return OUT_OF_MEMORY;
+    }
+    gameFlowStart(&flow, stdout, players, game, 0);
+    for (int index = 0; index < context->script_length_ && flow.phase_ != PHASE_OVER; ++index)
+    {
+      memcpy(line, context->script_[index], sizeof(line));
+      gameFlowStep(&flow, line);
+    }
+    result = flow.phase_ == PHASE_OVER ? flow.result_ : ERROR;
+    ACCOUNT_FREE(flow.journal_.entries_);
+    freeMemory(game, players, cards);
+    if (result != 0)
+    {
+      return result;
+    }
+  }
+  return 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Benchmark of playoutRandom: a whole game from the start position of the config file with random moves.
+///
+/// @param context inputs of the benchmarks
+/// @param iterations amount of games to play
+///
+/// @return success(0)
+//
+int benchRandomRollout(BenchContext *context, long iterations)
+{
+  Random random = {(uint64_t) context->sink_};
+
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    Position position = context->start_;
+    context->sink_ += playoutRandom(&position, &context->deck_, &random);
+  }
+  return 0;
+}
+
+const Benchmark BENCHMARKS[] = {
+  {"parse_config", 1, benchParseConfig},
+  {"insert_sorted", MAX_CARD_NUMBER, benchInsertSorted},
+  {"card_distribution", 1, benchCardDistribution},
+  {"place_card", MAX_ROW * MAX_CARD_PER_PLAYER, benchPlaceCard},
+  {"calculate_points", ENGINE_PLAYERS * MAX_ROW, benchCalculatePoints},
+  {"print_points", 1, benchPrintPoints},
+  {"print_status", ENGINE_PLAYERS, benchPrintStatus},
+  {"headless_game", 1, benchHeadlessGame},
+  {"random_rollout", 1, benchRandomRollout},
+};
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Runs a benchmark with the standard output going to /dev/null, so printing benchmarks measure the formatting and
+/// not the terminal.
+///
+/// @param benchmark benchmark to run
+/// @param context inputs of the benchmarks
+/// @param iterations amount of runs
+/// @param seconds receives the time the runs took
+///
+/// @return success(0) or the error code of the benchmark
+//
+int benchMeasure(const Benchmark *benchmark, BenchContext *context, long iterations, double *seconds)
+{
+  struct timespec started;
+  int null_fd = open("/dev/null", O_WRONLY);
+  int saved_fd = null_fd < 0 ? -1 : dup(STDOUT_FILENO);
+
+  fflush(stdout);
+  if (saved_fd >= 0)
+  {
+    dup2(null_fd, STDOUT_FILENO);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  int result = benchmark->run_(context, iterations);
+  fflush(stdout);
+  *seconds = secondsSince(&started);
+  if (saved_fd >= 0)
+  {
+    dup2(saved_fd, STDOUT_FILENO);
+    close(saved_fd);
+  }
+  if (null_fd >= 0)
+  {
+    close(null_fd);
+  }
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Orders doubles ascending for qsort.
+///
+/// @param first first double
+/// @param second second double
+///
+/// @return negative, zero or positive like strcmp
+//
+int compareDoubles(const void *first, const void *second)
+{
+  double first_value = *(const double *) first;
+  double second_value = *(const double *) second;
+  return (first_value > second_value) - (first_value < second_value);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Calculates the median of values.
+///
+/// @param values values (sorted afterwards)
+/// @param count amount of values (at least 1)
+///
+/// @return median
+//
+double benchMedian(double *values, int count)
+{
+  qsort(values, (size_t) count, sizeof(double), compareDoubles);
+  return count % 2 == 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Runs the microbenchmarks of the game functions: "./a3 --bench [--filter <name>] [--repetitions <n>]
+/// [--min-time <milliseconds>]". Every benchmark is first run with doubling iteration counts until one run takes at
+/// least the minimum time (default 20 ms), which also warms up caches and the allocator, then once more as warmup and
+/// then timed <n> times (default 11). Prints one CSV line per benchmark with the median time per operation, the median
+/// absolute deviation and the fastest repetition, so single slow repetitions do not skew the result.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage or the error code of a failed benchmark
+//
+int runBenchTool(int argc, char *argv[], const char *tool_usage)
+{
+  const char *filter = NULL;
+  long repetitions = BENCH_DEFAULT_REPETITIONS;
+  long milliseconds = BENCH_DEFAULT_MILLISECONDS;
+  char *endptr = "";
+  BenchContext *context;
+
+  int usage = 0;
+  for (int argument = 2; argument < argc && !usage; argument += 2)
+  {
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument], "--filter") == 0)
+    {
+      filter = value;
+    }
+    else if (strcmp(argv[argument], "--repetitions") == 0)
+    {
+      repetitions = strtol(value, &endptr, 10);
+      usage = repetitions <= 0 || repetitions > BENCH_MAX_REPETITIONS;
+    }
+    else if (strcmp(argv[argument], "--min-time") == 0)
+    {
+      milliseconds = strtol(value, &endptr, 10);
+      usage = milliseconds <= 0;
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
+  }
+  if (usage)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  context = ACCOUNT_MALLOC(sizeof(BenchContext));
+  if (context == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+  int result = benchSetup(context);
+
+  if (result == 0)
+  {
+    printf("benchmark,operations,repetitions,ns_per_op,mad_ns,min_ns,ops_per_sec\n");
+  }
+  size_t benchmark_count = sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]);
+  for (size_t benchmark_index = 0; benchmark_index < benchmark_count && result == 0; ++benchmark_index)
+  {
+    const Benchmark *benchmark = &BENCHMARKS[benchmark_index];
+    double samples[BENCH_MAX_REPETITIONS];
+    double deviations[BENCH_MAX_REPETITIONS];
+    double seconds = 0;
+    long iterations = 1;
+
+    if (filter != NULL && strstr(benchmark->name_, filter) == NULL)
+    {
+      continue;
+    }
+    for (;;)
+    {
+      result = benchMeasure(benchmark, context, iterations, &seconds);
+      if (result != 0 || seconds * 1000 >= (double) milliseconds)
+      {
+        break;
+      }
+      iterations *= 2;
+    }
+    result = result != 0 ? result : benchMeasure(benchmark, context, iterations, &seconds);
+    double operations = (double) iterations * benchmark->operations_;
+    for (int repetition = 0; repetition < repetitions && result == 0; ++repetition)
+    {
+      result = benchMeasure(benchmark, context, iterations, &seconds);
+      samples[repetition] = seconds * 1e9 / operations;
+    }
+    if (result != 0)
+    {
+      printf("Error: Benchmark %s failed\n", benchmark->name_);
+      break;
+    }
+    double median = benchMedian(samples, (int) repetitions);
+    for (int repetition = 0; repetition < repetitions; ++repetition)
+    {
+      deviations[repetition] = fabs(samples[repetition] - median);
+    }
+    double deviation = benchMedian(deviations, (int) repetitions);
+    printf("%s,%.0f,%ld,%.2f,%.2f,%.2f,%.0f\n", benchmark->name_, operations, repetitions, median, deviation,
+           samples[0], median > 0 ? 1e9 / median : 0.0);
+    fflush(stdout);
+  }
+  benchTeardown(context);
+  ACCOUNT_FREE(context);
+  return result;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Turns the instrumentation on if the environment variable A3_INSTRUMENT names a file ("-" for the standard error).
+/// The summary is appended to it when the program exits. Only games start it; the tools run on several threads,
+/// which would share its counters. Without -DA3_NO_INSTRUMENT every probe costs one check of
+/// a global flag while the instrumentation is off; with it, the probes are compiled out.
+///
+/// @return void
+//
+void instrumentStart(void)
+{
+  const char *file_name = getenv("A3_INSTRUMENT");
+
+  memset(&instrumentation, 0, sizeof(Instrumentation));
+  if (file_name != NULL && file_name[0] != '\0' && atexit(instrumentDump) == 0)
+  {
+    instrumentation.file_name_ = file_name;
+    instrumentation.enabled_ = 1;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Starts a timer of the instrumentation.
+///
+/// @param timer timer to start
+///
+/// @return void
+//
+void instrumentBegin(InstrumentTimer timer)
+{
+  InstrumentTime *time = &instrumentation.timers_[timer];
+  time->running_ = 1;
+  clock_gettime(CLOCK_MONOTONIC, &time->wall_start_);
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time->cpu_start_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Stops a timer of the instrumentation and adds the wall and CPU time since instrumentBegin. Stopping a timer that
+/// is not running does nothing.
+///
+/// @param timer timer to stop
+///
+/// @return void
+//
+void instrumentEnd(InstrumentTimer timer)
+{
+  InstrumentTime *time = &instrumentation.timers_[timer];
+  struct timespec cpu_now;
+
+  if (!time->running_)
+  {
+    return;
+  }
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &cpu_now);
+  double wall = secondsSince(&time->wall_start_);
+  time->running_ = 0;
+  time->count_++;
+  time->wall_ += wall;
+  time->cpu_ += (double) (cpu_now.tv_sec - time->cpu_start_.tv_sec) +
+                (double) (cpu_now.tv_nsec - time->cpu_start_.tv_nsec) / 1e9;
+  time->wall_max_ = wall > time->wall_max_ ? wall : time->wall_max_;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Notes the arrival of an input line: classifies the command by its first word (a number chooses a card) and starts
+/// measuring the time until the game waits for the next input.
+///
+/// @param line input line (not modified)
+///
+/// @return void
+//
+void instrumentCommandBegin(const char *line)
+{
+  char word[BENCH_LINE_SIZE];
+  char *endptr;
+  const char *start = line + strspn(line, " ");
+  size_t length = strcspn(start, " ");
+
+  instrumentation.command_ = COMMAND_OTHER;
+  if (length > 0 && length < sizeof(word))
+  {
+    memcpy(word, start, length);
+    word[length] = '\0';
+    strtol(word, &endptr, 10);
+    if (*endptr == '\0')
+    {
+      instrumentation.command_ = COMMAND_CHOOSE;
+    }
+    for (int command = COMMAND_PLACE; command < COMMAND_OTHER; ++command)
+    {
+      if (stringCompareCaseInsensitive(word, INSTRUMENT_COMMAND_NAMES[command]) == 0)
+      {
+        instrumentation.command_ = command;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &instrumentation.command_start_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the bucket of a latency histogram that holds a latency. The buckets double in size: bucket 0 holds
+/// latencies below 1 microsecond, bucket b latencies below 2^b microseconds.
+///
+/// @param microseconds latency
+///
+/// @return index of the bucket
+//
+int instrumentBucket(double microseconds)
+{
+  int bucket = 0;
+
+  while (bucket < INSTRUMENT_BUCKETS - 1 && microseconds >= (double) (1L << bucket))
+  {
+    bucket++;
+  }
+  return bucket;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds the time since instrumentCommandBegin to the latency histogram of the command (see instrumentBucket).
+///
+/// @return void
+//
+void instrumentCommandEnd(void)
+{
+  double microseconds = secondsSince(&instrumentation.command_start_) * 1e6;
+  int bucket = instrumentBucket(microseconds);
+
+  instrumentation.latency_[instrumentation.command_][bucket]++;
+  if (microseconds > instrumentation.latency_max_[instrumentation.command_])
+  {
+    instrumentation.latency_max_[instrumentation.command_] = microseconds;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Counts a rejected command.
+///
+/// @return void
+//
+void instrumentReject(void)
+{
+  instrumentation.counters_[INSTRUMENT_REJECTED]++;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Estimates a quantile of a latency histogram.
+///
+/// @param buckets histogram of a command (see instrumentCommandEnd)
+/// @param quantile quantile between 0 and 1
+///
+/// @return upper bound of the bucket holding the quantile in microseconds
+//
+long instrumentQuantile(const unsigned long *buckets, double quantile)
+{
+  unsigned long total = 0;
+  unsigned long seen = 0;
+
+  for (int bucket = 0; bucket < INSTRUMENT_BUCKETS; ++bucket)
+  {
+    total += buckets[bucket];
+  }
+  for (int bucket = 0; bucket < INSTRUMENT_BUCKETS; ++bucket)
+  {
+    seen += buckets[bucket];
+    if ((double) seen >= quantile * (double) total)
+    {
+      return 1L << bucket;
+    }
+  }
+  return 1L << (INSTRUMENT_BUCKETS - 1);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Appends the summary of the instrumentation to the file named by A3_INSTRUMENT. Runs at exit.
+///
+/// @return void
+//
+void instrumentDump(void)
+{
+  FILE *out = strcmp(instrumentation.file_name_, "-") == 0 ? stderr : fopen(instrumentation.file_name_, "a");
+
+  if (out == NULL)
+  {
+    return;
+  }
+  fprintf(out, "\ninstrumentation of process %ld\n", (long) getpid());
+  fprintf(out, "%-22s %8s %12s %12s %12s\n", "timer", "count", "wall ms", "cpu ms", "max wall ms");
+  for (int timer = 0; timer < INSTRUMENT_TIMERS; ++timer)
+  {
+    const InstrumentTime *time = &instrumentation.timers_[timer];
+    fprintf(out, "%-22s %8ld %12.3f %12.3f %12.3f\n", INSTRUMENT_TIMER_NAMES[timer], time->count_, time->wall_ * 1e3,
+            time->cpu_ * 1e3, time->wall_max_ * 1e3);
+  }
+  fprintf(out, "%-22s %8s\n", "counter", "value");
+  for (int counter = 0; counter < INSTRUMENT_COUNTERS; ++counter)
+  {
+    fprintf(out, "%-22s %8lu\n", INSTRUMENT_COUNTER_NAMES[counter], instrumentation.counters_[counter]);
+  }
+  fprintf(out, "%-22s %8s %12s %12s %12s %12s\n", "command latency", "count", "p50 us <=", "p90 us <=", "p99 us <=",
+          "max us");
+  for (int command = 0; command < INSTRUMENT_COMMANDS; ++command)
+  {
+    const unsigned long *buckets = instrumentation.latency_[command];
+    unsigned long count = 0;
+    for (int bucket = 0; bucket < INSTRUMENT_BUCKETS; ++bucket)
+    {
+      count += buckets[bucket];
+    }
+    if (count != 0)
+    {
+      fprintf(out, "%-22s %8lu %12ld %12ld %12ld %12.1f\n", INSTRUMENT_COMMAND_NAMES[command], count,
+              instrumentQuantile(buckets, 0.5), instrumentQuantile(buckets, 0.9), instrumentQuantile(buckets, 0.99),
+              instrumentation.latency_max_[command]);
+    }
+  }
+  if (out != stderr)
+  {
+    fclose(out);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Turns the allocation accounting on if the environment variable A3_ACCOUNT names a file ("-" for the standard
+/// error). It has to run before the first allocation, because every block needs the header of the accounting. While
+/// it is off, the wrappers call the C library directly; with -DA3_NO_ACCOUNT they are compiled out.
+///
+/// @return void
+//
+void accountStart(void)
+{
+  const char *file_name = getenv("A3_ACCOUNT");
+
+  if (file_name != NULL && file_name[0] != '\0' && atexit(accountDump) == 0)
+  {
+    accounting.file_name_ = file_name;
+    accounting.enabled_ = 1;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the counters of the calling thread and creates them on first use. Every thread counts into its own
+/// counters, so allocating threads never wait for each other; the counters of all threads are kept in a list for the
+/// report at exit and stay allocated until then.
+///
+/// @return counters of the thread, NULL if they cannot be allocated (the thread then only counts in the totals)
+//
+AccountThread *accountThread(void)
+{
+  if (account_thread == NULL)
+  {
+    account_thread = calloc(1, sizeof(AccountThread));
+    if (account_thread != NULL)
+    {
+      pthread_mutex_lock(&accounting.mutex_);
+      account_thread->next_ = accounting.threads_;
+      accounting.threads_ = account_thread;
+      pthread_mutex_unlock(&accounting.mutex_);
+    }
+  }
+  return account_thread;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Sets the phase of the game the allocations of the calling thread count for.
+///
+/// @param phase phase of the game
+///
+/// @return void
+//
+void accountPhase(AccountPhase phase)
+{
+  AccountThread *thread = accountThread();
+  if (thread != NULL)
+  {
+    thread->phase_ = phase;
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Finds the counters of a call site in a table of call sites, keyed by a hash of the file name and the line (FNV-1a,
+/// open addressing). A new call site takes a free slot; once the table is full, further call sites share one slot.
+///
+/// @param sites table of ACCOUNT_SITES call sites
+/// @param other_sites slot shared by the call sites that do not fit into the table
+/// @param file file name of the call site
+/// @param line line of the call site
+///
+/// @return counters of the call site
+//
+AccountSite *accountSite(AccountSite *sites, AccountSite *other_sites, const char *file, int line)
+{
+  uint64_t hash = 0xCBF29CE484222325ULL ^ (uint64_t) line;
+
+  for (const char *character = file; *character != '\0'; ++character)
+  {
+    hash = (hash ^ (unsigned char) *character) * 0x100000001B3ULL;
+  }
+  for (int probe = 0; probe < ACCOUNT_SITES; ++probe)
+  {
+    AccountSite *site = &sites[(hash + (uint64_t) probe) % ACCOUNT_SITES];
+    if (site->file_ == NULL)
+    {
+      site->file_ = file;
+      site->line_ = line;
+      return site;
+    }
+    if (site->line_ == line && strcmp(site->file_, file) == 0)
+    {
+      return site;
+    }
+  }
+  return other_sites;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Tags a new block with its size and call site and adds it to the totals, the phase and the call site. The live
+/// bytes and their peak are shared atomic counters (one atomic add per block); everything else is counted by the
+/// calling thread. The wrappers also count every allocation for the instrumentation.
+///
+/// @param header header in front of the block
+/// @param size size of the block without the header
+/// @param file file name of the allocation
+/// @param line line of the allocation
+///
+/// @return void
+//
+void accountRecord(AccountHeader *header, size_t size, const char *file, int line)
+{
+  header->block_.size_ = size;
+  header->block_.file_ = file;
+  header->block_.line_ = line;
+
+  long live = atomic_fetch_add_explicit(&accounting.live_bytes_, (long) size, memory_order_relaxed) + (long) size;
+  long peak = atomic_load_explicit(&accounting.peak_bytes_, memory_order_relaxed);
+  while (live > peak && !atomic_compare_exchange_weak_explicit(&accounting.peak_bytes_, &peak, live,
+                                                               memory_order_relaxed, memory_order_relaxed))
+  {
+  }
+
+  AccountThread *thread = accountThread();
+  if (thread == NULL)
+  {
+    return;
+  }
+  AccountSite *site = accountSite(thread->sites_, &thread->other_sites_, file, line);
+  site->allocations_++;
+  site->live_blocks_++;
+  site->live_bytes_ += (long) size;
+  thread->live_blocks_++;
+  thread->phase_allocations_[thread->phase_]++;
+  thread->phase_bytes_[thread->phase_] += size;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Removes a block from the totals and from its call site. A block freed by another thread than the one that
+/// allocated it is subtracted from the counters of the freeing thread; the report adds the threads up.
+///
+/// @param header header in front of the block
+///
+/// @return void
+//
+void accountRelease(const AccountHeader *header)
+{
+  atomic_fetch_sub_explicit(&accounting.live_bytes_, (long) header->block_.size_, memory_order_relaxed);
+
+  AccountThread *thread = accountThread();
+  if (thread == NULL)
+  {
+    return;
+  }
+  AccountSite *site = accountSite(thread->sites_, &thread->other_sites_, header->block_.file_, header->block_.line_);
+  site->live_blocks_--;
+  site->live_bytes_ -= (long) header->block_.size_;
+  thread->live_blocks_--;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// malloc of the allocation accounting.
+///
+/// @param size size of the block
+/// @param file file name of the call
+/// @param line line of the call
+///
+/// @return the block, NULL if out of memory
+//
+void *accountMalloc(size_t size, const char *file, int line)
+{
+  INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+  if (!accounting.enabled_)
+  {
+    return malloc(size);
+  }
+  if (size > SIZE_MAX - sizeof(AccountHeader))
+  {
+    return NULL;
+  }
+  AccountHeader *header = malloc(sizeof(AccountHeader) + size);
+  if (header == NULL)
+  {
+    return NULL;
+  }
+  accountRecord(header, size, file, line);
+  return header + 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// calloc of the allocation accounting.
+///
+/// @param count number of elements
+/// @param size size of an element
+/// @param file file name of the call
+/// @param line line of the call
+///
+/// @return the zeroed block, NULL if out of memory
+//
+void *accountCalloc(size_t count, size_t size, const char *file, int line)
+{
+  INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+  if (!accounting.enabled_)
+  {
+    return calloc(count, size);
+  }
+  if (size != 0 && count > (SIZE_MAX - sizeof(AccountHeader)) / size)
+  {
+    return NULL;
+  }
+  AccountHeader *header = calloc(1, sizeof(AccountHeader) + count * size);
+  if (header == NULL)
+  {
+    return NULL;
+  }
+  accountRecord(header, count * size, file, line);
+  return header + 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// realloc of the allocation accounting. The block moves to the call site of the realloc.
+///
+/// @param pointer block to resize, NULL to allocate a new one
+/// @param size new size of the block
+/// @param file file name of the call
+/// @param line line of the call
+///
+/// @return the resized block, NULL if out of memory (the old block stays valid)
+//
+void *accountRealloc(void *pointer, size_t size, const char *file, int line)
+{
+  if (pointer == NULL)
+  {
+    return accountMalloc(size, file, line);
+  }
+  INSTRUMENT_COUNT(INSTRUMENT_ALLOCATIONS, 1);
+  if (!accounting.enabled_)
+  {
+    return realloc(pointer, size);
+  }
+  if (size > SIZE_MAX - sizeof(AccountHeader))
+  {
+    return NULL;
+  }
+  AccountHeader old_header = *((AccountHeader *) pointer - 1);
+  AccountHeader *header = realloc((AccountHeader *) pointer - 1, sizeof(AccountHeader) + size);
+  if (header == NULL)
+  {
+    return NULL;
+  }
+  accountRelease(&old_header);
+  accountRecord(header, size, file, line);
+  return header + 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// free of the allocation accounting.
+///
+/// @param pointer block to free, may be NULL
+///
+/// @return void
+//
+void accountFree(void *pointer)
+{
+  if (!accounting.enabled_)
+  {
+    free(pointer);
+    return;
+  }
+  if (pointer == NULL)
+  {
+    return;
+  }
+  AccountHeader *header = (AccountHeader *) pointer - 1;
+  accountRelease(header);
+  free(header);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Appends the report of the allocation accounting to the file named by A3_ACCOUNT: the peak, the allocations per
+/// phase of the game and every call site whose blocks are still live at exit, with the counters of all threads added
+/// up. Runs at exit, when the other threads are done.
+///
+/// @return void
+//
+void accountDump(void)
+{
+  FILE *out = strcmp(accounting.file_name_, "-") == 0 ? stderr : fopen(accounting.file_name_, "a");
+  static AccountSite sites[ACCOUNT_SITES];
+  AccountSite other_sites = {NULL, 0, 0, 0, 0};
+  unsigned long phase_allocations[ACCOUNT_PHASES] = {0};
+  unsigned long phase_bytes[ACCOUNT_PHASES] = {0};
+  long live_blocks = 0;
+  int site_count = 0;
+
+  if (out == NULL)
+  {
+    return;
+  }
+  pthread_mutex_lock(&accounting.mutex_);
+  for (const AccountThread *thread = accounting.threads_; thread != NULL; thread = thread->next_)
+  {
+    live_blocks += thread->live_blocks_;
+    for (int phase = 0; phase < ACCOUNT_PHASES; ++phase)
+    {
+      phase_allocations[phase] += thread->phase_allocations_[phase];
+      phase_bytes[phase] += thread->phase_bytes_[phase];
+    }
+    for (int index = 0; index <= ACCOUNT_SITES; ++index)
+    {
+      const AccountSite *thread_site = index < ACCOUNT_SITES ? &thread->sites_[index] : &thread->other_sites_;
+      AccountSite *site = thread_site->file_ == NULL ? &other_sites :
+                          accountSite(sites, &other_sites, thread_site->file_, thread_site->line_);
+      site->allocations_ += thread_site->allocations_;
+      site->live_blocks_ += thread_site->live_blocks_;
+      site->live_bytes_ += thread_site->live_bytes_;
+    }
+  }
+  pthread_mutex_unlock(&accounting.mutex_);
+
+  fprintf(out, "\nallocation accounting of process %ld\n", (long) getpid());
+  fprintf(out, "peak %ld bytes, live at exit %ld bytes in %ld blocks\n",
+          atomic_load_explicit(&accounting.peak_bytes_, memory_order_relaxed),
+          atomic_load_explicit(&accounting.live_bytes_, memory_order_relaxed), live_blocks);
+  fprintf(out, "%-22s %12s %12s\n", "phase", "allocations", "bytes");
+  for (int phase = 0; phase < ACCOUNT_PHASES; ++phase)
+  {
+    fprintf(out, "%-22s %12lu %12lu\n", ACCOUNT_PHASE_NAMES[phase], phase_allocations[phase], phase_bytes[phase]);
+  }
+  if (live_blocks == 0)
+  {
+    fprintf(out, "no leaks\n");
+  }
+  else
+  {
+    fprintf(out, "%-22s %12s %12s %12s\n", "leaked at", "blocks", "bytes", "allocations");
+  }
+  for (int index = 0; index < ACCOUNT_SITES; ++index)
+  {
+    if (sites[index].live_blocks_ != 0)
+    {
+      sites[site_count++] = sites[index];
+    }
+  }
+  qsort(sites, (size_t) site_count, sizeof(AccountSite), compareAccountSites);
+  for (int index = 0; index <= site_count && live_blocks != 0; ++index)
+  {
+    const AccountSite *site = index < site_count ? &sites[index] : &other_sites;
+    char location[BUFFER_SIZE];
+    strcpy(location, "?");
+    if (site->file_ != NULL)
+    {
+      snprintf(location, sizeof(location), "%s:%d", site->file_, site->line_);
+    }
+    if (site->live_blocks_ != 0)
+    {
+      fprintf(out, "%-22s %12ld %12ld %12lu\n", location, site->live_blocks_, site->live_bytes_, site->allocations_);
+    }
+  }
+  if (out != stderr)
+  {
+    fclose(out);
+  }
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Orders call sites of the allocation accounting by file name and line for qsort.
+///
+/// @param first pointer to the first call site
+/// @param second pointer to the second call site
+///
+/// @return comparison result
+//
+int compareAccountSites(const void *first, const void *second)
+{
+  const AccountSite *first_site = first;
+  const AccountSite *second_site = second;
+  int result = strcmp(first_site->file_, second_site->file_);
+
+  return result != 0 ? result : (first_site->line_ > second_site->line_) - (first_site->line_ < second_site->line_);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Sets up a deck generator. The weights of the colors are given as "<b>:<g>:<w>:<r>", NULL deals every color with
+/// the same probability.
+///
+/// @param generator receives the generator
+/// @param seed seed of all decks of the generator
+/// @param colors weights of the colors blue, green, white and red or NULL
+///
+/// @return success(0) or ERROR if the weights are invalid
+//
+int deckGeneratorInit(DeckGenerator *generator, uint64_t seed, const char *colors)
+{
+  memset(generator, 0, sizeof(DeckGenerator));
+  generator->seed_ = seed;
+  for (int color = 0; color < ENGINE_COLORS; ++color)
+  {
+    unsigned long weight = 1;
+    if (colors != NULL)
+    {
+      char *endptr;
+      if (!isdigit((unsigned char) *colors))
+      {
+        return ERROR;
+      }
+      weight = strtoul(colors, &endptr, 10);
+      if (*endptr != (color + 1 < ENGINE_COLORS ? ':' : '\0') || weight > 0xFFFF)
+      {
+        return ERROR;
+      }
+      colors = endptr + 1;
+    }
+    generator->color_weights_[color] = (uint32_t) weight;
+    generator->color_total_ += (uint32_t) weight;
+  }
+  return generator->color_total_ == 0 ? ERROR : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Generates a deck: DECK_CARDS different cards in random order, as the start of a random permutation of all
+/// MAX_CARD_NUMBER cards, each with a color drawn by the weights of the generator. Every deck has its own stream of the
+/// counter based random numbers (splitmix64) that only depends on the seed and the index, so a deck is the same no
+/// matter which thread generates it and in which order.
+///
+/// @param generator deck generator
+/// @param index index of the deck
+/// @param generated receives the deck in the order of a config file
+///
+/// @return void
+//
+void deckGenerate(const DeckGenerator *generator, uint64_t index, GeneratedDeck *generated)
+{
+  Random random = {generator->seed_ + index * 0xD1B54A32D192ED03ULL};
+  CardSet dealt;
+
+  memset(&dealt, 0, sizeof(CardSet));
+  for (int card_index = 0; card_index < DECK_CARDS;)
+  {
+    int card = 1 + randomBelow(&random, MAX_CARD_NUMBER);
+    if (cardSetContains(&dealt, card))
+    {
+      continue;
+    }
+    cardSetAdd(&dealt, card);
+
+    int weight = randomBelow(&random, (int) generator->color_total_);
+    int color = 0;
+    while (weight >= (int) generator->color_weights_[color])
+    {
+      weight -= (int) generator->color_weights_[color++];
+    }
+    generated->numbers_[card_index] = (uint8_t) card;
+    generated->colors_[card_index] = CARD_COLORS[color];
+    card_index++;
+  }
+  generated->deal_ = 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Builds the start position and the deck of a generated deck, exactly like loadDeck of its config file: the first
+/// half of the cards is the hand of player 1, the second half the hand of player 2.
+///
+/// @param generated generated deck
+/// @param start receives the start position
+/// @param deck receives the deck lookup table
+///
+/// @return void
+//
+void deckStart(const GeneratedDeck *generated, Position *start, Deck *deck)
+{
+  memset(start, 0, sizeof(Position));
+  memset(deck, 0, sizeof(Deck));
+  for (int card_index = 0; card_index < DECK_CARDS; ++card_index)
+  {
+    int card = generated->numbers_[card_index];
+    cardSetAdd(&start->hand_cards_[card_index * ENGINE_PLAYERS / DECK_CARDS], card);
+    deck->color_[card] = generated->colors_[card_index];
+    deck->points_[card] = (uint8_t) colorPoints(deck->color_[card]);
+  }
+  start->phase_ = PHASE_CHOOSING;
+  settlePosition(start);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Writes a generated deck as config file for two players.
+///
+/// @param generated generated deck
+/// @param file_name name of the config file
+///
+/// @return success(0) or ERROR if the file cannot be written
+//
+int deckWrite(const GeneratedDeck *generated, const char *file_name)
+{
+  FILE *file = fopen(file_name, "w");
+  if (file == NULL)
+  {
+    return ERROR;
+  }
+  fprintf(file, "ESP\n%d\n", ENGINE_PLAYERS);
+  for (int card_index = 0; card_index < DECK_CARDS; ++card_index)
+  {
+    fprintf(file, "%d_%c\n", generated->numbers_[card_index], generated->colors_[card_index]);
+  }
+  int failed = ferror(file);
+  return fclose(file) != 0 || failed ? ERROR : 0;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Formats a generated deck as output line of --gen-decks: the hash of the deal and the cards, ended by a newline.
+/// Formats by hand, since printf of every card costs more than generating the deck.
+///
+/// @param generated generated deck with the hash of its deal
+/// @param line receives the line (at least DECK_LINE_SIZE characters, not terminated)
+///
+/// @return length of the line
+//
+int deckFormat(const GeneratedDeck *generated, char *line)
+{
+  static const char digits[] = "0123456789abcdef";
+  int length = 0;
+
+  for (int shift = 60; shift >= 0; shift -= 4)
+  {
+    line[length++] = digits[((uint64_t) generated->deal_ >> shift) & 0xF];
+  }
+  for (int card_index = 0; card_index < DECK_CARDS; ++card_index)
+  {
+    int card = generated->numbers_[card_index];
+    line[length++] = ' ';
+    if (card >= 100)
+    {
+      line[length++] = digits[card / 100];
+    }
+    if (card >= 10)
+    {
+      line[length++] = digits[card / 10 % 10];
+    }
+    line[length++] = digits[card % 10];
+    line[length++] = '_';
+    line[length++] = generated->colors_[card_index];
+  }
+  line[length++] = '\n';
+  return length;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Thread of the deck generator: generates, hashes and formats a slice of a batch of decks.
+///
+/// @param argument DeckWorker of the thread
+///
+/// @return NULL
+//
+void *deckWorker(void *argument)
+{
+  DeckWorker *worker = argument;
+  Position start;
+  Deck deck;
+
+  for (long deck_index = 0; deck_index < worker->count_; ++deck_index)
+  {
+    GeneratedDeck *generated = &worker->decks_[deck_index];
+    deckGenerate(worker->generator_, worker->first_ + (uint64_t) deck_index, generated);
+    deckStart(generated, &start, &deck);
+    generated->deal_ = dealHash(&start, &deck);
+    generated->line_length_ = deckFormat(generated, generated->line_);
+  }
+  return NULL;
+}
 
-void copyCardData(Card *source, Card *destination);
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Generates random decks: "./a3 --gen-decks <n> [--seed <n>] [--colors <b>:<g>:<w>:<r>] [--threads <n>]
+/// [--output <prefix>]". Every deck is printed as one line with the hash of its deal (see dealHash) and its cards in
+/// the order of a config file. "--output <prefix>" writes the decks as config files "<prefix>1.txt" to
+/// "<prefix><n>.txt" instead. The decks are generated in batches on several threads; the output only depends on the
+/// seed and the color weights.
+///
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
+///
+/// @return 0 on success, 1 on wrong usage, 2 if a config file cannot be written or OUT_OF_MEMORY
+//
+int runDeckTool(int argc, char *argv[], const char *tool_usage)
+{
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  uint64_t seed = 1;
+  const char *colors = NULL;
+  const char *prefix = NULL;
+  char *endptr = "";
+  long count = argc >= 3 ? strtol(argv[2], &endptr, 10) : 0;
+  DeckGenerator generator;
+
+  int usage = argc < 3 || count <= 0 || *endptr != '\0';
+  for (int argument = 3; argument < argc && !usage; argument += 2)
+  {
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument], "--seed") == 0)
+    {
+      seed = strtoull(value, &endptr, 10);
+    }
+    else if (strcmp(argv[argument], "--colors") == 0)
+    {
+      colors = value;
+    }
+    else if (strcmp(argv[argument], "--threads") == 0)
+    {
+      threads = strtol(value, &endptr, 10);
+      usage = threads <= 0 || threads > QUERY_MAX_THREADS;
+    }
+    else if (strcmp(argv[argument], "--output") == 0)
+    {
+      prefix = value;
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
+  }
+  if (usage || deckGeneratorInit(&generator, seed, colors) != 0)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  threads = threads < QUERY_MAX_THREADS ? threads : QUERY_MAX_THREADS;
 
-void handleCardChoosingPrompt(int numbers_entered, int error, int player_index);
+  GeneratedDeck *decks = ACCOUNT_MALLOC(sizeof(GeneratedDeck) * DECK_BATCH);
+  if (decks == NULL)
+  {
+    printf("Error: Out of memory\n");
+    return OUT_OF_MEMORY;
+  }
+  DeckWorker workers[QUERY_MAX_THREADS];
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  int result = 0;
+  for (long first = 0; first < count && result == 0; first += DECK_BATCH)
+  {
+    long batch = count - first < DECK_BATCH ? count - first : DECK_BATCH;
+    long slice = (batch + threads - 1) / threads;
+    long started_threads = 0;
+    long generated = 0;
+    for (; started_threads < threads && generated < batch; ++started_threads)
+    {
+      DeckWorker *worker = &workers[started_threads];
+      worker->generator_ = &generator;
+      worker->first_ = (uint64_t) (first + generated);
+      worker->decks_ = &decks[generated];
+      worker->count_ = batch - generated < slice ? batch - generated : slice;
+      if (pthread_create(&worker->thread_, NULL, deckWorker, worker) != 0)
+      {
+        break;
+      }
+      generated += worker->count_;
+    }
+    for (long thread_index = 0; thread_index < started_threads; ++thread_index)
+    {
+      pthread_join(workers[thread_index].thread_, NULL);
+    }
+    if (generated < batch)
+    {
+      deckWorker(&(DeckWorker) {&generator, (uint64_t) (first + generated), &decks[generated], batch - generated, 0});
+    }
 
-int handleUserInput(char **input_buffer, int *result, int *error, int player_index);
+    for (long deck_index = 0; deck_index < batch && result == 0; ++deck_index)
+    {
+      const GeneratedDeck *deck = &decks[deck_index];
+      if (prefix != NULL)
+      {
+        char file_name[BUFFER_SIZE];
+        snprintf(file_name, sizeof(file_name), "%s%ld.txt", prefix, first + deck_index + 1);
+        if (deckWrite(deck, file_name) != 0)
+        {
+          printf("Error: Cannot open file: %s\n", file_name);
+          result = 2;
+        }
+        continue;
+      }
+      fwrite(deck->line_, 1, (size_t) deck->line_length_, stdout);
+    }
+  }
+  ACCOUNT_FREE(decks);
+  if (prefix != NULL && result == 0)
+  {
+    printf("%ld decks written in %.2f s\n", count, secondsSince(&started));
+  }
+  return result;
+}
 
-int handleCardSelection(Player *player, Card **tmp, int *numbers_entered, int *error);
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens an empty card set for large decks: a bit per card like CardSet plus a Fenwick tree over the popcounts of
+/// the words, so adding, removing and finding the card of a rank take logarithmic time and iterating the set in
+/// ascending order stays a scan of the words.
+///
+/// @param set receives the set
+/// @param cards highest card number of the deck
+///
+/// @return success(0) or OUT_OF_MEMORY
+//
+int wideSetOpen(WideCardSet *set, int cards)
+{
+  set->words_ = cards / 64 + 1;
+  set->count_ = 0;
+  set->bits_ = ACCOUNT_CALLOC((size_t) set->words_, sizeof(uint64_t));
+  set->tree_ = ACCOUNT_CALLOC((size_t) set->words_ + 1, sizeof(int32_t));
+  if (set->bits_ == NULL || set->tree_ == NULL)
+  {
+    wideSetClose(set);
+    return OUT_OF_MEMORY;
+  }
+  return 0;
+}
 
-int initializeGame(int argc, char *argv[]);
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Frees a card set for large decks.
+///
+/// @param set set to free
+///
+/// @return void
+//
+void wideSetClose(WideCardSet *set)
+{
+  ACCOUNT_FREE(set->bits_);
+  ACCOUNT_FREE(set->tree_);
+  set->bits_ = NULL;
+  set->tree_ = NULL;
+}
 
-void handleInvalidInput(Game *game, Player *players, Card *totalCards);
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Changes the popcount of a word in the Fenwick tree of a card set for large decks.
+///
+/// @param set set to update
+/// @param word index of the word
+/// @param amount change of the popcount (+1 or -1)
+///
+/// @return void
+//
+void wideSetUpdate(WideCardSet *set, int word, int amount)
+{
+  for (int node = word + 1; node <= set->words_; node += node & -node)
+  {
+    set->tree_[node] += amount;
+  }
+  set->count_ += amount;
+}
 
-Player *initializePlayers(Game *game, Card *total_cards);
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Adds a card number to a card set for large decks.
+///
+/// @param set card set to modify
+/// @param number card number that is not in the set yet
+///
+/// @return void
+//
+void wideSetAdd(WideCardSet *set, int number)
+{
+  set->bits_[number >> 6] |= (uint64_t) 1 << (number & 63);
+  wideSetUpdate(set, number >> 6, 1);
+}
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Entry and exitpoint of my program.
+/// Removes a card number from a card set for large decks.
 ///
-/// @param argc number of program arguments passed
-/// @param argv arguments passed represented as string-array
+/// @param set card set to modify
+/// @param number card number in the set
 ///
-/// @return exit code 0(success) - 4
+/// @return void
 //
-int main(int argc, char *argv[])
+void wideSetRemove(WideCardSet *set, int number)
 {
-  return initializeGame(argc, argv);
+  set->bits_[number >> 6] &= ~((uint64_t) 1 << (number & 63));
+  wideSetUpdate(set, number >> 6, -1);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Creates and initializes two structs and passes them on. Handles different return values from other functions and
-/// frees allocated memory accordingly.
+/// Checks if a card number is part of a card set for large decks.
 ///
-/// @param argc number of program arguments passed
-/// @param argv arguments passed represented as string-array
+/// @param set card set to check
+/// @param number card number
 ///
-/// @return exit code 0(success) - 4
+/// @return 1 if the card is in the set, 0 otherwise
 //
-int initializeGame(int argc, char *argv[])
+int wideSetContains(const WideCardSet *set, int number)
 {
-  Game *game = malloc(sizeof(Game));
-  if (game == NULL)
+  if (number < 1 || (number >> 6) >= set->words_)
   {
-    printf("Error: Out of memory\n");
-    return OUT_OF_MEMORY;
+    return 0;
   }
+  return (int) ((set->bits_[number >> 6] >> (number & 63)) & 1);
+}
 
-  if (argc != 2)
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Finds the card at a position of the ascending order of a card set for large decks: the Fenwick tree finds the word
+/// in logarithmic time, bitSelect the bit.
+///
+/// @param set card set to search
+/// @param index position of the card (0 - count - 1)
+///
+/// @return card number
+//
+int wideSetSelect(const WideCardSet *set, int index)
+{
+  int word = 0;
+  int step = 1;
+  while (step * 2 <= set->words_)
   {
-    printf("Usage: ./a3 <config file>\n");
-    handleInvalidInput(game, NULL, NULL);
-    return 1;
+    step *= 2;
   }
-  Card *totalCards;
-  int result = parseConfigFile(argv[1], &totalCards, game);
-  if (result != 0)
+  for (; step > 0; step /= 2)
   {
-    handleInvalidInput(game, NULL, NULL);
-    return result;
+    if (word + step <= set->words_ && set->tree_[word + step] <= index)
+    {
+      word += step;
+      index -= set->tree_[word];
+    }
   }
+  return (word << 6) + bitSelect(set->bits_[word], index);
+}
 
-  printf("Welcome to SyntaxSakura (%d players are playing)!\n", game->amount_of_players_);
-
-  Player *players = initializePlayers(game, totalCards);
-  if (players == NULL)
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Counts the cards of a card set for large decks that are lower than a card number, in logarithmic time.
+///
+/// @param set card set to count
+/// @param number card number
+///
+/// @return amount of cards in the set lower than the number
+//
+int wideSetRank(const WideCardSet *set, int number)
+{
+  int word = number >> 6;
+  if (word >= set->words_)
   {
-    handleInvalidInput(game, players, totalCards);
-    return OUT_OF_MEMORY;
+    return set->count_;
   }
-
-  result = cardDistribution(players, totalCards, game);
-  if (result == OUT_OF_MEMORY)
+  int rank = __builtin_popcountll(set->bits_[word] & (((uint64_t) 1 << (number & 63)) - 1));
+  for (int node = word; node > 0; node -= node & -node)
   {
-    handleInvalidInput(game, players, totalCards);
-    return OUT_OF_MEMORY;
+    rank += set->tree_[node];
   }
+  return rank;
+}
 
-  result = runningGame(players, game);
-  if (result == OUT_OF_MEMORY)
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Opens the empty rows of a player of a large game.
+///
+/// @param rows receives the rows
+/// @param row_count amount of rows
+/// @param cards highest card number of the deck
+///
+/// @return success(0) or OUT_OF_MEMORY
+//
+int stressRowsOpen(StressRows *rows, int row_count, int cards)
+{
+  memset(rows, 0, sizeof(StressRows));
+  rows->rows_ = ACCOUNT_CALLOC((size_t) row_count, sizeof(StressRow));
+  rows->empty_ = ACCOUNT_MALLOC(sizeof(int) * (size_t) row_count);
+  if (rows->rows_ == NULL || rows->empty_ == NULL || wideSetOpen(&rows->lows_, cards) != 0 ||
+      wideSetOpen(&rows->highs_, cards) != 0)
   {
-    handleInvalidInput(game, players, totalCards);
+    stressRowsClose(rows);
     return OUT_OF_MEMORY;
   }
-
-  freeMemory(game, players, totalCards);
+  rows->count_ = row_count;
+  rows->empty_count_ = row_count;
+  for (int row_index = 0; row_index < row_count; ++row_index)
+  {
+    rows->empty_[row_index] = row_count - 1 - row_index;
+  }
   return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function gets called when a user inputs wrong values. And calls the freeMemory function.
-/// This function saves a lot of lines in my programm.
+/// Frees the rows of a player of a large game.
 ///
-/// @param game strcut game(holds all important values for the game)
-/// @param players array of struct Player
-/// @param totalCards linked list of all the cards parsed from config file.
+/// @param rows rows to free
 ///
 /// @return void
 //
-void handleInvalidInput(Game *game, Player *players, Card *totalCards)
+void stressRowsClose(StressRows *rows)
 {
-  freeMemory(game, players, totalCards);
+  ACCOUNT_FREE(rows->rows_);
+  ACCOUNT_FREE(rows->empty_);
+  wideSetClose(&rows->lows_);
+  wideSetClose(&rows->highs_);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Initializes and creates struct Player dinamically.
+/// Places a card of a large game in a random row it fits (see placeCardInRow). A card fits the empty rows, the rows
+/// with a higher lowest card and the rows with a lower highest card. The lowest and highest cards of all rows are kept
+/// in WideCardSets, so counting and picking a fitting row takes logarithmic time, no matter how many rows there are.
 ///
-/// @param game struct Game(holds all important values for the game)
-/// @param totalCards linked list of all the cards parsed from config file.
+/// @param rows rows of the player
+/// @param row_of_card row index of every placed card
+/// @param card card to place
+/// @param color color of the card
+/// @param random sequence of the game
 ///
-/// @return players array of struct Player
+/// @return 1 if the card was placed, 0 if it fits no row and is discarded
 //
-Player *initializePlayers(Game *game, Card *total_cards)
+int stressPlace(StressRows *rows, int *row_of_card, int card, char color, Random *random)
 {
-  Player *players = malloc(sizeof(Player) * game->amount_of_players_);
-  if (players == NULL)
+  int lows_below = wideSetRank(&rows->lows_, card);
+  int lows_above = rows->lows_.count_ - lows_below;
+  int highs_below = wideSetRank(&rows->highs_, card);
+  int fitting = rows->empty_count_ + lows_above + highs_below;
+  if (fitting == 0)
   {
-    printf("Error: Out of memory\n");
-    return NULL;
+    return 0;
   }
 
-  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  int pick = randomBelow(random, fitting);
+  int row_index;
+  if (pick < rows->empty_count_)
   {
-    players[player_index].index = player_index;
-    players[player_index].hand_cards_ = NULL;
-    players[player_index].chosen_cards_ = NULL;
-    players[player_index].row_ = malloc(sizeof(Card) * MAX_ROW);
-    if (players[player_index].row_ == NULL)
-    {
-      printf("Error: Out of memory\n");
-      freeMemory(game, players, total_cards);
-      return NULL;
-    }
-    for (int row_index = 0; row_index < MAX_ROW; ++row_index)
-    {
-      players[player_index].row_[row_index] = NULL;
-    }
+    row_index = rows->empty_[pick];
+    rows->empty_[pick] = rows->empty_[--rows->empty_count_];
+    rows->rows_[row_index].low_ = card;
+    rows->rows_[row_index].high_ = card;
+    wideSetAdd(&rows->lows_, card);
+    wideSetAdd(&rows->highs_, card);
   }
-
-  return players;
+  else if (pick < rows->empty_count_ + lows_above)
+  {
+    int low = wideSetSelect(&rows->lows_, lows_below + pick - rows->empty_count_);
+    row_index = row_of_card[low];
+    rows->rows_[row_index].low_ = card;
+    wideSetRemove(&rows->lows_, low);
+    wideSetAdd(&rows->lows_, card);
+  }
+  else
+  {
+    int high = wideSetSelect(&rows->highs_, pick - rows->empty_count_ - lows_above);
+    row_index = row_of_card[high];
+    rows->rows_[row_index].high_ = card;
+    wideSetRemove(&rows->highs_, high);
+    wideSetAdd(&rows->highs_, card);
+  }
+  row_of_card[card] = row_index;
+  rows->rows_[row_index].length_++;
+  rows->rows_[row_index].points_ += colorPoints(color);
+  return 1;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Gets called at the end or when a memory alloc happens to clear all allocated memory to avoid memory leaks.
+/// Calculates the points of a player of a large game like printPoints: the points of the longest row (lowest index on
+/// ties) count twice.
 ///
-/// @param game struct Game(holds all important values for the game)
-/// @param players array of struct Player
-/// @param totalCards linked list of all the cards parsed from config file.
+/// @param rows rows of the player
 ///
-/// @return void
+/// @return points of the player
 //
-void freeMemory(Game *game, Player *player, Card *card)
+long stressScore(const StressRows *rows)
 {
-  if (player != NULL && card != NULL)
+  long total_points = 0;
+  int longest_length = 0;
+  long longest_points = 0;
+
+  for (int row_index = 0; row_index < rows->count_; ++row_index)
   {
-    for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
-    {
-      while (player[player_index].chosen_cards_ != NULL)
-      {
-        Card *temp = player[player_index].chosen_cards_;
-        player[player_index].chosen_cards_ = temp->next_;
-        free(temp);
-      }
-      while (player[player_index].hand_cards_ != NULL)
-      {
-        Card *temp = player[player_index].hand_cards_;
-        player[player_index].hand_cards_ = temp->next_;
-        free(temp);
-      }
-      for (int row_index = 0; row_index < MAX_ROW; ++row_index)
-      {
-        while (player[player_index].row_[row_index] != NULL)
-        {
-          Card *temp = player[player_index].row_[row_index];
-          player[player_index].row_[row_index] = temp->next_;
-          free(temp);
-        }
-      }
-      free(player[player_index].row_);
-    }
-    free(player);
-    while (card != NULL)
+    const StressRow *row = &rows->rows_[row_index];
+    total_points += row->points_;
+    if (row->length_ > longest_length)
     {
-      Card *temp = card;
-      card = temp->next_;
-      free(temp);
+      longest_length = row->length_;
+      longest_points = row->points_;
     }
-    free(game->file_name_);
   }
-  free(game);
+  return total_points + longest_points;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Opens and reads the config file and parses all cards, amount of players and magic number.
+/// Load test with large decks: "./a3 --stress <cards> <hand size> <rows> [--players <n>] [--seed <n>]". Shuffles
+/// cards 1 to <cards> (at most STRESS_MAX_CARDS) with random colors, deals <hand size> cards to every player like
+/// cardDistribution and plays the game to the end with the rules of the game and <rows> rows per player: every player
+/// keeps two random hand cards per round, the hands are passed on and every kept card goes into a random row it fits.
+/// Hands and row ends are WideCardSets, so dealing and placing cost logarithmic time per card instead of list scans.
 ///
-/// @param file_name string of the entered file name
-/// @param totalCards linked list of all the cards parsed from config file
-/// @param game struct Game(holds all important values for the game)
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
 ///
-/// @return int read successfully(0) or not(-1, 2, 4)
+/// @return 0 on success, 1 on wrong usage or OUT_OF_MEMORY
 //
-int parseConfigFile(char *file_name, Card **total_cards, Game *game)
+int runStressTool(int argc, char *argv[], const char *tool_usage)
 {
-  int confirmation;
-  int people;
-  int cards = 0;
-  FILE *config_file = fopen(file_name, "r");
+  char *endptr = "";
+  long values[3] = {0, 0, 0};
+  long players = ENGINE_PLAYERS;
+  uint64_t seed = 1;
 
-  if (config_file == NULL)
+  int usage = argc < 5;
+  for (int argument = 2; argument < 5 && !usage; ++argument)
   {
-    printf("Error: Cannot open file: %s\n", file_name);
-    return 2;
+    values[argument - 2] = strtol(argv[argument], &endptr, 10);
+    usage = *endptr != '\0' || values[argument - 2] <= 0;
   }
-
-  confirmation = checkMagicNumber(config_file, file_name);
-  if (confirmation != 0)
+  for (int argument = 5; argument < argc && !usage; argument += 2)
   {
-    fclose(config_file);
-    return confirmation;
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument], "--players") == 0)
+    {
+      players = strtol(value, &endptr, 10);
+      usage = players < 1 || players > STRESS_MAX_PLAYERS;
+    }
+    else if (strcmp(argv[argument], "--seed") == 0)
+    {
+      seed = strtoull(value, &endptr, 10);
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
+  }
+  int cards = (int) (values[0] <= STRESS_MAX_CARDS ? values[0] : STRESS_MAX_CARDS + 1);
+  int hand_size = (int) (values[1] <= STRESS_MAX_CARDS ? values[1] : STRESS_MAX_CARDS + 1);
+  int row_count = (int) (values[2] <= STRESS_MAX_CARDS ? values[2] : STRESS_MAX_CARDS + 1);
+  if (usage || cards > STRESS_MAX_CARDS || row_count > STRESS_MAX_CARDS || (long) hand_size * players > cards)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
   }
 
-  people = getNumberOfPlayer(config_file);
-
-  Card *current = NULL;
+  Random random = {seed};
+  uint16_t *deck = ACCOUNT_MALLOC(sizeof(uint16_t) * (size_t) cards);
+  char *colors = ACCOUNT_MALLOC((size_t) cards + 1);
+  int *row_of_card = ACCOUNT_MALLOC(sizeof(int) * ((size_t) cards + 1));
+  WideCardSet *hands = ACCOUNT_CALLOC((size_t) players, sizeof(WideCardSet));
+  StressRows *rows = ACCOUNT_CALLOC((size_t) players, sizeof(StressRows));
+  int result = 0;
+  if (deck == NULL || colors == NULL || row_of_card == NULL || hands == NULL || rows == NULL)
+  {
+    result = OUT_OF_MEMORY;
+  }
+  for (int player_index = 0; player_index < players && result == 0; ++player_index)
+  {
+    result = wideSetOpen(&hands[player_index], cards);
+    result = result != 0 ? result : stressRowsOpen(&rows[player_index], row_count, cards);
+  }
+  if (result != 0)
+  {
+    printf("Error: Out of memory\n");
+  }
 
-  while (feof(config_file) == 0 && cards <= (people * MAX_CARD_PER_PLAYER))
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  for (int card_index = 0; card_index < cards && result == 0; ++card_index)
   {
-    Card *new_card = malloc(sizeof(Card));
-    if (new_card == NULL)
+    int other = randomBelow(&random, card_index + 1);
+    if (other != card_index)
     {
-      printf("Error: Out of memory\n");
-      freeCardList(*total_cards);
-      fclose(config_file);
-      return OUT_OF_MEMORY;
+      deck[card_index] = deck[other];
     }
-
-    fscanf(config_file, "%d_%s", &new_card->number_, &new_card->color_);
-    new_card->next_ = NULL;
-
-    if (current == NULL)
+    deck[other] = (uint16_t) (card_index + 1);
+    colors[card_index + 1] = CARD_COLORS[randomBelow(&random, ENGINE_COLORS)];
+  }
+  for (long card_index = 0; card_index < hand_size * players && result == 0; ++card_index)
+  {
+    wideSetAdd(&hands[card_index / hand_size], deck[card_index]);
+  }
+  double deal_seconds = secondsSince(&started);
+
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  long rounds = 0;
+  long placed = 0;
+  long discarded = 0;
+  int first_hand = 0;
+  for (int cards_left = hand_size; cards_left > 0 && result == 0; cards_left -= 2, ++rounds)
+  {
+    for (int player_index = 0; player_index < players; ++player_index)
     {
-      *total_cards = new_card;
-      current = new_card;
+      WideCardSet *hand = &hands[(first_hand + player_index) % players];
+      int kept[2];
+      int kept_count = hand->count_ < 2 ? hand->count_ : 2;
+      for (int pick = 0; pick < kept_count; ++pick)
+      {
+        kept[pick] = wideSetSelect(hand, randomBelow(&random, hand->count_));
+        wideSetRemove(hand, kept[pick]);
+      }
+      for (int pick = 0; pick < kept_count; ++pick)
+      {
+        if (stressPlace(&rows[player_index], row_of_card, kept[pick], colors[kept[pick]], &random))
+        {
+          placed++;
+        }
+        else
+        {
+          discarded++;
+        }
+      }
     }
-    else
+    first_hand = (first_hand + 1) % (int) players;
+  }
+  double game_seconds = secondsSince(&started);
+
+  if (result == 0)
+  {
+    printf("deck: %d cards, %ld players, hands of %d cards, %d rows\n", cards, players, hand_size, row_count);
+    printf("deal: %ld cards in %.3f ms\n", hand_size * players, deal_seconds * 1e3);
+    printf("game: %ld rounds, %ld cards placed, %ld discarded in %.3f ms\n", rounds, placed, discarded,
+           game_seconds * 1e3);
+    for (int player_index = 0; player_index < players; ++player_index)
     {
-      current->next_ = new_card;
-      current = new_card;
+      printf("Player %d: %ld points\n", player_index + 1, stressScore(&rows[player_index]));
     }
-    cards++;
   }
-  game->amount_of_cards_ = cards;
-  game->amount_of_players_ = people;
-  game->file_name_ = malloc(sizeof(char) * (strlen(file_name) + 1));
-  if (game->file_name_ == NULL)
+  for (int player_index = 0; hands != NULL && rows != NULL && player_index < players; ++player_index)
   {
-    printf("Error: Out of memory\n");
-    fclose(config_file);
-    return OUT_OF_MEMORY;
+    wideSetClose(&hands[player_index]);
+    stressRowsClose(&rows[player_index]);
   }
-  strcpy(game->file_name_, file_name);
-  fclose(config_file);
-  return 0;
+  ACCOUNT_FREE(deck);
+  ACCOUNT_FREE(colors);
+  ACCOUNT_FREE(row_of_card);
+  ACCOUNT_FREE(hands);
+  ACCOUNT_FREE(rows);
+  return result;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Reads the amount of players from file
+/// Takes the newest task of the own queue of a tournament thread.
 ///
-/// @param config_file File pointer
+/// @param tournament running tournament
+/// @param queue_index index of the own queue
+/// @param task receives the task
 ///
-/// @return read successfully(number players) or not(-1)
+/// @return 1 if a task was taken, 0 if the queue is empty
 //
-int getNumberOfPlayer(FILE *config_file)
+int taskQueuePop(Tournament *tournament, int queue_index, TournamentTask *task)
 {
-  int input;
-  if (fscanf(config_file, "%d", &input) != 1)
+  TaskQueue *queue = &tournament->queues_[queue_index];
+  int found = 0;
+
+  pthread_mutex_lock(&queue->mutex_);
+  if (queue->head_ < queue->tail_)
   {
-    return -1;
+    *task = tournament->tasks_[--queue->tail_];
+    found = 1;
   }
-  return input;
+  pthread_mutex_unlock(&queue->mutex_);
+  return found;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Reads the magic number from file and compares it to the preset one.
+/// Steals the oldest half of the tasks of another queue for an empty queue. Every queue is a range of the task array,
+/// so the stolen tasks simply become the new range of the empty queue.
 ///
-/// @param config_file File pointer
-/// @param file_name string of the entered file name
+/// @param tournament running tournament
+/// @param queue_index index of the empty own queue
+/// @param victim_index index of the queue to steal from
 ///
-/// @return int correct magic number(0) or not(2 , 3)
+/// @return 1 if tasks were stolen, 0 if the other queue is empty
 //
-int checkMagicNumber(FILE *config_file, char *file_name)
+int taskQueueSteal(Tournament *tournament, int queue_index, int victim_index)
 {
-  char buffer[BUFFER_SIZE];
-  if (fgets(buffer, BUFFER_SIZE, config_file) == NULL)
+  TaskQueue *victim = &tournament->queues_[victim_index];
+  TaskQueue *queue = &tournament->queues_[queue_index];
+
+  pthread_mutex_lock(&victim->mutex_);
+  long head = victim->head_;
+  long stolen = (victim->tail_ - victim->head_ + 1) / 2;
+  victim->head_ += stolen;
+  pthread_mutex_unlock(&victim->mutex_);
+  if (stolen == 0)
   {
-    printf("Error while reading the File");
-    return 2;
+    return 0;
   }
 
-  if (strcmp(buffer, "ESP\n") != 0)
-  {
-    printf("Error: Invalid file: %s\n", file_name);
-    return 3;
-  }
-  return 0;
+  pthread_mutex_lock(&queue->mutex_);
+  queue->head_ = head;
+  queue->tail_ = head + stolen;
+  pthread_mutex_unlock(&queue->mutex_);
+  return 1;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function can free any linked list used in my program.
+/// Adds the result of one game to the statistics of a policy against another one. A win counts 1, a draw 0.5.
 ///
-/// @param head The pointer to the first card in my linked list.
+/// @param stats statistics of the policy against the other one
+/// @param margin score margin of the policy
 ///
 /// @return void
 //
-void freeCardList(Card *head)
+void tournamentResult(GameStats *stats, int margin)
 {
-  while (head != NULL)
-  {
-    Card *temp = head;
-    head = head->next_;
-    free(temp);
-  }
+  stats->games_++;
+  stats->win_sum_ += margin > 0 ? 1 : (margin < 0 ? 0 : 0.5);
+  stats->margin_sum_ += margin;
+  stats->margin_squares_ += (double) margin * margin;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This distributes card to all players. Each player gets 1 Card each Round.
+/// Thread of the tournament: plays the tasks of its own queue, newest first, and steals from the other queues once it
+/// runs dry. The tasks are never added after the start, so a thread stops when every queue is empty.
 ///
-/// @param players array of struct Players
-/// @param totalCards linked list of all the cards parsed from config file
-/// @param game struct Game(holds all important values for the game)
+/// @param argument TournamentWorker of the thread
 ///
-/// @return success(0) or error(4)
+/// @return NULL
 //
-int cardDistribution(Player *players, Card *total_cards, Game *game)
+void *tournamentWorker(void *argument)
 {
-  Card *temp = total_cards;
-  int people_index = 0;
-  int rounds;
-  rounds = (game->amount_of_cards_ / game->amount_of_players_) * 2;
-  int card_inserted = 0;
-  while (temp != NULL && rounds > 0)
-  {
-    Card *new_card = malloc(sizeof(Card));
-    if (new_card == NULL)
-    {
-      printf("Error: Out of memory\n");
-      return OUT_OF_MEMORY;
-    }
-    new_card->next_ = NULL;
-    new_card->number_ = temp->number_;
-    new_card->color_ = temp->color_;
+  TournamentWorker *worker = argument;
+  Tournament *tournament = worker->tournament_;
+  TournamentTask task;
+  Position final_position;
 
-    if (card_inserted == rounds)
+  for (;;)
+  {
+    if (!taskQueuePop(tournament, worker->index_, &task))
     {
-      people_index = (people_index + 1) % game->amount_of_players_;
+      int stolen = 0;
+      for (int offset = 1; offset < tournament->queue_count_ && !stolen; ++offset)
+      {
+        stolen = taskQueueSteal(tournament, worker->index_, (worker->index_ + offset) % tournament->queue_count_);
+      }
+      if (!stolen)
+      {
+        break;
+      }
+      worker->steals_++;
+      continue;
     }
-
-    insertCardSorted(&(players[people_index].hand_cards_), new_card);
-    temp = temp->next_;
-    rounds--;
-    card_inserted++;
+    Policy seats[ENGINE_PLAYERS] = {tournament->policies_[task.first_], tournament->policies_[task.second_]};
+    Random random = {tournament->seed_ + (uint64_t) task.index_ * 0xD1B54A32D192ED03ULL};
+    int margin = playGame(&tournament->starts_[task.deck_], &tournament->decks_[task.deck_], seats,
+                          tournament->engine_, &random, &final_position, NULL, NULL, NULL);
+    tournamentResult(&worker->results_[task.first_][task.second_], margin);
+    tournamentResult(&worker->results_[task.second_][task.first_], -margin);
   }
-  return 0;
+  return NULL;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function inserts a struct Card into a already existing linked list. Furthermore the card gets inserted sorted.
+/// Lists the games of a round robin: every ordered pair of different policies plays <games> games on every deck.
+/// The index of every task is its position in the list, so it picks the same random sequence with any amount of
+/// threads.
 ///
-/// @param HEAD Pointer-Pointer to the first card in linked list.
-/// @param new_card pointer to a struct card that should be inserted into the linked list.
+/// @param tasks receives deck_count * policy_count * (policy_count - 1) * games tasks
+/// @param deck_count amount of decks
+/// @param policy_count amount of policies
+/// @param games games per pairing, deck and seat order
 ///
 /// @return void
 //
-void insertCardSorted(Card **HEAD, Card *new_card)
+void tournamentTasks(TournamentTask *tasks, int deck_count, int policy_count, long games)
 {
-  if (*HEAD == NULL || new_card->number_ <= (*HEAD)->number_)
-  {
-    new_card->next_ = *HEAD;
-    *HEAD = new_card;
-  }
-  else
+  long task_index = 0;
+
+  for (int deck_index = 0; deck_index < deck_count; ++deck_index)
   {
-    Card *temp = *HEAD;
-    while (temp->next_ != NULL && temp->next_->number_ < new_card->number_)
+    for (int first = 0; first < policy_count; ++first)
     {
-      temp = temp->next_;
+      for (int second = 0; second < policy_count; ++second)
+      {
+        for (long game = 0; game < games && first != second; ++game, ++task_index)
+        {
+          tasks[task_index] = (TournamentTask) {(uint32_t) task_index, (uint32_t) deck_index, (uint8_t) first,
+                                                (uint8_t) second};
+        }
+      }
     }
-    new_card->next_ = temp->next_;
-    temp->next_ = new_card;
   }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function calls all other functions while the game is running and processes the return values.
+/// Plays the tasks of a tournament on a pool of threads. The tasks start as equal ranges of a queue per thread. If
+/// no thread can be started, the calling thread plays all tasks.
 ///
-/// @param players array of struct Player
-/// @param game struct Game(holds all important values for the game)
+/// @param tournament tournament with its tasks, starts, decks, policies and engine; queues_ needs room for <threads>
+///                   queues
+/// @param workers <threads> workers; the results and steals of all of them are summed up in the first one
+/// @param threads amount of threads
+/// @param task_count amount of tasks
+/// @param policy_count amount of policies
 ///
-/// @return retrun values from previous functions
+/// @return the amount of threads that played
 //
-int runningGame(Player *players, Game *game)
+long tournamentPlay(Tournament *tournament, TournamentWorker *workers, long threads, long task_count,
+                    int policy_count)
 {
-  int confirmation = 0;
+  long started_threads = 0;
 
-  while (confirmation != 1)
+  tournament->queue_count_ = (int) threads;
+  for (long queue_index = 0; queue_index < threads; ++queue_index)
   {
-    for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
-    {
-      confirmation += checkIfCardsLeft(players[player_index].chosen_cards_, players[player_index].hand_cards_);
-    }
-    if (confirmation == 0)
+    tournament->queues_[queue_index].head_ = task_count * queue_index / threads;
+    tournament->queues_[queue_index].tail_ = task_count * (queue_index + 1) / threads;
+    pthread_mutex_init(&tournament->queues_[queue_index].mutex_, NULL);
+    memset(&workers[queue_index], 0, sizeof(TournamentWorker));
+    workers[queue_index].tournament_ = tournament;
+    workers[queue_index].index_ = (int) queue_index;
+  }
+  for (; started_threads < threads; ++started_threads)
+  {
+    if (pthread_create(&workers[started_threads].thread_, NULL, tournamentWorker, &workers[started_threads]) != 0)
     {
       break;
     }
-    confirmation = cardChoosingPhase(players, game);
-    if (confirmation == 1)
+  }
+  if (started_threads == 0)
+  {
+    tournament->queues_[0].tail_ = task_count;
+    tournament->queue_count_ = 1;
+    tournamentWorker(&workers[0]);
+  }
+  for (long thread_index = 0; thread_index < started_threads; ++thread_index)
+  {
+    pthread_join(workers[thread_index].thread_, NULL);
+  }
+  for (long worker_index = 1; worker_index < threads; ++worker_index)
+  {
+    workers[0].steals_ += workers[worker_index].steals_;
+    for (int row = 0; row < policy_count; ++row)
     {
-      return 0;
+      for (int column = 0; column < policy_count; ++column)
+      {
+        gameStatsMerge(&workers[0].results_[row][column], &workers[worker_index].results_[row][column]);
+      }
     }
-    else if (confirmation == 4)
+  }
+  for (long queue_index = 0; queue_index < threads; ++queue_index)
+  {
+    pthread_mutex_destroy(&tournament->queues_[queue_index].mutex_);
+  }
+  return started_threads > 0 ? started_threads : 1;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads the policies of a tournament: one policy name per line (see parsePolicy), empty lines and lines starting with
+/// '#' are skipped.
+///
+/// @param file_name name of the policy file
+/// @param policies receives the policies
+/// @param names receives the names of the policies
+/// @param count receives the amount of policies
+///
+/// @return success(0), 2 if the file cannot be opened or 3 for an unknown policy or more than
+///         TOURNAMENT_MAX_POLICIES policies
+//
+int tournamentLoadPolicies(const char *file_name, Policy *policies, char names[][TOURNAMENT_NAME_SIZE], int *count)
+{
+  char line[BUFFER_SIZE];
+  FILE *file = fopen(file_name, "r");
+
+  if (file == NULL)
+  {
+    printf("Error: Cannot open file: %s\n", file_name);
+    return 2;
+  }
+  *count = 0;
+  while (fgets(line, sizeof(line), file) != NULL)
+  {
+    size_t length = strlen(line);
+    while (length > 0 && isspace((unsigned char) line[length - 1]))
     {
-      return confirmation;
+      line[--length] = '\0';
     }
-    swapCardDeck(players, game);
-    confirmation = actionPhase(players, game);
-    if (confirmation == 1)
+    if (length == 0 || line[0] == '#')
     {
-      return 0;
+      continue;
     }
-    else if (confirmation == 4)
+    if (*count == TOURNAMENT_MAX_POLICIES || length >= TOURNAMENT_NAME_SIZE ||
+        parsePolicy(line, &policies[*count]) != 0)
     {
-      return confirmation;
+      printf("Error: Invalid file: %s\n", file_name);
+      fclose(file);
+      return 3;
     }
+    strcpy(names[(*count)++], line);
+  }
+  fclose(file);
+  if (*count < 2)
+  {
+    printf("Error: Invalid file: %s\n", file_name);
+    return 3;
   }
-  printPoints(players, game);
   return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function calls opens the config file, calculates points and print functions for the end points.
+/// Orders file names alphabetically for qsort.
 ///
-/// @param players array of struct Player
-/// @param game struct Game(holds all important values for the game)
+/// @param first pointer to the first file name
+/// @param second pointer to the second file name
 ///
-/// @return void
+/// @return comparison result
 //
-void printPoints(Player *players, Game *game)
+int compareFileNames(const void *first, const void *second)
 {
-  int index_longest_row = 0;
-  int index_longest_row2 = 0;
-  int row_index;
-  int total_points;
-  int highest_score = 0;
-  int counter = 0;
-  Card *temp;
-  FILE *fp;
-
-  fp = openFile(game->file_name_);
-
-  printf("\n");
+  return strcmp(*(char *const *) first, *(char *const *) second);
+}
 
-  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Loads every config file of a directory (in alphabetical order, hidden files are skipped) like loadDeck.
+///
+/// @param directory_name name of the deck directory
+/// @param starts receives the start positions (free after use)
+/// @param decks receives the decks (free after use)
+/// @param count receives the amount of decks
+///
+/// @return success(0), 2 if the directory cannot be opened, 3 if it has no config file or the error code of loading a
+///         config file
+//
+int tournamentLoadDecks(const char *directory_name, Position **starts, Deck **decks, int *count)
+{
+  char **names = NULL;
+  int capacity = 0;
+  int result = 0;
+
+  *starts = NULL;
+  *decks = NULL;
+  *count = 0;
+  DIR *directory = opendir(directory_name);
+  if (directory == NULL)
   {
-    row_index = 0;
-    total_points = 0;
-    temp = players[player_index].row_[row_index];
-
-    while (row_index < MAX_ROW)
+    printf("Error: Cannot open file: %s\n", directory_name);
+    return 2;
+  }
+  for (struct dirent *entry = readdir(directory); entry != NULL && result == 0; entry = readdir(directory))
+  {
+    char path[2 * BUFFER_SIZE];
+    struct stat status;
+    int length = snprintf(path, sizeof(path), "%s/%s", directory_name, entry->d_name);
+    if (entry->d_name[0] == '.' || length >= (int) sizeof(path) || stat(path, &status) != 0 ||
+        !S_ISREG(status.st_mode))
     {
-      if (temp != NULL)
+      continue;
+    }
+    if (*count == capacity)
+    {
+      capacity = capacity == 0 ? 64 : 2 * capacity;
+      char **grown = ACCOUNT_REALLOC(names, sizeof(char *) * (size_t) capacity);
+      if (grown == NULL)
       {
-        counter = 0;
-        total_points = calculatePoints(&counter, temp, total_points);
-
-        if (counter > index_longest_row2)
-        {
-          index_longest_row = row_index;
-          index_longest_row2 = counter;
-        }
+        result = OUT_OF_MEMORY;
+        break;
       }
-      row_index++;
-      temp = players[player_index].row_[row_index];
+      names = grown;
     }
-
-    updatePlayerPoints(players, player_index, index_longest_row, total_points, &highest_score);
+    names[*count] = ACCOUNT_MALLOC(strlen(path) + 1);
+    if (names[*count] == NULL)
+    {
+      result = OUT_OF_MEMORY;
+      break;
+    }
+    strcpy(names[(*count)++], path);
   }
+  closedir(directory);
 
-  printResults(players, game, highest_score, fp);
-
-  if (fp == NULL)
+  if (result == 0 && *count == 0)
   {
-    printf("Warning: Results not written to file!\n");
-    return;
+    printf("Error: Invalid file: %s\n", directory_name);
+    result = 3;
   }
-  fclose(fp);
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-///
-/// This function opens the file it receives.
-///
-/// @param file_name string of the entered file name
-///
-/// @return File pointer
-//
-FILE *openFile(const char *file_name)
-{
-  FILE *fp = fopen(file_name, "r");
-  if (fp != NULL)
+  if (result == 0)
   {
-    fclose(fp);
-    fp = fopen(file_name, "a");
+    qsort(names, (size_t) *count, sizeof(char *), compareFileNames);
+    *starts = ACCOUNT_MALLOC(sizeof(Position) * (size_t) *count);
+    *decks = ACCOUNT_MALLOC(sizeof(Deck) * (size_t) *count);
+    result = *starts == NULL || *decks == NULL ? OUT_OF_MEMORY : 0;
   }
-  return fp;
+  if (result == OUT_OF_MEMORY)
+  {
+    printf("Error: Out of memory\n");
+  }
+  for (int deck_index = 0; deck_index < *count && result == 0; ++deck_index)
+  {
+    result = loadDeck(names[deck_index], &(*starts)[deck_index], &(*decks)[deck_index]);
+  }
+  for (int deck_index = 0; deck_index < *count; ++deck_index)
+  {
+    ACCOUNT_FREE(names[deck_index]);
+  }
+  ACCOUNT_FREE(names);
+  if (result != 0)
+  {
+    ACCOUNT_FREE(*starts);
+    ACCOUNT_FREE(*decks);
+    *starts = NULL;
+    *decks = NULL;
+  }
+  return result;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Checks which player has the highest score and sets the variable in each player struct.
+/// Prints the results of a tournament: a matrix with the score of every policy (row) against every other policy
+/// (column) and the half width of its 95 % confidence interval, followed by the score of every policy against all.
 ///
-/// @param players array of struct Player
-/// @param player_index Array-index of player
-/// @param index_longest_row Array-index of longest row for each player.
-/// @param total_points Total-Points of each player.
-/// @param highest_score Highest score in-game.
+/// @param results statistics of every policy against every other policy
+/// @param names names of the policies
+/// @param count amount of policies
 ///
 /// @return void
 //
-void updatePlayerPoints(Player *players, int player_index, int index_longest_row, int total_points, int *highest_score)
+void printTournament(GameStats results[][TOURNAMENT_MAX_POLICIES], char names[][TOURNAMENT_NAME_SIZE], int count)
 {
-  players[player_index].player_points_ = calculatePoints(&index_longest_row,
-                                                         players[player_index].row_[index_longest_row],
-                                                         total_points);
-
-  if (players[player_index].player_points_ > *highest_score)
+  printf("%-16s", "score");
+  for (int column = 0; column < count; ++column)
   {
-    *highest_score = players[player_index].player_points_;
+    printf(" %-15.15s", names[column]);
+  }
+  printf("   all\n");
+  for (int row = 0; row < count; ++row)
+  {
+    GameStats all;
+    memset(&all, 0, sizeof(GameStats));
+    printf("%-16.16s", names[row]);
+    for (int column = 0; column < count; ++column)
+    {
+      const GameStats *stats = &results[row][column];
+      if (row == column)
+      {
+        printf(" %-15s", "-");
+        continue;
+      }
+      printf(" %.3f +- %-6.3f", stats->win_sum_ / (double) stats->games_, gameStatsWinWidth(stats) / 2);
+      gameStatsMerge(&all, stats);
+    }
+    printf("   %.3f +- %.3f (mean margin %+.2f)\n", all.win_sum_ / (double) all.games_, gameStatsWinWidth(&all) / 2,
+           all.margin_sum_ / (double) all.games_);
   }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This fucntion calls the print function and write to file function.
+/// Plays a round robin tournament: "./a3 --tournament <policy file> <deck directory> [--games <n>] [--threads <n>]
+/// [--seed <n>]". Every pair of policies plays <n> games (default 10) on every deck in both seat orders. Every game
+/// is a task with its own random sequence; the tasks start as equal ranges of a queue per thread and threads that run
+/// out steal half of the remaining tasks of another queue, so cheap and expensive policies keep all threads busy.
+/// The results do not depend on the amount of threads.
 ///
-/// @param players array of struct Player
-/// @param highest_score Highest score in-game.
-/// @param game struct Game(holds all important values for the game)
-/// @param fp File-Pointer
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
 ///
-/// @return void
+/// @return 0 on success, 1 on wrong usage or the error code of loading the policies or decks
 //
-void printResults(Player *players, Game *game, int highest_score, FILE *fp)
+int runTournamentTool(int argc, char *argv[], const char *tool_usage)
 {
-  for (int player_index = 1; player_index < game->amount_of_players_; ++player_index)
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  long games = 10;
+  Tournament tournament;
+  char *endptr = "";
+
+  memset(&tournament, 0, sizeof(Tournament));
+  tournament.seed_ = 1;
+  int usage = argc < 4;
+  for (int argument = 4; argument < argc && !usage; argument += 2)
   {
-    if (players[player_index].player_points_ == players[player_index - 1].player_points_)
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
     {
-      printPlayerPoints(player_index, players[player_index - 1].player_points_);
-      printPlayerPoints(player_index + 1, players[player_index].player_points_);
-      writePlayerPointsToFile(fp, player_index, players[player_index - 1].player_points_);
-      writePlayerPointsToFile(fp, player_index + 1, players[player_index].player_points_);
-      break;
+      usage = 1;
     }
-    else if (players[player_index].player_points_ > players[player_index - 1].player_points_)
+    else if (strcmp(argv[argument], "--games") == 0)
     {
-      printPlayerPoints(player_index + 1, players[player_index].player_points_);
-      writePlayerPointsToFile(fp, player_index + 1, players[player_index].player_points_);
-      printPlayerPoints(player_index, players[player_index - 1].player_points_);
-      writePlayerPointsToFile(fp, player_index, players[player_index - 1].player_points_);
+      games = strtol(value, &endptr, 10);
+      usage = games <= 0;
+    }
+    else if (strcmp(argv[argument], "--threads") == 0)
+    {
+      threads = strtol(value, &endptr, 10);
+      usage = threads <= 0 || threads > TOURNAMENT_MAX_THREADS;
+    }
+    else if (strcmp(argv[argument], "--seed") == 0)
+    {
+      tournament.seed_ = strtoull(value, &endptr, 10);
     }
     else
     {
-      printPlayerPoints(player_index, players[player_index - 1].player_points_);
-      writePlayerPointsToFile(fp, player_index, players[player_index - 1].player_points_);
-      printPlayerPoints(player_index + 1, players[player_index].player_points_);
-      writePlayerPointsToFile(fp, player_index + 1, players[player_index].player_points_);
+      usage = 1;
     }
+    usage = usage || *endptr != '\0';
+  }
+  if (usage)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  threads = threads < TOURNAMENT_MAX_THREADS ? threads : TOURNAMENT_MAX_THREADS;
+
+  Policy policies[TOURNAMENT_MAX_POLICIES];
+  char names[TOURNAMENT_MAX_POLICIES][TOURNAMENT_NAME_SIZE];
+  int policy_count;
+  Position *starts;
+  Deck *decks;
+  int deck_count;
+  int result = tournamentLoadPolicies(argv[2], policies, names, &policy_count);
+  if (result != 0)
+  {
+    return result;
+  }
+  result = tournamentLoadDecks(argv[3], &starts, &decks, &deck_count);
+  if (result != 0)
+  {
+    return result;
   }
 
-  printf("\n\n");
-
-  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  long task_count = (long) deck_count * policy_count * (policy_count - 1) * games;
+  TournamentTask *tasks = task_count <= UINT32_MAX ? ACCOUNT_MALLOC(sizeof(TournamentTask) * (size_t) task_count) :
+                                                     NULL;
+  TournamentWorker *workers = ACCOUNT_CALLOC((size_t) threads, sizeof(TournamentWorker));
+  TaskQueue *queues = ACCOUNT_MALLOC(sizeof(TaskQueue) * (size_t) threads);
+  if (tasks == NULL || workers == NULL || queues == NULL)
   {
-    if (players[player_index].player_points_ == highest_score)
-    {
-      printf("Congratulations! Player %d wins the game!\n", player_index + 1);
-      if(fp != NULL)
-      {
-        fprintf(fp, "\n\nCongratulations! Player %d wins the game!\n", player_index + 1);
-      }
-    }
+    printf("Error: Out of memory\n");
+    ACCOUNT_FREE(tasks);
+    ACCOUNT_FREE(workers);
+    ACCOUNT_FREE(queues);
+    ACCOUNT_FREE(starts);
+    ACCOUNT_FREE(decks);
+    return OUT_OF_MEMORY;
   }
+  tournamentTasks(tasks, deck_count, policy_count, games);
+
+  Engine engine;
+  engineOpen(&engine);
+  tournament.tasks_ = tasks;
+  tournament.queues_ = queues;
+  tournament.starts_ = starts;
+  tournament.decks_ = decks;
+  tournament.policies_ = policies;
+  tournament.engine_ = &engine;
+
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  long started_threads = tournamentPlay(&tournament, workers, threads, task_count, policy_count);
+  double seconds = secondsSince(&started);
+  printf("%ld games: %d policies, %d decks, %ld games per pairing, deck and seat order (%ld threads, %.2f s, %ld "
+         "steals)\n",
+         task_count, policy_count, deck_count, games, started_threads, seconds, workers[0].steals_);
+  printTournament(workers[0].results_, names, policy_count);
+
+  engineClose(&engine);
+  ACCOUNT_FREE(tasks);
+  ACCOUNT_FREE(workers);
+  ACCOUNT_FREE(queues);
+  ACCOUNT_FREE(starts);
+  ACCOUNT_FREE(decks);
+  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function prints the points of the passed player.
+/// Deals a range of random decks for the tuner (see deckGenerate).
 ///
-/// @param player_index Array-index of player.
-/// @param points Points of player
+/// @param generator deck generator of the tuning run
+/// @param first_index index of the first deck
+/// @param count amount of decks
+/// @param starts receives the start positions
+/// @param decks receives the decks
 ///
 /// @return void
 //
-void printPlayerPoints(int player_index, int points)
+void tuneDecks(const DeckGenerator *generator, uint64_t first_index, int count, Position *starts, Deck *decks)
 {
-  printf("\nPlayer %d: %d points", player_index, points);
+  GeneratedDeck generated;
+
+  for (int deck_index = 0; deck_index < count; ++deck_index)
+  {
+    deckGenerate(generator, first_index + (uint64_t) deck_index, &generated);
+    deckStart(&generated, &starts[deck_index], &decks[deck_index]);
+  }
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function writes the points of the passed player to the file.
+/// Prints the weights of a weighted policy as a policy name that parsePolicy reads back.
 ///
-/// @param fp File-Pointer
-/// @param player_index Array-index of player
-/// @param points Points of player
+/// @param label text in front of the name
+/// @param weights weights of the policy (POLICY_WEIGHTS)
 ///
 /// @return void
 //
-void writePlayerPointsToFile(FILE *fp, int player_index, int points)
+void printWeights(const char *label, const double *weights)
 {
-  if (fp != NULL)
+  printf("%sweighted", label);
+  for (int weight = 0; weight < POLICY_WEIGHTS; ++weight)
   {
-    fprintf(fp, "\nPlayer %d: %d points", player_index, points);
+    printf("%c%.2f", weight == 0 ? ':' : ',', weights[weight]);
   }
+  printf("\n");
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This Function calculates the points based on the color.
+/// Tunes the weights of the weighted policy by self-play: "./a3 --tune [--iterations <n>] [--decks <n>]
+/// [--start <policy>] [--opponent <policy>] [--threads <n>] [--seed <n>]". Every iteration of the simultaneous
+/// perturbation stochastic approximation (SPSA) moves all weights at once by a random sign times TUNE_SCALES, lets
+/// the plus and the minus side play each other on <n> new random decks (default 512) in both seat orders and steps
+/// the weights towards the side that scored better. Both sides play the same decks, so the deal luck cancels out.
+/// The step and the perturbation shrink over the <n> iterations (default 500) with the usual exponents 0.602 and
+/// 0.101. At the end the start weights (default POLICY_DEFAULT_WEIGHTS) and the tuned weights play each other and the
+/// opponent (default greedy) on TUNE_FINAL_DECKS times as many fresh decks. The games of every batch run on the
+/// threads of a tournament, and the result does not depend on their amount.
 ///
-/// @param counter how many elements are in a row
-/// @param temp current card from row
-/// @param total_points Players total points
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
 ///
-/// @return total_points
+/// @return 0 on success, 1 on wrong usage or OUT_OF_MEMORY
 //
-int calculatePoints(int *counter, Card *temp, int total_points)
+int runTuneTool(int argc, char *argv[], const char *tool_usage)
 {
-  while (temp != NULL)
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  long iterations = 500;
+  long deck_count = 512;
+  uint64_t seed = 1;
+  Policy policies[3];
+  char names[3][TOURNAMENT_NAME_SIZE] = {"start", "tuned", "greedy"};
+  char *endptr = "";
+
+  parsePolicy("weighted", &policies[0]);
+  parsePolicy("greedy", &policies[2]);
+  int usage = 0;
+  for (int argument = 2; argument < argc && !usage; argument += 2)
   {
-    switch (temp->color_)
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
     {
-      case 'b':
-        total_points += BLUE;
-        break;
-      case 'w':
-        total_points += WHITE;
-        break;
-      case 'g':
-        total_points += GREEN;
-        break;
-      case 'r':
-        total_points += RED;
-        break;
+      usage = 1;
     }
-    temp = temp->next_;
-    *counter += 1;
+    else if (strcmp(argv[argument], "--iterations") == 0)
+    {
+      iterations = strtol(value, &endptr, 10);
+      usage = iterations <= 0;
+    }
+    else if (strcmp(argv[argument], "--decks") == 0)
+    {
+      deck_count = strtol(value, &endptr, 10);
+      usage = deck_count <= 0 || deck_count > INT32_MAX / 6 / TUNE_FINAL_DECKS;
+    }
+    else if (strcmp(argv[argument], "--start") == 0)
+    {
+      usage = parsePolicy(value, &policies[0]) != 0 || policies[0].type_ != POLICY_WEIGHTED;
+    }
+    else if (strcmp(argv[argument], "--opponent") == 0)
+    {
+      usage = parsePolicy(value, &policies[2]) != 0;
+      snprintf(names[2], TOURNAMENT_NAME_SIZE, "%s", value);
+    }
+    else if (strcmp(argv[argument], "--threads") == 0)
+    {
+      threads = strtol(value, &endptr, 10);
+      usage = threads <= 0 || threads > TOURNAMENT_MAX_THREADS;
+    }
+    else if (strcmp(argv[argument], "--seed") == 0)
+    {
+      seed = strtoull(value, &endptr, 10);
+    }
+    else
+    {
+      usage = 1;
+    }
+    usage = usage || *endptr != '\0';
   }
-  return total_points;
-}
-
-//---------------------------------------------------------------------------------------------------------------------
-///
-/// This Function is the start and end of card choosing phase.
-///
-/// @param game struct Game(holds all important values for the game)
-/// @param players array of struct Player
-///
-/// @return success(0) or not(1)
-//
-int cardChoosingPhase(Player *players, Game *game)
-{
-  int numbers_entered = 0;
-  int error = 0;
-  char *input_buffer = NULL;
-  int result = ERROR;
-  Card *tmp;
-
-  printf("\n-------------------\n"
-         "CARD CHOOSING PHASE\n"
-         "-------------------\n");
-
-  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  if (usage)
+  {
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
+  }
+  threads = threads < TOURNAMENT_MAX_THREADS ? threads : TOURNAMENT_MAX_THREADS;
+
+  int final_count = (int) deck_count * TUNE_FINAL_DECKS;
+  TournamentTask *tasks = ACCOUNT_MALLOC(sizeof(TournamentTask) * (size_t) final_count * 6);
+  Position *starts = ACCOUNT_MALLOC(sizeof(Position) * (size_t) final_count);
+  Deck *decks = ACCOUNT_MALLOC(sizeof(Deck) * (size_t) final_count);
+  TournamentWorker *workers = ACCOUNT_MALLOC(sizeof(TournamentWorker) * (size_t) threads);
+  TaskQueue *queues = ACCOUNT_MALLOC(sizeof(TaskQueue) * (size_t) threads);
+  if (tasks == NULL || starts == NULL || decks == NULL || workers == NULL || queues == NULL)
   {
-    printPlayerStatusInfo(&players[player_index]);
+    printf("Error: Out of memory\n");
+    ACCOUNT_FREE(tasks);
+    ACCOUNT_FREE(starts);
+    ACCOUNT_FREE(decks);
+    ACCOUNT_FREE(workers);
+    ACCOUNT_FREE(queues);
+    return OUT_OF_MEMORY;
+  }
 
-    while (numbers_entered < 2)
+  Engine engine;
+  engineOpen(&engine);
+  DeckGenerator generator;
+  deckGeneratorInit(&generator, seed, NULL);
+  Random random = {seed ^ 0x243F6A8885A308D3ULL};
+  Tournament tournament;
+  memset(&tournament, 0, sizeof(Tournament));
+  tournament.tasks_ = tasks;
+  tournament.queues_ = queues;
+  tournament.starts_ = starts;
+  tournament.decks_ = decks;
+  tournament.policies_ = policies;
+  tournament.engine_ = &engine;
+  double weights[POLICY_WEIGHTS];
+  double start_weights[POLICY_WEIGHTS];
+  memcpy(weights, policies[0].weights_, sizeof(weights));
+  memcpy(start_weights, policies[0].weights_, sizeof(start_weights));
+  policies[1] = policies[0];
+
+  struct timespec started;
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  printf("%ld iterations of %ld games (%ld threads)\n", iterations, 2 * deck_count, threads);
+  printf("iteration  score");
+  for (int weight = 0; weight < POLICY_WEIGHTS; ++weight)
+  {
+    printf(" %8s", POLICY_WEIGHT_NAMES[weight]);
+  }
+  printf("\n");
+  tournamentTasks(tasks, (int) deck_count, 2, 1);
+  for (long iteration = 0; iteration < iterations; ++iteration)
+  {
+    double step = TUNE_STEP / pow((double) iteration + 1 + (double) iterations / 10, 0.602);
+    double perturbation = TUNE_PERTURBATION / pow((double) iteration + 1, 0.101);
+    double signs[POLICY_WEIGHTS];
+    for (int weight = 0; weight < POLICY_WEIGHTS; ++weight)
     {
-      tmp = players[player_index].hand_cards_;
-      handleCardChoosingPrompt(numbers_entered, error, player_index);
-      if (handleUserInput(&input_buffer, &result, &error, player_index) == 1)
-      {
-        return 1;
-      }
-
-      while (tmp != NULL)
-      {
-        if (tmp->number_ == atoi(input_buffer))
-        {
-          handleCardSelection(&players[player_index], &tmp, &numbers_entered, &error);
-          break;
-        }
-        tmp = tmp->next_;
-      }
-
-      if (tmp == NULL)
+      signs[weight] = (randomNext(&random) & 1) ? 1.0 : -1.0;
+      policies[0].weights_[weight] = weights[weight] + perturbation * signs[weight] * TUNE_SCALES[weight];
+      policies[1].weights_[weight] = weights[weight] - perturbation * signs[weight] * TUNE_SCALES[weight];
+    }
+    tuneDecks(&generator, (uint64_t) iteration * (uint64_t) deck_count, (int) deck_count, starts, decks);
+    tournament.seed_ = randomNext(&random);
+    tournamentPlay(&tournament, workers, threads, 2 * deck_count, 2);
+    const GameStats *plus = &workers[0].results_[0][1];
+    double score = plus->win_sum_ / (double) plus->games_;
+    for (int weight = 0; weight < POLICY_WEIGHTS; ++weight)
+    {
+      weights[weight] += step * (score - 0.5) / (perturbation * signs[weight]) * TUNE_SCALES[weight];
+    }
+    if ((iteration + 1) % (iterations < 20 ? 1 : iterations / 20) == 0 || iteration + 1 == iterations)
+    {
+      printf("%9ld  %.3f", iteration + 1, score);
+      for (int weight = 0; weight < POLICY_WEIGHTS; ++weight)
       {
-        error = 1;
+        printf(" %8.2f", weights[weight]);
       }
+      printf("\n");
     }
-    numbers_entered = 0;
   }
 
-  free(input_buffer);
+  policies[0] = policies[1];
+  memcpy(policies[0].weights_, start_weights, sizeof(start_weights));
+  memcpy(policies[1].weights_, weights, sizeof(weights));
+  tuneDecks(&generator, (uint64_t) iterations * (uint64_t) deck_count, final_count, starts, decks);
+  tournament.seed_ = randomNext(&random);
+  tournamentTasks(tasks, final_count, 3, 1);
+  tournamentPlay(&tournament, workers, threads, 6L * final_count, 3);
+  printf("%.2f s\n", secondsSince(&started));
+  printWeights("start: ", policies[0].weights_);
+  printWeights("tuned: ", policies[1].weights_);
+  printf("%d games per pairing on fresh decks:\n", 2 * final_count);
+  printTournament(workers[0].results_, names, 3);
+
+  engineClose(&engine);
+  ACCOUNT_FREE(tasks);
+  ACCOUNT_FREE(starts);
+  ACCOUNT_FREE(decks);
+  ACCOUNT_FREE(workers);
+  ACCOUNT_FREE(queues);
   return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// Prints correct choosing prompt.
+/// Feeds one input line of a session into the state machine of its game. The latency of the command, rejected commands
+/// and a completed game are counted in the metrics of the thread; the command that completes a game also counts as the
+/// latency of printing the results.
 ///
-/// @param numbers_entered how many cards are already entered
-/// @param error is either true(1) or false(0)
-/// @param player_index Array-index of player
+/// @param session session of the game (output stream of the game flow already set)
+/// @param metrics metrics of the handling thread
+/// @param line input line without the line break
 ///
-/// @return success(0) or not(1)
+/// @return 1 if the game is over or the player quit, 0 otherwise
 //
-void handleCardChoosingPrompt(int numbers_entered, int error, int player_index)
+int sessionLine(Session *session, ServerMetrics *metrics, char *line)
 {
-  if (error == 1)
-  {
-    printf("Please enter the number of a card in your hand cards!\n"
-           "P%d > ", player_index + 1);
-  }
-  else
+  GameFlow *flow = &session->flow_;
+  int phase = flow->phase_ == PHASE_CHOOSING ? 0 : 1;
+  unsigned long rejected = flow->rejected_;
+  struct timespec started;
+
+  clock_gettime(CLOCK_MONOTONIC, &started);
+  int result = gameFlowStep(flow, line);
+  int bucket = instrumentBucket(secondsSince(&started) * 1e6);
+  metricsAdd(&metrics->latency_[phase][bucket], 1);
+  metricsAdd(&metrics->commands_[phase], 1);
+  metricsAdd(&metrics->rejected_[phase], flow->rejected_ - rejected);
+  if (flow->completed_)
   {
-    switch (numbers_entered)
-    {
-      case 0:
-        printf("Please choose a first card to keep:\n"
-               "P%d > ", player_index + 1);
-        break;
-      case 1:
-        printf("Please choose a second card to keep:\n"
-               "P%d > ", player_index + 1);
-        break;
-      default:
-        break;
-    }
+    metricsAdd(&metrics->results_latency_[bucket], 1);
+    metricsAdd(&metrics->games_completed_, 1);
   }
+  return result == 1 || flow->phase_ == PHASE_OVER;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This Function reads the user input and handles it accordingly
+/// Reads the available input of a session once and handles every complete line. A line that does not fit into the
+/// line buffer is handled as an empty line, input after the end of the game is dropped.
 ///
-/// @param game struct Game(holds all important values for the game)
-/// @param players array of struct Player
+/// @param session session of the game (output stream of the game flow already set)
+/// @param metrics metrics of the handling thread
 ///
-/// @return success(0) or not(1)
+/// @return 0 on success (the session may be finished), ERROR if the connection failed
 //
-int handleUserInput(char **input_buffer, int *result, int *error, int player_index)
+int sessionRead(Session *session, ServerMetrics *metrics)
 {
-  while (*result == ERROR)
+  char buffer[SESSION_READ_SIZE];
+  ssize_t count = read(session->fd_, buffer, sizeof(buffer));
+
+  if (count == 0)
+  {
+    session->input_closed_ = 1;
+    session->finished_ = 1;
+    return 0;
+  }
+  if (count < 0)
+  {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : ERROR;
+  }
+  for (ssize_t index = 0; index < count && !session->finished_; ++index)
   {
-    userInput(input_buffer);
-    *result = cardChosingPhaseCommands(*input_buffer);
-    if (*result == 1)
+    if (buffer[index] != '\n')
     {
-      free(*input_buffer);
-      return 1;
+      if (session->line_length_ < SESSION_LINE_SIZE - 1)
+      {
+        session->line_[session->line_length_++] = buffer[index];
+      }
+      else
+      {
+        session->overflow_ = 1;
+      }
+      continue;
     }
-    else if (*result == ERROR)
+    if (session->line_length_ > 0 && session->line_[session->line_length_ - 1] == '\r')
     {
-      printf("P%d > ", player_index + 1);
-      *error = 1;
+      session->line_length_--;
     }
+    session->line_[session->overflow_ ? 0 : session->line_length_] = '\0';
+    session->line_length_ = 0;
+    session->overflow_ = 0;
+    session->finished_ = (uint8_t) sessionLine(session, metrics, session->line_);
   }
-  *result = ERROR;
   return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This Function reads the user input and handles it accordingly
+/// Appends output to the output of a session that is not sent yet and releases the text. The text comes from
+/// open_memstream, so it is released with the free of the C library and never handed to the allocation accounting.
 ///
-/// @param player struct player
-/// @param tmp Pointer-Pointer for selected Card
-/// @param numbers_entered pointer to numbers entered: keeps track of how many card are entered already
-/// @param error pointer to int error: keep track if a error occured and changes value
+/// @param session session of the game
+/// @param text output allocated by open_memstream
+/// @param length length of the output
 ///
-/// @return success(0) or not(4)
+/// @return void
 //
-int handleCardSelection(Player *player, Card **tmp, int *numbers_entered, int *error)
+void sessionQueue(Session *session, char *text, size_t length)
 {
-  Card *new_card = malloc(sizeof(Card));
-  if (new_card == NULL)
+  if (length == 0)
   {
-    printf("Error: Out of memory\n");
-    return OUT_OF_MEMORY;
+    free(text);
+    return;
   }
-
-  copyCardData(*tmp, new_card);
-  insertCardSorted(&player->chosen_cards_, new_card);
-  removeCardFromHand(&player->hand_cards_, *tmp);
-  (*numbers_entered)++;
-  *error = 0;
-  return 0;
+  if (session->output_ == NULL)
+  {
+    session->output_length_ = 0;
+    session->output_sent_ = 0;
+  }
+  char *output = ACCOUNT_REALLOC(session->output_, session->output_length_ + length);
+  if (output == NULL)
+  {
+    session->finished_ = 1;
+  }
+  else
+  {
+    memcpy(output + session->output_length_, text, length);
+    session->output_ = output;
+    session->output_length_ += length;
+  }
+  free(text);
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This Function copies the data of one card and creates a new struct at the destination pointer.
+/// Sends as much of the output of a session as the socket accepts. Idle sessions do not keep an output buffer.
 ///
-/// @param source pointer of card to be copied
-/// @param destination pointer of destination
+/// @param session session of the game
 ///
-/// @return void
+/// @return 0 on success (output may be left), ERROR if the connection failed
 //
-void copyCardData(Card *source, Card *destination)
+int sessionSend(Session *session)
 {
-  if (source != NULL && destination != NULL)
+  while (session->output_ != NULL && session->output_sent_ < session->output_length_)
   {
-    destination->number_ = source->number_;
-    destination->color_ = source->color_;
-    destination->next_ = NULL;
+    ssize_t count = send(session->fd_, session->output_ + session->output_sent_,
+                         session->output_length_ - session->output_sent_, MSG_NOSIGNAL);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : ERROR;
+    }
+    session->output_sent_ += (size_t) count;
   }
+  ACCOUNT_FREE(session->output_);
+  session->output_ = NULL;
+  session->output_length_ = 0;
+  session->output_sent_ = 0;
+  return 0;
 }
 
 //---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function reads user input from standard input, dynamically allocates memory to store the input, and returns the
-/// size of the input string (excluding the null terminator).
-///
-/// @param user_input Pointer to a pointer that will store the user input string. Should be NULL or point to allocated
-///                   memory that can be reallocated if needed.
-///
-/// @return If successful, returns the size of the input string (excluding null terminator); otherwise, returns ERROR.
+/// Closes the connection of a session and frees it with its game.
 ///
-size_t userInput(char **user_input)
-{
-  size_t current_size = sizeof(*user_input) / 8;
-  size_t size = BUFFER_SIZE;
-  size_t i = 0;
-  int ch;
-
-  if (*user_input == NULL)
-  {
-    *user_input = (char *) malloc(size);
-    current_size = size;
-    if (*user_input == NULL)
-    {
-      return ERROR;
-    }
-  }
-  while ((ch = fgetc(stdin)) != EOF && ch != '\n')
-  {
-    if (i >= current_size - 1)
-    {
-      current_size *= 2;
-      char *temp = realloc(*user_input, current_size);
-      if (temp == NULL)
-      {
-        return ERROR;
-      }
-      *user_input = temp;
-    }
-    (*user_input)[i++] = (char) ch;
+/// @param server server the session belongs to
+/// @param metrics metrics of the closing thread
+/// @param session session to close
+///
+/// @return void
+//
+void sessionClose(Server *server, ServerMetrics *metrics, Session *session)
+{
+  metricsAdd(&metrics->games_closed_, 1);
+  pthread_mutex_lock(&server->mutex_);
+  if (session->previous_ != NULL)
+  {
+    session->previous_->next_ = session->next_;
   }
-  if (i == 0 && ch == EOF)
+  else
   {
-    return ERROR;
+    server->sessions_ = session->next_;
   }
-  char *temp = realloc(*user_input, i + 1);
-  if (temp == NULL)
+  if (session->next_ != NULL)
   {
-    return ERROR;
+    session->next_->previous_ = session->previous_;
   }
-  *user_input = temp;
-  (*user_input)[i] = '\0';
-  return i;
+  pthread_mutex_unlock(&server->mutex_);
+
+  close(session->fd_);
+  if (session->players_ != NULL)
+  {
+    freePlayers(session->players_, &session->game_);
+  }
+  ACCOUNT_FREE(session->flow_.journal_.entries_);
+  ACCOUNT_FREE(session->output_);
+  ACCOUNT_FREE(session);
 }
 
-//------------------------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function removes a specified card from a linked list of cards.
+/// Handles the events of a session: reads and handles input, sends output and waits for the next event. The session is
+/// registered with EPOLLONESHOT, so only one thread at a time handles it. A finished game only shuts down the sending
+/// side and waits for the client to close, since closing a socket with unread input would reset the connection before
+/// the client read the last output.
 ///
-/// @param HEAD Pointer to the head of the linked list.
-/// @param hand_card Pointer to the card to be removed.
+/// @param server server the session belongs to
+/// @param metrics metrics of the handling thread
+/// @param session session with the events (or a new session if events is 0)
+/// @param events epoll events of the session
 ///
 /// @return void
-///
-void removeCardFromHand(struct _Card_ **HEAD, Card *hand_card)
+//
+void sessionEvent(Server *server, ServerMetrics *metrics, Session *session, uint32_t events)
 {
-  Card *temp = *HEAD;
-  Card *previous = NULL;
-  while (temp != NULL)
+  char *text = NULL;
+  size_t length = 0;
+  int failed = 0;
+
+  FILE *out = open_memstream(&text, &length);
+  if (out == NULL)
   {
-    if (hand_card == temp)
-    {
-      if (previous == NULL)
-      {
-        *HEAD = temp->next_;
-        free(hand_card);
-        return;
-      }
-      else
-      {
-        previous->next_ = temp->next_;
-        free(hand_card);
-        return;
-      }
-    }
-    previous = temp;
-    temp = temp->next_;
+    sessionClose(server, metrics, session);
+    return;
+  }
+  if (events == 0)
+  {
+    PROBE(game_start, -1, 0, 0);
+    fprintf(out, "Welcome to SyntaxSakura (%d players are playing)!\n", session->game_.amount_of_players_);
+    gameFlowStart(&session->flow_, out, session->players_, &session->game_, 0);
+    session->flow_.served_ = 1;
+    session->flow_.engine_ = server->engine_;
+  }
+  else if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0)
+  {
+    session->flow_.out_ = out;
+    failed = sessionRead(session, metrics) != 0;
+  }
+  fclose(out);
+  sessionQueue(session, text, length);
+
+  failed = failed || (events & EPOLLERR) != 0 || sessionSend(session) != 0;
+  if (failed || (session->finished_ && session->output_ == NULL && session->input_closed_))
+  {
+    sessionClose(server, metrics, session);
+    return;
+  }
+  if (session->finished_ && session->output_ == NULL)
+  {
+    shutdown(session->fd_, SHUT_WR);
+  }
+
+  struct epoll_event event;
+  event.events = EPOLLONESHOT | (session->input_closed_ ? 0 : EPOLLIN) | (session->output_ != NULL ? EPOLLOUT : 0);
+  event.data.ptr = session;
+  int operation = events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+  if (epoll_ctl(server->epoll_fd_, operation, session->fd_, &event) != 0)
+  {
+    sessionClose(server, metrics, session);
   }
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function swaps the hand card decks among players after the card choosing phase is over.
+/// Accepts all pending connections and starts a game for every one of them. The cards of the config file are dealt to
+/// the players of every game like in a game on the terminal.
 ///
-/// @param players An array of Player structures representing the players in the game.
-/// @param game A pointer to the Game structure containing game-related information.
+/// @param server server with the listening socket
+/// @param metrics metrics of the accepting thread
 ///
 /// @return void
-///
-void swapCardDeck(Player *players, Game *game)
+//
+void serverAccept(Server *server, ServerMetrics *metrics)
 {
-  printf("\n"
-         "Card choosing phase is over - passing remaining hand cards to the next player!\n"
-         "\n");
-  Card *head_of_previous_deck;
-  Card *tmp;
-  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  int fd;
+
+  while ((fd = accept(server->listen_fd_, NULL, NULL)) >= 0)
   {
-    if (player_index == 0)
+    Session *session = ACCOUNT_CALLOC(1, sizeof(Session));
+    if (session == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) != 0)
     {
-      head_of_previous_deck = players[player_index].hand_cards_;
+      ACCOUNT_FREE(session);
+      close(fd);
       continue;
     }
-    tmp = players[player_index].hand_cards_;
-    players[player_index].hand_cards_ = head_of_previous_deck;
-    players[player_index - 1].hand_cards_ = tmp;
+    session->fd_ = fd;
+    session->game_ = *server->game_;
+    session->game_.file_name_ = NULL;
+    session->players_ = initializePlayers(&session->game_);
+    if (session->players_ == NULL || cardDistribution(session->players_, server->total_cards_, &session->game_) != 0)
+    {
+      if (session->players_ != NULL)
+      {
+        freePlayers(session->players_, &session->game_);
+      }
+      ACCOUNT_FREE(session);
+      close(fd);
+      continue;
+    }
+
+    pthread_mutex_lock(&server->mutex_);
+    session->next_ = server->sessions_;
+    if (server->sessions_ != NULL)
+    {
+      server->sessions_->previous_ = session;
+    }
+    server->sessions_ = session;
+    pthread_mutex_unlock(&server->mutex_);
+
+    metricsAdd(&metrics->games_started_, 1);
+    sessionEvent(server, metrics, session, 0);
   }
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function represents the action phase of the game, where players take turns performing actions with their chosen
-/// cards.
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// @param players An array of Player structures representing the players in the game.
-/// @param game A pointer to the Game structure containing game-related information.
+/// Thread of the server: waits for events of the listening socket and of the sessions until SIGINT or SIGTERM
+/// arrives.
 ///
-/// @return 0 if the action phase completes successfully, 1 if a player chooses to exit the game, or an error code
-/// otherwise.
+/// @param argument ServerWorker of the thread
 ///
-int actionPhase(Player *players, Game *game)
+/// @return NULL
+//
+void *serverWorker(void *argument)
 {
-  char *input_buffer = NULL;
-  int result;
-  printf("------------\n"
-         "ACTION PHASE\n"
-         "------------\n");
-  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
+  ServerWorker *worker = argument;
+  Server *server = worker->server_;
+  struct epoll_event events[SERVER_EVENTS];
+
+  for (;;)
   {
-    for (int card_index = 0; card_index < 2; ++card_index)
+    int count = epoll_wait(server->epoll_fd_, events, SERVER_EVENTS, -1);
+    if (count < 0 && errno != EINTR)
+    {
+      return NULL;
+    }
+    for (int event_index = 0; event_index < count; ++event_index)
     {
-      while (checkIfCardsLeft(players[player_index].chosen_cards_, NULL) == 1)
+      void *source = events[event_index].data.ptr;
+      if (source == &server->signal_fd_)
       {
-        printPlayerStatusInfo(&players[player_index]);
-        printf("What do you want to do?\n"
-               "P%d > ", player_index + 1);
-        do
-        {
-          userInput(&input_buffer);
-          result = actionPhaseCommands(input_buffer, &players[player_index]);
-          if (result == 1)
-          {
-            free(input_buffer);
-            return result;
-          }
-          else if (result == ERROR)
-          {
-            printf("P%d > ", player_index + 1);
-          }
-          else if (result == OUT_OF_MEMORY)
-          {
-            free(input_buffer);
-            return result;
-          }
-        } while (result == ERROR);
+        return NULL;
+      }
+      if (source == &server->listen_fd_)
+      {
+        serverAccept(server, &worker->metrics_);
+      }
+      else
+      {
+        sessionEvent(server, &worker->metrics_, source, events[event_index].events);
       }
     }
-    printPlayerStatusInfo(&players[player_index]);
   }
-  printf("\n"
-         "Action phase is over - starting next game round!\n");
-  free(input_buffer);
-  return 0;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function checks if there are any cards left in the specified card lists.
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// @param chosen_cards Pointer to the head of the chosen cards linked list.
-/// @param hand_cards Pointer to the head of the hand cards linked list.
+/// Opens the listening UNIX socket, the signal file descriptor for SIGINT and SIGTERM and the epoll instance that
+/// waits for both.
 ///
-/// @return 1 if there are cards left in either list, 0 otherwise.
+/// @param server server to open
+/// @param socket_path path of the socket
 ///
-int checkIfCardsLeft(struct _Card_ *chosen_cards, struct _Card_ *hand_cards)
+/// @return success(0) or ERROR
+//
+int serverOpen(Server *server, const char *socket_path)
 {
-  if (chosen_cards != NULL)
+  struct sockaddr_un address;
+  struct epoll_event event;
+  sigset_t signals;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(address.sun_path))
   {
-    return 1;
+    return ERROR;
   }
-  if (hand_cards != NULL)
+  strcpy(address.sun_path, socket_path);
+
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  server->signal_fd_ = signalfd(-1, &signals, 0);
+  server->listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  server->epoll_fd_ = epoll_create1(0);
+  if (server->signal_fd_ < 0 || server->listen_fd_ < 0 || server->epoll_fd_ < 0 ||
+      fcntl(server->listen_fd_, F_SETFL, O_NONBLOCK) != 0 ||
+      bind(server->listen_fd_, (struct sockaddr *) &address, sizeof(address)) != 0)
   {
-    return 1;
+    return ERROR;
+  }
+  if (listen(server->listen_fd_, SOMAXCONN) != 0)
+  {
+    unlink(socket_path);
+    return ERROR;
+  }
+
+  event.events = EPOLLIN;
+  event.data.ptr = &server->listen_fd_;
+  int result = epoll_ctl(server->epoll_fd_, EPOLL_CTL_ADD, server->listen_fd_, &event);
+  event.data.ptr = &server->signal_fd_;
+  if (result != 0 || epoll_ctl(server->epoll_fd_, EPOLL_CTL_ADD, server->signal_fd_, &event) != 0)
+  {
+    unlink(socket_path);
+    return ERROR;
   }
   return 0;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function prints the status information of a player, including their hand cards, chosen cards, and rows.
+/// Adds to a counter of the metrics of a server thread. Only the owning thread writes its counters, so a relaxed load
+/// and store is enough and the game threads never wait for each other or for a scrape.
 ///
-/// @param players Pointer to the Player structure representing the player.
+/// @param counter counter to update
+/// @param amount amount to add
 ///
 /// @return void
+//
+void metricsAdd(_Atomic unsigned long *counter, unsigned long amount)
+{
+  atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Sums up the metrics of all server threads and replaces the metrics file with a text exposition of them (one
+/// "<name>{<labels>} <value>" line per value). The file is written next to the target and renamed, so a reader never
+/// sees a half written file. Rates are taken over the time since the last scrape, the latency quantiles over the
+/// whole run (upper bounds of the buckets of instrumentBucket). The allocated bytes are left out if neither the
+/// accounting nor mallinfo2 (glibc 2.33 and later) can tell them. A failed write is reported once until a write
+/// succeeds again.
 ///
-void printPlayerStatusInfo(Player *players)
+/// @param exporter exporter with the threads and the state of the last scrape
+///
+/// @return 0 on success, 2 if the file cannot be written
+//
+int metricsScrape(MetricsExporter *exporter)
 {
-  printf("\n"
-         "Player %d:\n"
-         "  hand cards:", players->index + 1);
-  Card *current_card = players->hand_cards_;
-  while (current_card != NULL)
+  unsigned long started = 0;
+  unsigned long completed = 0;
+  unsigned long closed = 0;
+  unsigned long commands[METRICS_PHASES] = {0};
+  unsigned long rejected[METRICS_PHASES] = {0};
+  unsigned long latency[METRICS_PHASES][INSTRUMENT_BUCKETS] = {{0}};
+  unsigned long results_latency[INSTRUMENT_BUCKETS] = {0};
+  char path[2 * BUFFER_SIZE];
+
+  for (long worker_index = 0; worker_index < exporter->worker_count_; ++worker_index)
   {
-    printf(" %d_%c", current_card->number_, current_card->color_);
-    current_card = current_card->next_;
-  }
-  printf("\n");
-  printf("  chosen cards:");
-  current_card = players->chosen_cards_;
-  while (current_card != NULL)
-  {
-    printf(" %d_%c", current_card->number_, current_card->color_);
-    current_card = current_card->next_;
-  }
-  for (int row_index = 0; row_index < MAX_ROW; ++row_index)
-  {
-    current_card = players->row_[row_index];
-    if (current_card != NULL)
+    const ServerMetrics *metrics = &exporter->workers_[worker_index].metrics_;
+    closed += atomic_load_explicit(&metrics->games_closed_, memory_order_relaxed);
+    started += atomic_load_explicit(&metrics->games_started_, memory_order_relaxed);
+    completed += atomic_load_explicit(&metrics->games_completed_, memory_order_relaxed);
+    for (int phase = 0; phase < METRICS_PHASES; ++phase)
     {
-      printf("\n  row_%d:", row_index + 1);
+      commands[phase] += atomic_load_explicit(&metrics->commands_[phase], memory_order_relaxed);
+      rejected[phase] += atomic_load_explicit(&metrics->rejected_[phase], memory_order_relaxed);
+      for (int bucket = 0; bucket < INSTRUMENT_BUCKETS; ++bucket)
+      {
+        latency[phase][bucket] += atomic_load_explicit(&metrics->latency_[phase][bucket], memory_order_relaxed);
+      }
     }
-    while (current_card != NULL)
+    for (int bucket = 0; bucket < INSTRUMENT_BUCKETS; ++bucket)
     {
-      printf(" %d_%c", current_card->number_, current_card->color_);
-      current_card = current_card->next_;
+      results_latency[bucket] += atomic_load_explicit(&metrics->results_latency_[bucket], memory_order_relaxed);
     }
   }
-  printf("\n\n");
-}
-
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function processes the user command during the action phase and performs the corresponding action.
-///
-/// @param string The user input string containing the command.
-/// @param player Pointer to the Player structure representing the current player.
-///
-/// @return 0 on successful command execution, ERROR on invalid command, or an error code for other cases.
-///
-int actionPhaseCommands(char *string, Player *player)
-{
-  char *token = strtok(string, " ");
-
-  if (token == NULL)
+  long allocated = -1;
+  if (accounting.enabled_)
   {
-    printf("Please enter a valid command!\n");
-    return ERROR;
+    allocated = atomic_load_explicit(&accounting.live_bytes_, memory_order_relaxed);
+  }
+#ifdef A3_MALLINFO2
+  else
+  {
+    struct mallinfo2 info = mallinfo2();
+    allocated = (long) (info.uordblks + info.hblkhd);
   }
+#endif
+  double seconds = secondsSince(&exporter->last_scrape_);
+  clock_gettime(CLOCK_MONOTONIC, &exporter->last_scrape_);
+  seconds = seconds > 0 ? seconds : 1;
 
-  if (stringCompareCaseInsensitive(token, "help") == 0)
+  FILE *out = NULL;
+  if (snprintf(path, sizeof(path), "%s.tmp", exporter->file_name_) < (int) sizeof(path))
   {
-    return handleHelpCommand();
+    out = fopen(path, "w");
   }
-  else if (stringCompareCaseInsensitive(token, "place") == 0)
+  if (out == NULL)
   {
-    return handlePlaceCommand(player);
+    return metricsFailed(exporter);
   }
-  else if (stringCompareCaseInsensitive(token, "discard") == 0)
+  fprintf(out, "# TYPE a3_games_active gauge\na3_games_active %lu\n", started - closed);
+  fprintf(out, "# TYPE a3_games_started_total counter\na3_games_started_total %lu\n", started);
+  fprintf(out, "# TYPE a3_games_completed_total counter\na3_games_completed_total %lu\n", completed);
+  fprintf(out, "# TYPE a3_games_completed_per_second gauge\na3_games_completed_per_second %.3f\n",
+          (double) (completed - exporter->last_completed_) / seconds);
+  fprintf(out, "# TYPE a3_commands_total counter\n");
+  for (int phase = 0; phase < METRICS_PHASES; ++phase)
   {
-    return handleDiscardCommand(player);
+    fprintf(out, "a3_commands_total{phase=\"%s\"} %lu\n", METRICS_PHASE_NAMES[phase], commands[phase]);
   }
-  else if (stringCompareCaseInsensitive(token, "quit") == 0)
+  fprintf(out, "# TYPE a3_commands_rejected_total counter\n");
+  for (int phase = 0; phase < METRICS_PHASES; ++phase)
   {
-    return handleQuitCommand();
+    fprintf(out, "a3_commands_rejected_total{phase=\"%s\"} %lu\n", METRICS_PHASE_NAMES[phase], rejected[phase]);
   }
-  else
+  fprintf(out, "# TYPE a3_commands_rejected_per_second gauge\n");
+  for (int phase = 0; phase < METRICS_PHASES; ++phase)
   {
-    printf("Please enter a valid command!\n");
-    return ERROR;
+    fprintf(out, "a3_commands_rejected_per_second{phase=\"%s\"} %.3f\n", METRICS_PHASE_NAMES[phase],
+            (double) (rejected[phase] - exporter->last_rejected_[phase]) / seconds);
+    exporter->last_rejected_[phase] = rejected[phase];
+  }
+  fprintf(out, "# TYPE a3_command_latency_microseconds summary\n");
+  for (int phase = 0; phase < METRICS_PHASES; ++phase)
+  {
+    for (int quantile = 0; quantile < 3 && commands[phase] != 0; ++quantile)
+    {
+      fprintf(out, "a3_command_latency_microseconds{phase=\"%s\",quantile=\"%g\"} %ld\n",
+              METRICS_PHASE_NAMES[phase], METRICS_QUANTILES[quantile],
+              instrumentQuantile(latency[phase], METRICS_QUANTILES[quantile]));
+    }
+    fprintf(out, "a3_command_latency_microseconds_count{phase=\"%s\"} %lu\n", METRICS_PHASE_NAMES[phase],
+            commands[phase]);
+  }
+  fprintf(out, "# TYPE a3_results_latency_microseconds summary\n");
+  for (int quantile = 0; quantile < 3 && completed != 0; ++quantile)
+  {
+    fprintf(out, "a3_results_latency_microseconds{quantile=\"%g\"} %ld\n", METRICS_QUANTILES[quantile],
+            instrumentQuantile(results_latency, METRICS_QUANTILES[quantile]));
+  }
+  fprintf(out, "a3_results_latency_microseconds_count %lu\n", completed);
+  if (allocated >= 0)
+  {
+    fprintf(out, "# TYPE a3_allocated_bytes gauge\na3_allocated_bytes %ld\n", allocated);
+  }
+  exporter->last_completed_ = completed;
+  if (fclose(out) != 0 || rename(path, exporter->file_name_) != 0)
+  {
+    unlink(path);
+    return metricsFailed(exporter);
   }
+  exporter->failed_ = 0;
+  return 0;
 }
 
-int handleHelpCommand(void)
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reports that the metrics file cannot be written, once per run of failed scrapes, so a full disk does not flood the
+/// output of the server every METRICS_INTERVAL_MILLISECONDS.
+///
+/// @param exporter exporter whose scrape failed
+///
+/// @return 2
+//
+int metricsFailed(MetricsExporter *exporter)
 {
-  char *token = strtok(NULL, "");
-
-  if (token != NULL)
+  if (!exporter->failed_)
   {
-    printf("Please enter the correct number of parameters!\n");
-    return ERROR;
+    printf("Error: Cannot write file: %s\n", exporter->file_name_);
+    fflush(stdout);
+    exporter->failed_ = 1;
   }
-  else
+  return 2;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Thread of the metrics exporter: scrapes the metrics every METRICS_INTERVAL_MILLISECONDS and once more when the
+/// server stops.
+///
+/// @param argument MetricsExporter
+///
+/// @return NULL
+//
+void *metricsWorker(void *argument)
+{
+  MetricsExporter *exporter = argument;
+  struct timespec deadline;
+
+  pthread_mutex_lock(&exporter->mutex_);
+  while (!exporter->stop_)
   {
-    printf("\nAvailable commands:\n"
-           "\n"
-           "- help\n"
-           "  Display this help message.\n"
-           "\n"
-           "- place <row number> <card number>\n"
-           "  Append a card to the chosen row or if the chosen row does not exist create it.\n"
-           "\n"
-           "- discard <card number>\n"
-           "  Discard a card from the chosen cards.\n"
-           "\n"
-           "- quit\n"
-           "  Terminate the program.\n"
-           "\n");
-    return 0;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += METRICS_INTERVAL_MILLISECONDS / 1000;
+    deadline.tv_nsec += METRICS_INTERVAL_MILLISECONDS % 1000 * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000;
+    }
+    int waited = 0;
+    while (!exporter->stop_ && waited == 0)
+    {
+      waited = pthread_cond_timedwait(&exporter->wake_, &exporter->mutex_, &deadline);
+    }
+    pthread_mutex_unlock(&exporter->mutex_);
+    metricsScrape(exporter);
+    pthread_mutex_lock(&exporter->mutex_);
   }
+  pthread_mutex_unlock(&exporter->mutex_);
+  return NULL;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function handles the "help" command, providing information about available commands or
-/// displaying an error message
-/// if incorrect parameters are provided.
+/// Hosts games over a UNIX socket: "./a3 --serve <socket path> <config file> [--threads <n>] [--metrics <file>]".
+/// Every connection plays one game with the deck of the config file, driven by the same state machine as a game on the
+/// terminal. All sessions are multiplexed by one epoll instance on a few threads (default: one per processor), an idle
+/// session needs about 1.3 kilobytes. Every thread counts its own metrics; with --metrics an exporter thread writes
+/// their sum to the file every METRICS_INTERVAL_MILLISECONDS. The server stops on SIGINT or SIGTERM.
 ///
-/// @return 0 on successful help display, ERROR on incorrect parameters.
+/// @param argc number of program arguments passed
+/// @param argv arguments passed represented as string-array
+/// @param tool_usage usage of the tool (its entry in TOOLS)
 ///
-int handlePlaceCommand(Player *player)
+/// @return 0 on success, 1 on wrong usage, 2 if the socket cannot be opened or the metrics file cannot be written or
+///         the error code of loading the config file
+//
+int runServeTool(int argc, char *argv[], const char *tool_usage)
 {
-  int row, cardNumber;
-  char *row_token;
-  char *token;
-  char *endptr;
-  row_token = strtok(NULL, " ");
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  MetricsExporter exporter;
+  char *endptr = "";
 
-  if (row_token == NULL)
+  memset(&exporter, 0, sizeof(MetricsExporter));
+  int usage = argc < 4;
+  for (int argument = 4; argument < argc && !usage; argument += 2)
   {
-    printf("Please enter the correct number of parameters!\n");
-    return ERROR;
+    const char *value = argument + 1 < argc ? argv[argument + 1] : NULL;
+    if (value == NULL)
+    {
+      usage = 1;
+    }
+    else if (strcmp(argv[argument], "--threads") == 0)
+    {
+      threads = strtol(value, &endptr, 10);
+      usage = threads <= 0 || *endptr != '\0';
+    }
+    else if (strcmp(argv[argument], "--metrics") == 0)
+    {
+      exporter.file_name_ = value;
+    }
+    else
+    {
+      usage = 1;
+    }
   }
-  token = strtok(NULL, " ");
-  if (token == NULL)
+  if (usage)
   {
-    printf("Please enter the correct number of parameters!\n");
-    return ERROR;
+    printf("Usage: ./a3 %s\n", tool_usage);
+    return 1;
   }
 
-  row = (int) strtol(row_token, &endptr, 10);
-
-  if (*endptr != '\0')
+  Game *game;
+  Player *players;
+  Card *total_cards;
+  Engine engine;
+  Server server;
+  int result = loadGame(argv[3], &game, &players, &total_cards);
+  if (result != 0)
   {
-    printf("Please enter a valid row number!\n");
-    return ERROR;
+    return result;
   }
-  if (checkOutOfBound(row) == ERROR)
+  ServerWorker *workers = ACCOUNT_CALLOC((size_t) threads, sizeof(ServerWorker));
+  if (workers == NULL)
   {
-    return ERROR;
+    printf("Error: Out of memory\n");
+    freeMemory(game, players, total_cards);
+    return OUT_OF_MEMORY;
+  }
+  exporter.workers_ = workers;
+  exporter.worker_count_ = threads;
+  if (exporter.file_name_ != NULL && metricsScrape(&exporter) != 0)
+  {
+    ACCOUNT_FREE(workers);
+    freeMemory(game, players, total_cards);
+    return 2;
   }
 
-  cardNumber = (int) strtol(token, &endptr, 10);
-
-  if (*endptr != '\0')
+  memset(&server, 0, sizeof(Server));
+  server.epoll_fd_ = server.listen_fd_ = server.signal_fd_ = -1;
+  if (serverOpen(&server, argv[2]) != 0)
   {
-    printf("Please enter the number of a card in your hand cards!\n");
-    return ERROR;
+    printf("Error: Cannot open socket: %s\n", argv[2]);
+    result = 2;
   }
-
-  token = strtok(NULL, " ");
-  if (token != NULL)
+  else
   {
-    printf("Please enter the correct number of parameters!\n");
-    return ERROR;
+    engineOpen(&engine);
+    server.game_ = game;
+    server.total_cards_ = total_cards;
+    server.engine_ = &engine;
+    pthread_mutex_init(&server.mutex_, NULL);
+    printf("Serving games on %s\n", argv[2]);
+    fflush(stdout);
+
+    clock_gettime(CLOCK_MONOTONIC, &exporter.last_scrape_);
+    pthread_mutex_init(&exporter.mutex_, NULL);
+    pthread_cond_init(&exporter.wake_, NULL);
+    int exporting = exporter.file_name_ != NULL && pthread_create(&exporter.thread_, NULL, metricsWorker,
+                                                                  &exporter) == 0;
+
+    long started_threads = 0;
+    for (; started_threads < threads; ++started_threads)
+    {
+      workers[started_threads].server_ = &server;
+      if (pthread_create(&workers[started_threads].thread_, NULL, serverWorker, &workers[started_threads]) != 0)
+      {
+        break;
+      }
+    }
+    if (started_threads == 0)
+    {
+      workers[0].server_ = &server;
+      serverWorker(&workers[0]);
+    }
+    for (long thread_index = 0; thread_index < started_threads; ++thread_index)
+    {
+      pthread_join(workers[thread_index].thread_, NULL);
+    }
+
+    while (server.sessions_ != NULL)
+    {
+      sessionClose(&server, &workers[0].metrics_, server.sessions_);
+    }
+    if (exporting)
+    {
+      pthread_mutex_lock(&exporter.mutex_);
+      exporter.stop_ = 1;
+      pthread_cond_signal(&exporter.wake_);
+      pthread_mutex_unlock(&exporter.mutex_);
+      pthread_join(exporter.thread_, NULL);
+    }
+    pthread_cond_destroy(&exporter.wake_);
+    pthread_mutex_destroy(&exporter.mutex_);
+    pthread_mutex_destroy(&server.mutex_);
+    engineClose(&engine);
+    unlink(argv[2]);
   }
-  return placeCardInRow(row - 1, cardNumber, player);
+
+  close(server.epoll_fd_);
+  close(server.listen_fd_);
+  close(server.signal_fd_);
+  ACCOUNT_FREE(workers);
+  freeMemory(game, players, total_cards);
+  return result;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function handles the "discard" command, validating parameters and calling the discardCard function accordingly.
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// @param player Pointer to the Player structure representing the current player.
+/// Returns the player a snapshot of the game names as the player whose turn it is: in the card choosing phase the
+/// first player that still has to choose (players may choose at the same time), in the action phase the current
+/// player.
 ///
-/// @return The result of the discardCard function or an error code if parameters are incorrect.
+/// @param flow state machine of the game
 ///
-int handleDiscardCommand(Player *player)
+/// @return Array-index of the player
+//
+int gameFlowTurn(const GameFlow *flow)
 {
-  char *token;
-  char *number = strtok(NULL, " ");
-  token = strtok(NULL, " ");
-
-  if (token != NULL || number == NULL)
+  if (flow->phase_ == PHASE_CHOOSING)
   {
-    printf("Please enter the correct number of parameters!\n");
-    return ERROR;
+    for (int player_index = 0; player_index < flow->game_->amount_of_players_; ++player_index)
+    {
+      if (countCards(flow->players_[player_index].chosen_cards_) < 2)
+      {
+        return player_index;
+      }
+    }
   }
-
-  return discardCard(number, player);
+  return flow->player_index_;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function handles the "quit" command, validating parameters and signaling the program termination.
+/// Continues a game after its players were replaced by a snapshot: prints the status and the prompt of every player
+/// that has to choose or act now.
 ///
-/// @return 1 to signal program termination or ERROR if incorrect parameters are provided.
+/// @param flow state machine of the game (phase and turn already set)
 ///
-int handleQuitCommand(void)
+/// @return void
+//
+void gameFlowResume(GameFlow *flow)
 {
-  char *token = strtok(NULL, " ");
+  flow->error_ = 0;
+  journalStartTurn(&flow->journal_);
+  if (flow->phase_ == PHASE_ACTION)
+  {
+    gameFlowActionPrompt(flow);
+    return;
+  }
 
-  if (token != NULL)
+  int prompts = 0;
+  for (int player_index = flow->player_index_; player_index < flow->game_->amount_of_players_; ++player_index)
   {
-    printf("Please enter the correct number of parameters!\n");
-    return ERROR;
+    int numbers_entered = countCards(flow->players_[player_index].chosen_cards_);
+    if (numbers_entered < 2 && (prompts == 0 || flow->simultaneous_))
+    {
+      if (prompts == 0)
+      {
+        flow->player_index_ = player_index;
+        flow->numbers_entered_ = numbers_entered;
+      }
+      printPlayerStatusInfo(flow->out_, &flow->players_[player_index]);
+      handleCardChoosingPrompt(flow->out_, numbers_entered, 0, player_index);
+      prompts++;
+    }
+  }
+  if (prompts == 0)
+  {
+    gameFlowStartAction(flow);
   }
-  return 1;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function discards a card from the chosen cards of a player, based on the provided card number.
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// @param strtok The string token representing the card number to be discarded.
-/// @param player Pointer to the Player structure representing the current player.
+/// Handles the commands "save <file>" and "load <file>" in both phases. A loaded game replaces the whole game, the
+/// players continue where the snapshot was taken. Games of the server do not have the commands, since the files would
+/// be files of the server.
 ///
-/// @return 0 on successful card discard, ERROR if player or chosen cards are NULL,
-/// or an error message if the card number is not found in the chosen cards.
+/// @param flow state machine of the game
+/// @param player_index Array-index of the player who entered the line
+/// @param line input line without the line break (modified if it is one of the commands)
 ///
-int discardCard(char *strtok, Player *player)
+/// @return 1 if the line was one of the commands, 0 otherwise
+//
+int gameFlowSnapshotCommand(GameFlow *flow, int player_index, char *line)
 {
-  char *ptr;
-  if (player == NULL)
+  char *command = line + strspn(line, " ");
+  size_t length = strcspn(command, " ");
+  char word[5] = "";
+  Snapshot snapshot;
+  char *token_save;
+
+  if (length < sizeof(word))
   {
-    return ERROR;
+    memcpy(word, command, length);
+    word[length] = '\0';
   }
-  if (player->chosen_cards_ == NULL)
+  int save = stringCompareCaseInsensitive(word, "save") == 0;
+  if (flow->served_ || (!save && stringCompareCaseInsensitive(word, "load") != 0))
   {
-    return ERROR;
+    return 0;
+  }
+  char *file_name = strtok_r(command + length, " ", &token_save);
+  if (file_name == NULL || strtok_r(NULL, " ", &token_save) != NULL)
+  {
+    fprintf(flow->out_, "Please enter the correct number of parameters!\n"
+                        "P%d > ", player_index + 1);
+    return 1;
   }
 
-  Card *head = player->chosen_cards_;
-  long number = strtol(strtok, &ptr, 10);
-
-  while (head != NULL)
+  if (save)
   {
-    if (number == head->number_)
+    if (snapshotCapture(&snapshot, flow->players_, flow->game_, flow->phase_, gameFlowTurn(flow)) != 0 ||
+        snapshotWrite(&snapshot, file_name) != 0)
     {
-      removeCardFromHand(&player->chosen_cards_, head);
-      return 0;
+      fprintf(flow->out_, "Error: Cannot open file: %s\n", file_name);
     }
-    head = head->next_;
+    fprintf(flow->out_, "P%d > ", player_index + 1);
+    return 1;
   }
-  printf("Please enter the number of a card in your chosen cards!\n");
-  return ERROR;
-}
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function checks if the provided row number is within the valid range.
-///
-/// @param row The row number to be checked.
-///
-/// @return 0 if the row number is within the valid range, or ERROR with an error message if out of bounds.
-///
-int checkOutOfBound(int row)
-{
-  if (row < MIN_ROW || row > MAX_ROW)
+  int result = snapshotRead(&snapshot, file_name);
+  if (result == 0 && snapshot.players_ != flow->game_->amount_of_players_)
   {
-    printf("Please enter a valid row number!\n");
-    return ERROR;
+    result = 3;
   }
-  return 0;
+  if (result != 0)
+  {
+    fprintf(flow->out_, result == 2 ? "Error: Cannot open file: %s\n" : "Error: Invalid file: %s\n", file_name);
+    fprintf(flow->out_, "P%d > ", player_index + 1);
+    return 1;
+  }
+  if (snapshotApply(&snapshot, flow->players_, flow->game_) != 0)
+  {
+    printf("Error: Out of memory\n");
+    flow->result_ = OUT_OF_MEMORY;
+    flow->phase_ = PHASE_OVER;
+    return 1;
+  }
+  flow->phase_ = snapshot.phase_;
+  flow->player_index_ = snapshot.turn_;
+  gameFlowResume(flow);
+  return 1;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function places a card in the specified row of a player's board, based on the provided card number.
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// @param row The row number where the card should be placed.
-/// @param number The card number to be placed in the row.
-/// @param player Pointer to the Player structure representing the current player.
+/// Takes a snapshot of the whole game: every card still in the game with its color and its place (hand cards, chosen
+/// cards or a row of a player), the phase and the player whose turn it is. The snapshot has a fixed size of 120
+/// bytes, so positions can be forked, compared and stored with memcpy.
 ///
-/// @return 0 on successful card placement, ERROR if out of memory or invalid card number,
-/// or an error message if the card cannot be placed in the chosen row.
+/// @param snapshot receives the snapshot
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+/// @param phase phase the game is currently in
+/// @param turn Array-index of the player whose turn it is
 ///
-int placeCardInRow(int row, int number, Player *player)
+/// @return success(0) or ERROR for more than three players or a card number the engine does not support
+//
+int snapshotCapture(Snapshot *snapshot, Player *players, Game *game, Phase phase, int turn)
 {
-  Card *new_card = malloc(sizeof(Card));
-  if (new_card == NULL)
+  memset(snapshot, 0, sizeof(Snapshot));
+  if (game->amount_of_players_ > SNAPSHOT_MAX_PLAYERS)
   {
-    printf("Error: Out of memory\n");
-    return OUT_OF_MEMORY;
+    return ERROR;
   }
-  Card *head = player->chosen_cards_;
-  Card *temp;
-  Card *head_row = player->row_[row];
+  memcpy(snapshot->magic_, "A3SN", 4);
+  snapshot->version_ = SNAPSHOT_VERSION;
+  snapshot->players_ = (uint8_t) game->amount_of_players_;
+  snapshot->phase_ = (uint8_t) phase;
+  snapshot->turn_ = (uint8_t) turn;
 
-  while (head != NULL)
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
   {
-    if (head->number_ == number)
+    for (int place = 0; place < SNAPSHOT_PLACES; ++place)
     {
-      new_card->number_ = head->number_;
-      new_card->color_ = head->color_;
-      new_card->next_ = NULL;
-
-      if (player->row_[row] == NULL)
-      {
-        player->row_[row] = new_card;
-        removeCardFromHand(&player->chosen_cards_, head);
-        return 0;
-      }
-      else
+      Card *card = place == 0 ? players[player_index].hand_cards_ :
+                   place == 1 ? players[player_index].chosen_cards_ : players[player_index].row_[place - 2];
+      int code = player_index * SNAPSHOT_PLACES + place;
+      for (; card != NULL; card = card->next_)
       {
-        if (head->number_ < player->row_[row]->number_)
+        if (card->number_ <= 0 || card->number_ >= CARD_NUMBER_LIMIT)
         {
-          temp = player->row_[row];
-          player->row_[row] = new_card;
-          player->row_[row]->next_ = temp;
-          removeCardFromHand(&player->chosen_cards_, head);
-          return 0;
+          return ERROR;
         }
-        while (head_row->next_ != NULL)
+        int color = colorIndex(card->color_);
+        cardSetAdd(&snapshot->cards_, card->number_);
+        for (int bit = 0; bit < 2; ++bit)
         {
-          head_row = head_row->next_;
+          if (color & (1 << bit))
+          {
+            cardSetAdd(&snapshot->colors_[bit], card->number_);
+          }
         }
-        if (head->number_ > head_row->number_)
+        for (int bit = 0; bit < SNAPSHOT_PLACE_BITS; ++bit)
         {
-          head_row->next_ = new_card;
-          removeCardFromHand(&player->chosen_cards_, head);
-          return 0;
+          if (code & (1 << bit))
+          {
+            cardSetAdd(&snapshot->places_[bit], card->number_);
+          }
         }
       }
-      printf("This card cannot extend the chosen row!\n");
-      free(new_card);
-      return ERROR;
     }
-    head = head->next_;
   }
-  printf("Please enter the number of a card in your chosen cards!\n");
-  free(new_card);
-  return ERROR;
+  return 0;
 }
 
-//----------------------------------------------------------------------------------------------------------------------
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// This function processes the user command during the card choosing phase, validates parameters, and returns the
-/// card number to be chosen or signals program termination.
+/// Returns the place of a card of a snapshot: Array-index of the player * SNAPSHOT_PLACES + 0 for the hand cards,
+/// 1 for the chosen cards and 2 - 4 for the rows.
 ///
-/// @param string The user input string containing the command.
+/// @param snapshot snapshot of the game
+/// @param number card number (in the snapshot)
+///
+/// @return place of the card
+//
+int snapshotPlace(const Snapshot *snapshot, int number)
+{
+  int code = 0;
+  for (int bit = 0; bit < SNAPSHOT_PLACE_BITS; ++bit)
+  {
+    code |= cardSetContains(&snapshot->places_[bit], number) << bit;
+  }
+  return code;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Returns the color of a card of a snapshot.
 ///
-/// @return The card number to be chosen (if a valid card number is provided), 1 to signal program termination, or
-///         ERROR with an error message if parameters are incorrect.
+/// @param snapshot snapshot of the game
+/// @param number card number (in the snapshot)
 ///
-int cardChosingPhaseCommands(char *string)
+/// @return index of the color in CARD_COLORS
+//
+int snapshotColor(const Snapshot *snapshot, int number)
 {
-  char *token = strtok(string, " ");
+  return cardSetContains(&snapshot->colors_[0], number) | cardSetContains(&snapshot->colors_[1], number) << 1;
+}
 
-  if (token == NULL)
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Replaces the cards of all players by the cards of a snapshot. The sets are walked in ascending order, so every
+/// list is built sorted by appending.
+///
+/// @param snapshot snapshot with as many players as the game
+/// @param players array of struct Player
+/// @param game struct Game(holds all important values for the game)
+///
+/// @return success(0) or OUT_OF_MEMORY
+//
+int snapshotApply(const Snapshot *snapshot, Player *players, Game *game)
+{
+  Card **tails[SNAPSHOT_MAX_PLAYERS * SNAPSHOT_PLACES];
+
+  for (int player_index = 0; player_index < game->amount_of_players_; ++player_index)
   {
-    printf("Please enter the number of a card in your hand cards!\n");
-    return ERROR;
+    Player *player = &players[player_index];
+    freeCardList(player->hand_cards_);
+    freeCardList(player->chosen_cards_);
+    player->hand_cards_ = NULL;
+    player->chosen_cards_ = NULL;
+    tails[player_index * SNAPSHOT_PLACES] = &player->hand_cards_;
+    tails[player_index * SNAPSHOT_PLACES + 1] = &player->chosen_cards_;
+    for (int row_index = 0; row_index < MAX_ROW; ++row_index)
+    {
+      freeCardList(player->row_[row_index]);
+      player->row_[row_index] = NULL;
+      tails[player_index * SNAPSHOT_PLACES + 2 + row_index] = &player->row_[row_index];
+    }
   }
-  if (strcasecmp(token, "quit") == 0)
+
+  for (int number = cardSetNext(&snapshot->cards_, 0); number != 0; number = cardSetNext(&snapshot->cards_, number))
   {
-    token = strtok(NULL, " ");
-    if (token != NULL)
+    Card *card = ACCOUNT_MALLOC(sizeof(Card));
+    if (card == NULL)
     {
-      printf("Please enter the correct number of parameters!\n");
-      return ERROR;
+      return OUT_OF_MEMORY;
     }
-    return 1;
+    card->number_ = number;
+    card->color_ = CARD_COLORS[snapshotColor(snapshot, number)];
+    card->next_ = NULL;
+    int place = snapshotPlace(snapshot, number);
+    *tails[place] = card;
+    tails[place] = &card->next_;
   }
-  else
-  {
-    char *endptr;
-    long number = strtol(token, &endptr, 10);
+  return 0;
+}
 
-    if (*endptr != '\0')
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Converts a snapshot into the position and the deck the search works on, without any linked list.
+///
+/// @param snapshot snapshot of the game
+/// @param position receives the position (the first ENGINE_PLAYERS players)
+/// @param deck receives the deck lookup table
+///
+/// @return void
+//
+void snapshotToPosition(const Snapshot *snapshot, Position *position, Deck *deck)
+{
+  memset(position, 0, sizeof(Position));
+  memset(deck, 0, sizeof(Deck));
+
+  for (int number = cardSetNext(&snapshot->cards_, 0); number != 0; number = cardSetNext(&snapshot->cards_, number))
+  {
+    int place = snapshotPlace(snapshot, number);
+    int player_index = place / SNAPSHOT_PLACES;
+    deck->color_[number] = CARD_COLORS[snapshotColor(snapshot, number)];
+    deck->points_[number] = (uint8_t) colorPoints(deck->color_[number]);
+    if (player_index >= ENGINE_PLAYERS)
     {
-      printf("Please enter the number of a card in your hand cards!\n");
-      return ERROR;
+      continue;
     }
-
-    token = strtok(NULL, " ");
-    if (token != NULL)
+    place %= SNAPSHOT_PLACES;
+    if (place == 0)
     {
-      printf("Please enter the number of a card in your hand cards!\n");
-      return ERROR;
+      cardSetAdd(&position->hand_cards_[player_index], number);
+    }
+    else if (place == 1)
+    {
+      cardSetAdd(&position->chosen_cards_[player_index], number);
+    }
+    else
+    {
+      RowState *row = &position->row_[player_index][place - 2];
+      if (row->length_ == 0)
+      {
+        row->low_ = (uint8_t) number;
+      }
+      row->high_ = (uint8_t) number;
+      row->length_++;
+      row->points_ += deck->points_[number];
     }
+  }
 
-    return (int) number;
+  position->phase_ = snapshot->phase_;
+  position->turn_ = snapshot->turn_;
+  if (position->phase_ == PHASE_CHOOSING && position->turn_ < ENGINE_PLAYERS)
+  {
+    position->picked_ = (uint8_t) cardSetCount(&position->chosen_cards_[position->turn_]);
   }
+  settlePosition(position);
 }
 
-//----------------------------------------------------------------------------------------------------------------------
-///
-/// This function compares two strings in a case-insensitive manner.
+//---------------------------------------------------------------------------------------------------------------------
 ///
-/// @param string1 The first string to be compared.
-/// @param string2 The second string to be compared.
+/// Writes a snapshot to a file.
 ///
-/// @return 0 if the strings are equal (case-insensitive), 1 otherwise.
+/// @param snapshot snapshot of the game
+/// @param file_name path of the file
 ///
-int stringCompareCaseInsensitive(const char *string1, const char *string2)
+/// @return success(0) or ERROR
+//
+int snapshotWrite(const Snapshot *snapshot, const char *file_name)
 {
-  while (*string1 && (*string1 == *string2 || tolower(*string1) == tolower(*string2)))
+  FILE *file = fopen(file_name, "wb");
+  if (file == NULL)
   {
-    string1++;
-    string2++;
+    return ERROR;
   }
+  size_t written = fwrite(snapshot, sizeof(Snapshot), 1, file);
+  return fclose(file) == 0 && written == 1 ? 0 : ERROR;
+}
 
-  return (*string1 == *string2) ? 0 : 1;
+//---------------------------------------------------------------------------------------------------------------------
+///
+/// Reads a snapshot from a file and checks that it describes a running game.
+///
+/// @param snapshot receives the snapshot
+/// @param file_name path of the file
+///
+/// @return success(0), 2 if the file cannot be opened or 3 if it is no valid snapshot
+//
+int snapshotRead(Snapshot *snapshot, const char *file_name)
+{
+  FILE *file = fopen(file_name, "rb");
+  if (file == NULL)
+  {
+    return 2;
+  }
+  size_t read_count = fread(snapshot, sizeof(Snapshot), 1, file);
+  int extra = fgetc(file);
+  fclose(file);
+
+  if (read_count != 1 || extra != EOF || memcmp(snapshot->magic_, "A3SN", 4) != 0 ||
+      snapshot->version_ != SNAPSHOT_VERSION || snapshot->players_ == 0 ||
+      snapshot->players_ > SNAPSHOT_MAX_PLAYERS || snapshot->phase_ > PHASE_ACTION ||
+      snapshot->turn_ >= snapshot->players_ || cardSetContains(&snapshot->cards_, 0))
+  {
+    return 3;
+  }
+  for (int word = 0; word < 2; ++word)
+  {
+    uint64_t outside = ~snapshot->cards_.bits_[word];
+    for (int bit = 0; bit < SNAPSHOT_PLACE_BITS; ++bit)
+    {
+      if (snapshot->places_[bit].bits_[word] & outside)
+      {
+        return 3;
+      }
+    }
+    if ((snapshot->colors_[0].bits_[word] | snapshot->colors_[1].bits_[word]) & outside)
+    {
+      return 3;
+    }
+  }
+  for (int number = cardSetNext(&snapshot->cards_, 0); number != 0; number = cardSetNext(&snapshot->cards_, number))
+  {
+    if (snapshotPlace(snapshot, number) >= snapshot->players_ * SNAPSHOT_PLACES)
+    {
+      return 3;
+    }
+  }
+  return 0;
 }